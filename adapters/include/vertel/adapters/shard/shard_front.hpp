@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../../include/vertel/adapters/shard/shard_front.hpp"
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../../include/vertel/adapters/telegram/async_sender.hpp"
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../../include/vertel/adapters/telegram/http_connection_pool.hpp"
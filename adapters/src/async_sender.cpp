@@ -0,0 +1,278 @@
+#include "vertel/adapters/telegram/async_sender.hpp"
+
+#if VERTEL_HAS_LIBCURL
+#include <curl/curl.h>
+#endif
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace vertel::adapters::telegram {
+
+#if VERTEL_HAS_LIBCURL
+namespace {
+
+struct PendingRequest {
+  std::string url;
+  std::string form_body;
+  AsyncSender::Callback done;
+  std::optional<std::int64_t> ordering_key;
+};
+
+struct Transfer {
+  PendingRequest request;
+  HttpConnectionPool::Lease lease;
+  std::string response_body;
+  char error_buffer[CURL_ERROR_SIZE]{};
+};
+
+size_t WriteBody(char *ptr, size_t size, size_t nmemb, void *userdata) {
+  auto *out = static_cast<std::string *>(userdata);
+  out->append(ptr, size * nmemb);
+  return size * nmemb;
+}
+
+} // namespace
+
+struct AsyncSender::Impl {
+  std::shared_ptr<HttpConnectionPool> pool;
+  Options options;
+  CURLM *multi{nullptr};
+
+  mutable std::mutex mutex;
+  std::condition_variable idle_cv;
+  std::deque<PendingRequest> queue;
+  std::size_t outstanding{0};
+  bool stopping{false};
+  std::thread thread;
+
+  // Loop-thread only: keyed requests waiting for their predecessor, and
+  // requests unblocked by a completion that start on the next iteration.
+  std::unordered_map<std::int64_t, std::deque<PendingRequest>> waiting;
+  std::vector<PendingRequest> unblocked;
+
+  void Run();
+  // Returns false when the request must wait behind an in-flight one.
+  bool Admit(PendingRequest &request);
+  // Lets the next request queued behind `key` start.
+  void ReleaseKey(const std::optional<std::int64_t> &key);
+  void Start(PendingRequest request, std::vector<Transfer *> &active);
+  void Complete(CURL *curl, CURLcode code, std::vector<Transfer *> &active);
+};
+
+void AsyncSender::Impl::Start(PendingRequest request, std::vector<Transfer *> &active) {
+  auto lease = pool->Acquire();
+  if (!lease) {
+    ReleaseKey(request.ordering_key);
+    Response response{.status_code = 0, .body = {}, .error = "curl_easy_init failed"};
+    try {
+      request.done(std::move(response));
+    } catch (...) {
+    }
+    std::scoped_lock lock(mutex);
+    --outstanding;
+    idle_cv.notify_all();
+    return;
+  }
+
+  auto *transfer = new Transfer{.request = std::move(request),
+                                .lease = std::move(lease),
+                                .response_body = {},
+                                .error_buffer = {}};
+  auto *curl = static_cast<CURL *>(transfer->lease.handle());
+  curl_easy_setopt(curl, CURLOPT_URL, transfer->request.url.c_str());
+  curl_easy_setopt(curl, CURLOPT_POST, 1L);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, transfer->request.form_body.c_str());
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE,
+                   static_cast<long>(transfer->request.form_body.size()));
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteBody);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &transfer->response_body);
+  curl_easy_setopt(curl, CURLOPT_ERRORBUFFER, transfer->error_buffer);
+  curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, options.connect_timeout_seconds);
+  curl_easy_setopt(curl, CURLOPT_TIMEOUT, options.request_timeout_seconds);
+  curl_easy_setopt(curl, CURLOPT_USERAGENT, "vertel-bot/1.0");
+  curl_easy_setopt(curl, CURLOPT_HTTP_VERSION, static_cast<long>(CURL_HTTP_VERSION_2TLS));
+  // Prefer a stream on an existing HTTP/2 connection over opening a new one.
+  curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 1L);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+
+  curl_multi_add_handle(multi, curl);
+  active.push_back(transfer);
+}
+
+void AsyncSender::Impl::Complete(CURL *curl, CURLcode code, std::vector<Transfer *> &active) {
+  Transfer *transfer = nullptr;
+  curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer);
+  curl_multi_remove_handle(multi, curl);
+  active.erase(std::remove(active.begin(), active.end(), transfer), active.end());
+
+  Response response;
+  if (code != CURLE_OK) {
+    response.error = transfer->error_buffer[0] != '\0' ? transfer->error_buffer
+                                                       : curl_easy_strerror(code);
+  } else {
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.status_code);
+  }
+  response.body = std::move(transfer->response_body);
+
+  auto done = std::move(transfer->request.done);
+  ReleaseKey(transfer->request.ordering_key);
+  // Return the handle to the pool before running user code.
+  delete transfer;
+  try {
+    done(std::move(response));
+  } catch (...) {
+  }
+
+  std::scoped_lock lock(mutex);
+  --outstanding;
+  idle_cv.notify_all();
+}
+
+void AsyncSender::Impl::ReleaseKey(const std::optional<std::int64_t> &key) {
+  if (!key.has_value()) {
+    return;
+  }
+  auto it = waiting.find(*key);
+  if (it->second.empty()) {
+    waiting.erase(it);
+    return;
+  }
+  unblocked.push_back(std::move(it->second.front()));
+  it->second.pop_front();
+}
+
+bool AsyncSender::Impl::Admit(PendingRequest &request) {
+  if (!request.ordering_key.has_value()) {
+    return true;
+  }
+  // An entry in `waiting` (even an empty one) marks the key as in flight.
+  auto [it, inserted] = waiting.try_emplace(*request.ordering_key);
+  if (inserted) {
+    return true;
+  }
+  it->second.push_back(std::move(request));
+  return false;
+}
+
+void AsyncSender::Impl::Run() {
+  std::vector<Transfer *> active;
+  std::vector<PendingRequest> admitted;
+
+  while (true) {
+    admitted.swap(unblocked);
+    {
+      std::scoped_lock lock(mutex);
+      while (!queue.empty() && active.size() + admitted.size() < options.max_in_flight) {
+        PendingRequest request = std::move(queue.front());
+        queue.pop_front();
+        if (Admit(request)) {
+          admitted.push_back(std::move(request));
+        }
+      }
+      if (stopping && queue.empty() && admitted.empty() && active.empty()) {
+        break;
+      }
+    }
+    for (auto &request : admitted) {
+      Start(std::move(request), active);
+    }
+    admitted.clear();
+
+    int running = 0;
+    curl_multi_perform(multi, &running);
+
+    int pending = 0;
+    bool completed = false;
+    while (CURLMsg *msg = curl_multi_info_read(multi, &pending)) {
+      if (msg->msg == CURLMSG_DONE) {
+        Complete(msg->easy_handle, msg->data.result, active);
+        completed = true;
+      }
+    }
+    if (completed) {
+      // A completion frees an in-flight slot and may unblock a request of the
+      // same chat; start those now rather than after the poll below.
+      continue;
+    }
+
+    // Sleeps until socket activity, a curl timeout, or Submit()/the destructor
+    // calls curl_multi_wakeup().
+    curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+  }
+}
+
+AsyncSender::AsyncSender(std::shared_ptr<HttpConnectionPool> pool, Options options)
+    : impl_(std::make_unique<Impl>()) {
+  impl_->pool = pool != nullptr ? std::move(pool) : std::make_shared<HttpConnectionPool>();
+  impl_->options = options;
+  impl_->options.max_in_flight = std::max<std::size_t>(1, options.max_in_flight);
+  impl_->multi = curl_multi_init();
+  curl_multi_setopt(impl_->multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(impl_->multi, CURLMOPT_MAX_CONCURRENT_STREAMS,
+                    static_cast<long>(impl_->options.max_in_flight));
+  impl_->thread = std::thread(&Impl::Run, impl_.get());
+}
+
+AsyncSender::~AsyncSender() {
+  {
+    std::scoped_lock lock(impl_->mutex);
+    impl_->stopping = true;
+  }
+  curl_multi_wakeup(impl_->multi);
+  if (impl_->thread.joinable()) {
+    impl_->thread.join();
+  }
+  curl_multi_cleanup(impl_->multi);
+}
+
+void AsyncSender::Submit(std::string url, std::string form_body, Callback done,
+                         std::optional<std::int64_t> ordering_key) {
+  {
+    std::scoped_lock lock(impl_->mutex);
+    impl_->queue.push_back(PendingRequest{.url = std::move(url),
+                                          .form_body = std::move(form_body),
+                                          .done = std::move(done),
+                                          .ordering_key = ordering_key});
+    ++impl_->outstanding;
+  }
+  curl_multi_wakeup(impl_->multi);
+}
+
+#else
+
+struct AsyncSender::Impl {
+  mutable std::mutex mutex;
+  std::size_t outstanding{0};
+};
+
+AsyncSender::AsyncSender(std::shared_ptr<HttpConnectionPool>, Options)
+    : impl_(std::make_unique<Impl>()) {}
+
+AsyncSender::~AsyncSender() = default;
+
+void AsyncSender::Submit(std::string, std::string, Callback done, std::optional<std::int64_t>) {
+  done(Response{.error = "asynchronous sends require libcurl"});
+}
+
+#endif
+
+void AsyncSender::Flush() {
+#if VERTEL_HAS_LIBCURL
+  std::unique_lock lock(impl_->mutex);
+  impl_->idle_cv.wait(lock, [this] { return impl_->outstanding == 0; });
+#endif
+}
+
+std::size_t AsyncSender::Outstanding() const {
+  std::scoped_lock lock(impl_->mutex);
+  return impl_->outstanding;
+}
+
+} // namespace vertel::adapters::telegram
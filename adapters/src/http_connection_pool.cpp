@@ -0,0 +1,212 @@
+#include "vertel/adapters/telegram/http_connection_pool.hpp"
+
+#if VERTEL_HAS_LIBCURL
+#include <curl/curl.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace vertel::adapters::telegram {
+
+#if VERTEL_HAS_LIBCURL
+namespace {
+
+void EnsureCurlGlobalInit() {
+  static std::once_flag once;
+  std::call_once(once, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+}
+
+} // namespace
+
+struct HttpConnectionPool::Impl {
+  Options options;
+  CURLSH *share{nullptr};
+  // One mutex per curl_lock_data kind, as required by the share interface.
+  std::array<std::mutex, CURL_LOCK_DATA_LAST> share_locks;
+  mutable std::mutex mutex;
+  std::vector<CURL *> idle;
+
+  static void Lock(CURL *, curl_lock_data data, curl_lock_access, void *userptr) {
+    static_cast<Impl *>(userptr)->share_locks[static_cast<std::size_t>(data)].lock();
+  }
+
+  static void Unlock(CURL *, curl_lock_data data, void *userptr) {
+    static_cast<Impl *>(userptr)->share_locks[static_cast<std::size_t>(data)].unlock();
+  }
+
+  void ApplyDefaults(CURL *curl) const {
+    curl_easy_setopt(curl, CURLOPT_SHARE, share);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPIDLE, options.tcp_keepalive_idle_seconds);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPINTVL, options.tcp_keepalive_interval_seconds);
+    curl_easy_setopt(curl, CURLOPT_TCP_NODELAY, 1L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_DNS_CACHE_TIMEOUT, 300L);
+    // Advertise every encoding curl was built with; bodies arrive decompressed.
+    curl_easy_setopt(curl, CURLOPT_ACCEPT_ENCODING, "");
+  }
+};
+
+HttpConnectionPool::HttpConnectionPool() : HttpConnectionPool(Options{}) {}
+
+HttpConnectionPool::HttpConnectionPool(Options options) : impl_(std::make_unique<Impl>()) {
+  EnsureCurlGlobalInit();
+  impl_->options = options;
+  impl_->share = curl_share_init();
+  if (impl_->share != nullptr) {
+    curl_share_setopt(impl_->share, CURLSHOPT_LOCKFUNC, &Impl::Lock);
+    curl_share_setopt(impl_->share, CURLSHOPT_UNLOCKFUNC, &Impl::Unlock);
+    curl_share_setopt(impl_->share, CURLSHOPT_USERDATA, impl_.get());
+    curl_share_setopt(impl_->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(impl_->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    curl_share_setopt(impl_->share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+  }
+}
+
+HttpConnectionPool::~HttpConnectionPool() {
+  // Easy handles must be gone before the share they reference is cleaned up.
+  for (CURL *curl : impl_->idle) {
+    curl_easy_cleanup(curl);
+  }
+  impl_->idle.clear();
+  if (impl_->share != nullptr) {
+    curl_share_cleanup(impl_->share);
+  }
+}
+
+HttpConnectionPool::Lease HttpConnectionPool::Acquire() {
+  {
+    std::scoped_lock lock(impl_->mutex);
+    if (!impl_->idle.empty()) {
+      CURL *curl = impl_->idle.back();
+      impl_->idle.pop_back();
+      return Lease(this, curl);
+    }
+  }
+
+  CURL *curl = curl_easy_init();
+  if (curl == nullptr) {
+    return Lease{};
+  }
+  impl_->ApplyDefaults(curl);
+  return Lease(this, curl);
+}
+
+void HttpConnectionPool::Release(void *handle) {
+  auto *curl = static_cast<CURL *>(handle);
+  // Drop per-request options (URL, body, callbacks) but keep the live
+  // connection, DNS entries and session IDs, which sit in the share.
+  curl_easy_reset(curl);
+  impl_->ApplyDefaults(curl);
+
+  std::scoped_lock lock(impl_->mutex);
+  if (impl_->idle.size() < impl_->options.max_idle_handles) {
+    impl_->idle.push_back(curl);
+    return;
+  }
+  curl_easy_cleanup(curl);
+}
+
+std::size_t HttpConnectionPool::Warmup(const std::string &url, std::size_t connections) {
+  if (connections == 0) {
+    return 0;
+  }
+
+  CURLM *multi = curl_multi_init();
+  if (multi == nullptr) {
+    return 0;
+  }
+
+  std::vector<Lease> leases;
+  leases.reserve(connections);
+  for (std::size_t i = 0; i < connections; ++i) {
+    Lease lease = Acquire();
+    if (!lease) {
+      break;
+    }
+    auto *curl = static_cast<CURL *>(lease.handle());
+    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+    curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 15L);
+    // Open a connection per handle instead of queueing behind the first one.
+    curl_easy_setopt(curl, CURLOPT_PIPEWAIT, 0L);
+    curl_multi_add_handle(multi, curl);
+    leases.push_back(std::move(lease));
+  }
+
+  int running = 0;
+  do {
+    if (curl_multi_perform(multi, &running) != CURLM_OK) {
+      break;
+    }
+    if (running > 0) {
+      curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+    }
+  } while (running > 0);
+
+  std::size_t connected = 0;
+  int pending = 0;
+  while (CURLMsg *msg = curl_multi_info_read(multi, &pending)) {
+    if (msg->msg == CURLMSG_DONE && msg->data.result == CURLE_OK) {
+      ++connected;
+    }
+  }
+
+  for (auto &lease : leases) {
+    curl_multi_remove_handle(multi, static_cast<CURL *>(lease.handle()));
+  }
+  curl_multi_cleanup(multi);
+  return connected;
+}
+
+std::size_t HttpConnectionPool::IdleHandles() const {
+  std::scoped_lock lock(impl_->mutex);
+  return impl_->idle.size();
+}
+
+#else
+
+struct HttpConnectionPool::Impl {};
+
+HttpConnectionPool::HttpConnectionPool() : HttpConnectionPool(Options{}) {}
+
+HttpConnectionPool::HttpConnectionPool(Options) : impl_(std::make_unique<Impl>()) {}
+
+HttpConnectionPool::~HttpConnectionPool() = default;
+
+HttpConnectionPool::Lease HttpConnectionPool::Acquire() { return Lease{}; }
+
+void HttpConnectionPool::Release(void *) {}
+
+std::size_t HttpConnectionPool::Warmup(const std::string &, std::size_t) { return 0; }
+
+std::size_t HttpConnectionPool::IdleHandles() const { return 0; }
+
+#endif
+
+HttpConnectionPool::Lease::~Lease() {
+  if (pool_ != nullptr && handle_ != nullptr) {
+    pool_->Release(handle_);
+  }
+}
+
+HttpConnectionPool::Lease::Lease(Lease &&other) noexcept
+    : pool_(std::exchange(other.pool_, nullptr)), handle_(std::exchange(other.handle_, nullptr)) {}
+
+HttpConnectionPool::Lease &HttpConnectionPool::Lease::operator=(Lease &&other) noexcept {
+  if (this != &other) {
+    if (pool_ != nullptr && handle_ != nullptr) {
+      pool_->Release(handle_);
+    }
+    pool_ = std::exchange(other.pool_, nullptr);
+    handle_ = std::exchange(other.handle_, nullptr);
+  }
+  return *this;
+}
+
+} // namespace vertel::adapters::telegram
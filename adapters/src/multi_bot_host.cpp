@@ -0,0 +1,221 @@
+#include "vertel/adapters/telegram/multi_bot_host.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+#include <utility>
+
+namespace vertel::adapters::telegram {
+
+MultiBotHost::MultiBotHost(Options options, runtime::MetricsRegistry *metrics)
+    : options_(std::move(options)), metrics_(metrics),
+      pool_(std::make_shared<HttpConnectionPool>()),
+      sender_(std::make_shared<AsyncSender>(
+          pool_, AsyncSender::Options{
+                     .max_in_flight = options_.max_in_flight_sends,
+                     .request_timeout_seconds = std::max(5, options_.request_timeout_seconds)})),
+      retry_(options_.retry, metrics) {}
+
+MultiBotHost::~MultiBotHost() { Stop(); }
+
+runtime::MetricsRegistry *MultiBotHost::MetricsFor(std::string_view name) {
+  if (metrics_ == nullptr) {
+    return nullptr;
+  }
+  auto it = bot_metrics_.find(name);
+  if (it == bot_metrics_.end()) {
+    it = bot_metrics_
+             .emplace(std::string(name), std::make_unique<runtime::MetricsRegistry>(
+                                             *metrics_, runtime::MetricLabels{
+                                                            {"bot", std::string(name)}}))
+             .first;
+  }
+  return it->second.get();
+}
+
+void MultiBotHost::AddBot(std::string name, std::string token, core::CommandHandler &handler,
+                          runtime::OffsetCheckpoint *checkpoint) {
+  if (started_) {
+    throw std::logic_error("MultiBotHost::AddBot() after Start()");
+  }
+  for (const auto &bot : bots_) {
+    if (bot->name == name) {
+      throw std::invalid_argument("duplicate bot name: " + name);
+    }
+  }
+
+  auto bot = std::make_unique<Bot>();
+  bot->endpoint = "getUpdates/" + name;
+  bot->metrics = MetricsFor(name);
+  bot->name = std::move(name);
+  bot->client = std::make_unique<TelegramClient>(
+      std::move(token), options_.long_poll_timeout_seconds, options_.request_timeout_seconds, pool_,
+      sender_, bot->metrics);
+  if (!options_.api_base.empty()) {
+    bot->client->SetApiBase(options_.api_base);
+  }
+  if (checkpoint != nullptr) {
+    bot->client->UseCheckpoint(checkpoint);
+  }
+  bot->service = std::make_unique<core::BotService>(*bot->client, handler, bot->metrics);
+  bots_.push_back(std::move(bot));
+}
+
+void MultiBotHost::Start() {
+  {
+    std::lock_guard lock(mutex_);
+    if (started_ || stopping_) {
+      return;
+    }
+    started_ = true;
+    running_ = bots_.size();
+  }
+  // One transfer per bot: every long poll stays open on the same multi loop.
+  poller_ = std::make_unique<AsyncSender>(
+      pool_, AsyncSender::Options{
+                 .max_in_flight = std::max<std::size_t>(1, bots_.size()),
+                 .request_timeout_seconds = std::max(options_.request_timeout_seconds,
+                                                     options_.long_poll_timeout_seconds + 5)});
+  workers_ =
+      std::make_unique<runtime::ShardedWorkerPool>(std::max<std::size_t>(1, options_.workers),
+                                                   metrics_);
+  timer_thread_ = std::thread([this] { RunTimers(); });
+  for (auto &bot : bots_) {
+    Poll(*bot);
+  }
+}
+
+void MultiBotHost::Stop() {
+  {
+    std::unique_lock lock(mutex_);
+    if (!started_) {
+      return;
+    }
+    started_ = false;
+    stopping_ = true;
+    timer_cv_.notify_all();
+    stopped_cv_.wait(lock, [this] { return running_ == 0; });
+  }
+  timer_thread_.join();
+  workers_.reset();
+  poller_.reset();
+}
+
+void MultiBotHost::RetireLocked() {
+  if (--running_ == 0) {
+    stopped_cv_.notify_all();
+  }
+}
+
+void MultiBotHost::Poll(Bot &bot) {
+  {
+    std::lock_guard lock(mutex_);
+    if (stopping_) {
+      RetireLocked();
+      return;
+    }
+  }
+  if (const auto wait = retry_.Admit(bot.endpoint); wait > std::chrono::steady_clock::duration{}) {
+    PollAfter(bot, wait);
+    return;
+  }
+
+  // After a full batch more updates are probably queued: do not wait for them.
+  bot.client->SetPollOptions(core::PollOptions{
+      .limit = options_.poll_limit,
+      .timeout = bot.backlog ? std::chrono::seconds(0)
+                             : std::chrono::seconds(options_.long_poll_timeout_seconds)});
+  bot.batch.Clear();
+  bot.poll_started = std::chrono::steady_clock::now();
+  bot.client->PollBatchAsync(*poller_, bot.batch,
+                             [this, &bot](std::exception_ptr error) { OnPolled(bot, error); });
+}
+
+void MultiBotHost::OnPolled(Bot &bot, std::exception_ptr error) {
+  if (error != nullptr) {
+    runtime::RetryOutcome outcome;
+    try {
+      std::rethrow_exception(error);
+    } catch (const std::exception &ex) {
+      outcome = RetryOutcomeFor(ex);
+    } catch (...) {
+      outcome = runtime::RetryOutcome{
+          .ok = false, .retryable = true, .retry_after = {}, .error = "unknown poll error"};
+    }
+    bot.backlog = false;
+    const auto decision = retry_.Record(bot.endpoint, bot.poll_attempt, outcome);
+    if (decision.retry) {
+      ++bot.poll_attempt;
+      PollAfter(bot, decision.delay);
+    } else {
+      // Out of attempts or not retryable (a revoked token answers 401 at once):
+      // start over after a pause, and later still if the circuit opened.
+      bot.poll_attempt = 1;
+      PollAfter(bot, std::max<std::chrono::steady_clock::duration>(
+                         options_.idle_backoff, options_.retry.initial_backoff));
+    }
+    return;
+  }
+
+  retry_.Record(
+      bot.endpoint, bot.poll_attempt,
+      runtime::RetryOutcome{.ok = true, .retryable = true, .retry_after = {}, .error = {}});
+  bot.poll_attempt = 1;
+  bot.backlog = bot.batch.size() >= static_cast<std::size_t>(options_.poll_limit);
+  if (bot.batch.empty()) {
+    PollAfter(bot, options_.idle_backoff - (std::chrono::steady_clock::now() - bot.poll_started));
+    return;
+  }
+  workers_->Submit(next_worker_.fetch_add(1, std::memory_order_relaxed), [this, &bot] {
+    try {
+      bot.service->ProcessBatch(bot.batch);
+    } catch (const std::exception &) {
+      // Handler errors are counted by the service; this is a failed commit.
+      if (bot.metrics != nullptr) {
+        bot.metrics->IncrementHandlerFailures();
+      }
+    }
+    Poll(bot);
+  });
+}
+
+void MultiBotHost::PollAfter(Bot &bot, std::chrono::steady_clock::duration delay) {
+  if (delay <= std::chrono::steady_clock::duration{}) {
+    Poll(bot);
+    return;
+  }
+  std::lock_guard lock(mutex_);
+  if (stopping_) {
+    RetireLocked();
+    return;
+  }
+  timers_.push(Timer{.at = std::chrono::steady_clock::now() + delay, .bot = &bot});
+  timer_cv_.notify_one();
+}
+
+void MultiBotHost::RunTimers() {
+  std::unique_lock lock(mutex_);
+  while (true) {
+    if (stopping_) {
+      for (; !timers_.empty(); timers_.pop()) {
+        RetireLocked();
+      }
+      return;
+    }
+    if (timers_.empty()) {
+      timer_cv_.wait(lock);
+      continue;
+    }
+    if (const auto at = timers_.top().at; std::chrono::steady_clock::now() < at) {
+      timer_cv_.wait_until(lock, at);
+      continue;
+    }
+    Bot *bot = timers_.top().bot;
+    timers_.pop();
+    lock.unlock();
+    Poll(*bot);
+    lock.lock();
+  }
+}
+
+} // namespace vertel::adapters::telegram
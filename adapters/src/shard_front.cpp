@@ -0,0 +1,408 @@
+#include "vertel/adapters/shard/shard_front.hpp"
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <utility>
+
+#include "vertel/adapters/shard/shard_protocol.hpp"
+
+namespace vertel::adapters::shard {
+namespace {
+
+#ifndef _WIN32
+
+bool WriteAll(int fd, std::string_view bytes) {
+  while (!bytes.empty()) {
+    const ssize_t written = send(fd, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      return false;
+    }
+    bytes.remove_prefix(static_cast<std::size_t>(written));
+  }
+  return true;
+}
+
+bool ReadFull(int fd, char *out, std::size_t size) {
+  while (size > 0) {
+    const ssize_t received = recv(fd, out, size, 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      return false;
+    }
+    out += received;
+    size -= static_cast<std::size_t>(received);
+  }
+  return true;
+}
+
+#endif
+
+} // namespace
+
+ShardFront::ShardFront(Options options, core::TelegramGateway &ingest,
+                       core::TelegramGateway &outbound, runtime::MetricsRegistry *metrics)
+    : options_(std::move(options)), ingest_(ingest), outbound_(outbound), metrics_(metrics),
+      shards_(std::max<std::uint32_t>(1, options_.shards)) {
+  options_.shards = static_cast<std::uint32_t>(shards_.size());
+  if (metrics_ == nullptr) {
+    return;
+  }
+  relayed_replies_ = &metrics_->GetCounter("vertel_shard_relayed_replies_total",
+                                           "Replies sent on behalf of shard workers");
+  for (std::uint32_t i = 0; i < options_.shards; ++i) {
+    const runtime::MetricLabels labels{{"shard", std::to_string(i)}};
+    shards_[i].unacked_gauge = &metrics_->GetGauge(
+        "vertel_shard_unacked_updates", "Updates routed to a shard and not yet handled", labels);
+    shards_[i].redelivered = &metrics_->GetCounter(
+        "vertel_shard_redelivered_total", "Updates sent again after a worker reconnected", labels);
+  }
+}
+
+ShardFront::~ShardFront() { Stop(); }
+
+std::size_t ShardFront::Unacked(std::uint32_t shard) const {
+  std::lock_guard lock(mutex_);
+  return shards_.at(shard).unacked.size();
+}
+
+bool ShardFront::Connected(std::uint32_t shard) const {
+  std::lock_guard lock(mutex_);
+  return shards_.at(shard).connection != nullptr;
+}
+
+std::int64_t ShardFront::CommittableLocked() const {
+  std::int64_t next = polled_through_;
+  for (const auto &shard : shards_) {
+    if (!shard.unacked.empty()) {
+      next = std::min(next, shard.unacked.front().update_id);
+    }
+  }
+  return next;
+}
+
+void ShardFront::Run(const core::RunOptions &options) {
+  const auto stopping = [&] { return options.stop_requested && options.stop_requested(); };
+  const auto pause = [&](std::chrono::steady_clock::duration delay) {
+    const auto deadline = std::chrono::steady_clock::now() + delay;
+    for (auto now = std::chrono::steady_clock::now(); now < deadline && !stopping();
+         now = std::chrono::steady_clock::now()) {
+      std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+          deadline - now, std::chrono::milliseconds(100)));
+    }
+  };
+  const auto has_room = [this] {
+    return std::all_of(shards_.begin(), shards_.end(), [this](const Shard &shard) {
+      return shard.unacked.size() < options_.max_unacked_per_shard;
+    });
+  };
+
+  core::UpdateBatch batch;
+  bool backlog = false;
+  while (!stopping()) {
+    bool room = false;
+    std::int64_t committable = 0;
+    {
+      std::unique_lock lock(mutex_);
+      room = cv_.wait_for(lock, std::chrono::milliseconds(100), has_room);
+      committable = CommittableLocked();
+    }
+    if (committable > committed_) {
+      committed_ = committable;
+      ingest_.CommitUpdates(committable);
+    }
+    if (!room) {
+      continue;
+    }
+
+    const core::PollOptions poll{.limit = options_.poll_limit,
+                                 .timeout = backlog ? std::chrono::seconds(0)
+                                                    : options_.poll_timeout};
+    batch.Clear();
+    const auto started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration delay{0};
+    bool polled = false;
+    try {
+      ingest_.SetPollOptions(poll);
+      ingest_.PollBatch(batch);
+      polled = true;
+    } catch (const std::exception &ex) {
+      batch.Clear();
+      if (!options.after_poll) {
+        throw;
+      }
+      delay = options.after_poll(&ex);
+    }
+    if (polled && options.after_poll) {
+      delay = options.after_poll(nullptr);
+    }
+
+    backlog = batch.size() >= static_cast<std::size_t>(poll.limit);
+    if (!batch.empty()) {
+      std::lock_guard lock(mutex_);
+      for (const auto &update : batch) {
+        auto &shard = shards_[ShardForChat(update.chat_id, options_.shards)];
+        auto &pending =
+            shard.unacked.emplace_back(Pending{.update_id = update.update_id, .frame = {}});
+        AppendUpdateFrame(pending.frame, update);
+        if (shard.unacked_gauge != nullptr) {
+          shard.unacked_gauge->Add(1);
+        }
+        polled_through_ = std::max(polled_through_, update.update_id + 1);
+      }
+      cv_.notify_all();
+    } else if (delay <= std::chrono::steady_clock::duration::zero()) {
+      delay = options_.idle_backoff - (std::chrono::steady_clock::now() - started);
+    }
+    pause(delay);
+  }
+}
+
+#ifdef _WIN32
+
+bool ShardFront::Start() { return false; }
+
+void ShardFront::Stop() {}
+
+void ShardFront::AcceptLoop() {}
+
+void ShardFront::Attach(int) {}
+
+void ShardFront::ReadLoop(Connection &) {}
+
+void ShardFront::WriteLoop(Connection &) {}
+
+void ShardFront::ReapConnections(bool) {}
+
+#else
+
+bool ShardFront::Start() {
+  if (listen_fd_ >= 0) {
+    return true;
+  }
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (options_.socket_path.empty() || options_.socket_path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memcpy(address.sun_path, options_.socket_path.c_str(), options_.socket_path.size() + 1);
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  unlink(options_.socket_path.c_str());
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(fd, SOMAXCONN) != 0) {
+    close(fd);
+    return false;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = false;
+  }
+  listen_fd_ = fd;
+  accept_thread_ = std::thread([this] { AcceptLoop(); });
+  return true;
+}
+
+void ShardFront::Stop() {
+  if (listen_fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+    for (auto &connection : connections_) {
+      shutdown(connection.fd, SHUT_RDWR);
+    }
+  }
+  cv_.notify_all();
+  shutdown(listen_fd_, SHUT_RDWR);
+  accept_thread_.join();
+  close(listen_fd_);
+  listen_fd_ = -1;
+  unlink(options_.socket_path.c_str());
+  ReapConnections(true);
+}
+
+void ShardFront::AcceptLoop() {
+  for (;;) {
+    const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return;
+    }
+    ReapConnections(false);
+    Attach(fd);
+  }
+}
+
+void ShardFront::Attach(int fd) {
+  // Exactly the hello: anything after it belongs to the reader.
+  timeval timeout{.tv_sec = 5, .tv_usec = 0};
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  char header[kFrameHeaderSize];
+  char payload[32];
+  Hello hello;
+  bool ok = ReadFull(fd, header, sizeof(header)) &&
+            static_cast<FrameType>(header[4]) == FrameType::kHello;
+  const auto length = ok ? static_cast<std::size_t>(static_cast<unsigned char>(header[0])) : 0;
+  ok = ok && header[1] == 0 && header[2] == 0 && header[3] == 0 && length <= sizeof(payload) &&
+       ReadFull(fd, payload, length) && DecodeHello(std::string_view(payload, length), hello) &&
+       hello.shards == options_.shards;
+  timeout.tv_sec = 0;
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+  std::lock_guard lock(mutex_);
+  if (!ok || stopping_) {
+    close(fd);
+    return;
+  }
+  auto &shard = shards_[hello.shard];
+  // A restarted worker can come back before its old connection has failed.
+  if (shard.connection != nullptr) {
+    shutdown(shard.connection->fd, SHUT_RDWR);
+  }
+  if (shard.redelivered != nullptr) {
+    std::size_t redelivered = 0;
+    while (redelivered < shard.unacked.size() &&
+           shard.unacked[redelivered].update_id <= shard.written_through) {
+      ++redelivered;
+    }
+    shard.redelivered->Increment(redelivered);
+  }
+  auto &connection = connections_.emplace_back(Connection{
+      .fd = fd, .shard = hello.shard, .reader = {}, .writer = {}, .finished = false});
+  shard.connection = &connection;
+  shard.sent = 0;
+  connection.reader = std::thread([this, &connection] { ReadLoop(connection); });
+  connection.writer = std::thread([this, &connection] { WriteLoop(connection); });
+  cv_.notify_all();
+}
+
+void ShardFront::ReadLoop(Connection &connection) {
+  FrameReader reader;
+  core::OutgoingMessage reply;
+  char chunk[65536];
+  bool open = true;
+  while (open) {
+    const ssize_t received = recv(connection.fd, chunk, sizeof(chunk), 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      break;
+    }
+    reader.Append(std::string_view(chunk, static_cast<std::size_t>(received)));
+    try {
+      while (open) {
+        const auto frame = reader.Next();
+        if (!frame.has_value()) {
+          break;
+        }
+        std::int64_t next_offset = 0;
+        if (frame->type == FrameType::kAck && DecodeAck(frame->payload, next_offset)) {
+          std::lock_guard lock(mutex_);
+          auto &shard = shards_[connection.shard];
+          std::size_t handled = 0;
+          for (; !shard.unacked.empty() && shard.unacked.front().update_id < next_offset;
+               ++handled) {
+            shard.unacked.pop_front();
+          }
+          shard.sent -= std::min(shard.sent, handled);
+          if (handled > 0) {
+            if (shard.unacked_gauge != nullptr) {
+              shard.unacked_gauge->Add(-static_cast<std::int64_t>(handled));
+            }
+            cv_.notify_all();
+          }
+        } else if (frame->type == FrameType::kReply && DecodeReply(frame->payload, reply)) {
+          outbound_.SendMessageAsync(reply, {});
+          if (relayed_replies_ != nullptr) {
+            relayed_replies_->Increment();
+          }
+        } else {
+          open = false;
+        }
+      }
+    } catch (const std::exception &) {
+      open = false;
+    }
+  }
+
+  std::lock_guard lock(mutex_);
+  auto &shard = shards_[connection.shard];
+  if (shard.connection == &connection) {
+    shard.connection = nullptr;
+    shard.sent = 0;
+  }
+  shutdown(connection.fd, SHUT_RDWR);
+  connection.finished = true;
+  cv_.notify_all();
+}
+
+void ShardFront::WriteLoop(Connection &connection) {
+  constexpr std::size_t kMaxWriteBytes = 256 * 1024;
+  std::string out;
+  std::unique_lock lock(mutex_);
+  auto &shard = shards_[connection.shard];
+  for (;;) {
+    cv_.wait(lock, [&] {
+      return stopping_ || shard.connection != &connection || shard.sent < shard.unacked.size();
+    });
+    if (stopping_ || shard.connection != &connection) {
+      return;
+    }
+    out.clear();
+    for (; shard.sent < shard.unacked.size() && out.size() < kMaxWriteBytes; ++shard.sent) {
+      out += shard.unacked[shard.sent].frame;
+      shard.written_through = std::max(shard.written_through, shard.unacked[shard.sent].update_id);
+    }
+    lock.unlock();
+    const bool written = WriteAll(connection.fd, out);
+    lock.lock();
+    if (!written) {
+      // The reader sees the socket close and detaches the connection.
+      shutdown(connection.fd, SHUT_RDWR);
+      return;
+    }
+  }
+}
+
+void ShardFront::ReapConnections(bool all) {
+  std::list<Connection> done;
+  {
+    std::lock_guard lock(mutex_);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+      const auto next = std::next(it);
+      if (all || it->finished) {
+        done.splice(done.end(), connections_, it);
+      }
+      it = next;
+    }
+  }
+  for (auto &connection : done) {
+    connection.reader.join();
+    connection.writer.join();
+    close(connection.fd);
+  }
+}
+
+#endif
+
+} // namespace vertel::adapters::shard
@@ -0,0 +1,200 @@
+#include "vertel/adapters/shard/shard_protocol.hpp"
+
+#include <stdexcept>
+
+namespace vertel::adapters::shard {
+namespace {
+
+void AppendVarint(std::string &out, std::uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value));
+}
+
+void AppendSigned(std::string &out, std::int64_t value) {
+  AppendVarint(out, (static_cast<std::uint64_t>(value) << 1) ^
+                        static_cast<std::uint64_t>(value >> 63));
+}
+
+void AppendString(std::string &out, std::string_view value) {
+  AppendVarint(out, value.size());
+  out.append(value);
+}
+
+// Reserves the header, then patches the payload length in once it is known.
+std::size_t BeginFrame(std::string &out, FrameType type) {
+  const std::size_t start = out.size();
+  out.append(4, '\0');
+  out.push_back(static_cast<char>(type));
+  return start;
+}
+
+void EndFrame(std::string &out, std::size_t start) {
+  const auto length = static_cast<std::uint32_t>(out.size() - start - kFrameHeaderSize);
+  for (int i = 0; i < 4; ++i) {
+    out[start + i] = static_cast<char>((length >> (8 * i)) & 0xff);
+  }
+}
+
+// Consumes from the front of `in`; false when it ends early.
+bool ReadVarint(std::string_view &in, std::uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64; shift += 7) {
+    if (in.empty()) {
+      return false;
+    }
+    const auto byte = static_cast<unsigned char>(in.front());
+    in.remove_prefix(1);
+    value |= static_cast<std::uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool ReadSigned(std::string_view &in, std::int64_t &value) {
+  std::uint64_t raw = 0;
+  if (!ReadVarint(in, raw)) {
+    return false;
+  }
+  value = static_cast<std::int64_t>(raw >> 1) ^ -static_cast<std::int64_t>(raw & 1);
+  return true;
+}
+
+bool ReadString(std::string_view &in, std::string_view &value) {
+  std::uint64_t length = 0;
+  if (!ReadVarint(in, length) || length > in.size()) {
+    return false;
+  }
+  value = in.substr(0, length);
+  in.remove_prefix(length);
+  return true;
+}
+
+} // namespace
+
+void AppendHelloFrame(std::string &out, const Hello &hello) {
+  const auto start = BeginFrame(out, FrameType::kHello);
+  AppendVarint(out, hello.shard);
+  AppendVarint(out, hello.shards);
+  EndFrame(out, start);
+}
+
+void AppendUpdateFrame(std::string &out, const core::UpdateView &update) {
+  const auto start = BeginFrame(out, FrameType::kUpdate);
+  AppendSigned(out, update.update_id);
+  AppendSigned(out, update.chat_id);
+  AppendSigned(out, update.date);
+  AppendString(out, update.text);
+  EndFrame(out, start);
+}
+
+void AppendAckFrame(std::string &out, std::int64_t next_offset) {
+  const auto start = BeginFrame(out, FrameType::kAck);
+  AppendSigned(out, next_offset);
+  EndFrame(out, start);
+}
+
+void AppendReplyFrame(std::string &out, const core::OutgoingMessage &message) {
+  const auto start = BeginFrame(out, FrameType::kReply);
+  AppendSigned(out, message.chat_id);
+  out.push_back(static_cast<char>(message.priority));
+  AppendString(out, message.text);
+  EndFrame(out, start);
+}
+
+bool DecodeHello(std::string_view payload, Hello &out) {
+  std::uint64_t shard = 0;
+  std::uint64_t shards = 0;
+  if (!ReadVarint(payload, shard) || !ReadVarint(payload, shards) || shards > UINT32_MAX ||
+      shard >= shards) {
+    return false;
+  }
+  out = Hello{.shard = static_cast<std::uint32_t>(shard),
+              .shards = static_cast<std::uint32_t>(shards)};
+  return true;
+}
+
+bool DecodeUpdate(std::string_view payload, core::UpdateView &out) {
+  return ReadSigned(payload, out.update_id) && ReadSigned(payload, out.chat_id) &&
+         ReadSigned(payload, out.date) && ReadString(payload, out.text);
+}
+
+bool DecodeAck(std::string_view payload, std::int64_t &next_offset) {
+  return ReadSigned(payload, next_offset);
+}
+
+bool DecodeReply(std::string_view payload, core::OutgoingMessage &out) {
+  std::string_view text;
+  if (!ReadSigned(payload, out.chat_id) || payload.empty()) {
+    return false;
+  }
+  const auto priority = static_cast<std::uint8_t>(payload.front());
+  payload.remove_prefix(1);
+  if (priority > static_cast<std::uint8_t>(core::MessagePriority::kBulk) ||
+      !ReadString(payload, text)) {
+    return false;
+  }
+  out.priority = static_cast<core::MessagePriority>(priority);
+  out.text.assign(text);
+  return true;
+}
+
+void FrameReader::Append(std::string_view bytes) {
+  // Drop consumed frames once they make up most of the buffer, so a steady
+  // stream compacts without moving bytes on every read.
+  if (consumed_ > 0 && consumed_ >= buffer_.size() / 2) {
+    buffer_.erase(0, consumed_);
+    consumed_ = 0;
+  }
+  buffer_.append(bytes);
+}
+
+std::optional<Frame> FrameReader::Next() {
+  const std::string_view rest = std::string_view(buffer_).substr(consumed_);
+  if (rest.size() < kFrameHeaderSize) {
+    return std::nullopt;
+  }
+  std::uint32_t length = 0;
+  for (int i = 0; i < 4; ++i) {
+    length |= static_cast<std::uint32_t>(static_cast<unsigned char>(rest[i])) << (8 * i);
+  }
+  if (length > kMaxFramePayload) {
+    throw std::runtime_error("shard frame of " + std::to_string(length) + " bytes");
+  }
+  if (rest.size() < kFrameHeaderSize + length) {
+    return std::nullopt;
+  }
+  consumed_ += kFrameHeaderSize + length;
+  return Frame{.type = static_cast<FrameType>(rest[4]),
+               .payload = rest.substr(kFrameHeaderSize, length)};
+}
+
+std::uint32_t ShardForChat(std::int64_t chat_id, std::uint32_t shards) {
+  if (shards <= 1) {
+    return 0;
+  }
+  // splitmix64 first: chat ids are sequential-ish and jump hashing wants
+  // well-mixed keys.
+  auto key = static_cast<std::uint64_t>(chat_id) + 0x9e3779b97f4a7c15ULL;
+  key = (key ^ (key >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  key = (key ^ (key >> 27)) * 0x94d049bb133111ebULL;
+  key ^= key >> 31;
+
+  // Lamping and Veach, "A Fast, Minimal Memory, Consistent Hash Algorithm".
+  std::int64_t bucket = -1;
+  std::int64_t next = 0;
+  while (next < static_cast<std::int64_t>(shards)) {
+    bucket = next;
+    key = key * 2862933555777941757ULL + 1;
+    next = static_cast<std::int64_t>(static_cast<double>(bucket + 1) *
+                                     (static_cast<double>(1LL << 31) /
+                                      static_cast<double>((key >> 33) + 1)));
+  }
+  return static_cast<std::uint32_t>(bucket);
+}
+
+} // namespace vertel::adapters::shard
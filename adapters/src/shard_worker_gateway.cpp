@@ -0,0 +1,240 @@
+#include "vertel/adapters/shard/shard_worker_gateway.hpp"
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <exception>
+#include <thread>
+#include <utility>
+
+namespace vertel::adapters::shard {
+
+ShardWorkerGateway::ShardWorkerGateway(Options options, core::TelegramGateway *outbound)
+    : options_(std::move(options)), outbound_(outbound), poll_limit_(options_.max_batch),
+      poll_wait_(options_.poll_wait) {}
+
+ShardWorkerGateway::~ShardWorkerGateway() { Disconnect(); }
+
+std::vector<core::Update> ShardWorkerGateway::PollUpdates() {
+  core::UpdateBatch batch;
+  PollBatch(batch);
+  std::vector<core::Update> updates;
+  updates.reserve(batch.size());
+  for (const auto &update : batch) {
+    updates.push_back(core::ToUpdate(update));
+  }
+  return updates;
+}
+
+void ShardWorkerGateway::SetPollOptions(const core::PollOptions &options) {
+  poll_limit_ = std::min(static_cast<std::size_t>(std::max(1, options.limit)), options_.max_batch);
+  poll_wait_ = std::min<std::chrono::milliseconds>(options.timeout, options_.poll_wait);
+}
+
+bool ShardWorkerGateway::TakeUpdates(core::UpdateBatch &batch) {
+  core::UpdateView update;
+  while (batch.size() < poll_limit_) {
+    std::optional<Frame> frame;
+    try {
+      frame = reader_.Next();
+    } catch (const std::exception &) {
+      return false;
+    }
+    if (!frame.has_value()) {
+      return true;
+    }
+    if (frame->type != FrameType::kUpdate || !DecodeUpdate(frame->payload, update)) {
+      return false;
+    }
+    // Already polled by this process: it is acknowledged once handled.
+    if (update.update_id <= delivered_through_) {
+      continue;
+    }
+    delivered_through_ = update.update_id;
+    batch.Add(update.update_id, update.chat_id, update.text, update.date);
+  }
+  return true;
+}
+
+void ShardWorkerGateway::SendMessage(const core::OutgoingMessage &message) {
+  if (outbound_ != nullptr) {
+    outbound_->SendMessage(message);
+    return;
+  }
+  std::string frame;
+  AppendReplyFrame(frame, message);
+  std::lock_guard lock(write_mutex_);
+  outbox_.push_back(std::move(frame));
+  FlushOutboxLocked();
+}
+
+void ShardWorkerGateway::SendMessageAsync(const core::OutgoingMessage &message,
+                                          core::SendCallback done) {
+  if (outbound_ != nullptr) {
+    outbound_->SendMessageAsync(message, std::move(done));
+    return;
+  }
+  TelegramGateway::SendMessageAsync(message, std::move(done));
+}
+
+void ShardWorkerGateway::FlushSends() {
+  if (outbound_ != nullptr) {
+    outbound_->FlushSends();
+  }
+}
+
+void ShardWorkerGateway::CommitUpdates(std::int64_t next_offset) {
+  std::lock_guard lock(write_mutex_);
+  if (next_offset <= acked_) {
+    return;
+  }
+  acked_ = next_offset;
+  // Sent again on reconnect when the front is unreachable now.
+  if (fd_ >= 0 && !broken_ && outbox_.empty()) {
+    std::string frame;
+    AppendAckFrame(frame, acked_);
+    WriteLocked(frame);
+  }
+}
+
+bool ShardWorkerGateway::Connected() const {
+  std::lock_guard lock(write_mutex_);
+  return fd_ >= 0 && !broken_;
+}
+
+void ShardWorkerGateway::FlushOutboxLocked() {
+  while (fd_ >= 0 && !broken_ && !outbox_.empty()) {
+    if (!WriteLocked(outbox_.front())) {
+      return;
+    }
+    outbox_.pop_front();
+  }
+}
+
+#ifdef _WIN32
+
+void ShardWorkerGateway::PollBatch(core::UpdateBatch &) {
+  std::this_thread::sleep_for(poll_wait_);
+}
+
+bool ShardWorkerGateway::Connect() { return false; }
+
+void ShardWorkerGateway::Disconnect() {}
+
+bool ShardWorkerGateway::WriteLocked(std::string_view) { return false; }
+
+#else
+
+void ShardWorkerGateway::PollBatch(core::UpdateBatch &batch) {
+  const auto deadline = std::chrono::steady_clock::now() + poll_wait_;
+  if (fd_ < 0 && !Connect()) {
+    std::this_thread::sleep_for(std::min(options_.reconnect_interval, poll_wait_));
+    return;
+  }
+  if (!TakeUpdates(batch)) {
+    Disconnect();
+    return;
+  }
+  char chunk[65536];
+  while (batch.empty()) {
+    const auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+        deadline - std::chrono::steady_clock::now());
+    pollfd ready{.fd = fd_, .events = POLLIN, .revents = 0};
+    const int events =
+        poll(&ready, 1, static_cast<int>(std::max<std::int64_t>(0, remaining.count())));
+    if (events < 0 && errno == EINTR) {
+      continue;
+    }
+    if (events <= 0) {
+      return;
+    }
+    const ssize_t received = recv(fd_, chunk, sizeof(chunk), 0);
+    if (received < 0 && errno == EINTR) {
+      continue;
+    }
+    if (received <= 0) {
+      Disconnect();
+      return;
+    }
+    reader_.Append(std::string_view(chunk, static_cast<std::size_t>(received)));
+    if (!TakeUpdates(batch)) {
+      Disconnect();
+      return;
+    }
+  }
+}
+
+bool ShardWorkerGateway::Connect() {
+  sockaddr_un address{};
+  address.sun_family = AF_UNIX;
+  if (options_.socket_path.empty() || options_.socket_path.size() >= sizeof(address.sun_path)) {
+    return false;
+  }
+  std::memcpy(address.sun_path, options_.socket_path.c_str(), options_.socket_path.size() + 1);
+  const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  if (connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+    close(fd);
+    return false;
+  }
+
+  std::lock_guard lock(write_mutex_);
+  fd_ = fd;
+  broken_ = false;
+  reader_ = FrameReader{};
+  std::string hello;
+  AppendHelloFrame(hello, Hello{.shard = options_.shard, .shards = options_.shards});
+  if (!WriteLocked(hello)) {
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+  // Replies held while disconnected, then the latest acknowledgement, which
+  // the previous connection may have lost.
+  FlushOutboxLocked();
+  if (acked_ > 0 && outbox_.empty()) {
+    std::string ack;
+    AppendAckFrame(ack, acked_);
+    WriteLocked(ack);
+  }
+  return true;
+}
+
+void ShardWorkerGateway::Disconnect() {
+  std::lock_guard lock(write_mutex_);
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+  broken_ = false;
+}
+
+bool ShardWorkerGateway::WriteLocked(std::string_view bytes) {
+  while (!bytes.empty()) {
+    const ssize_t written = send(fd_, bytes.data(), bytes.size(), MSG_NOSIGNAL);
+    if (written < 0 && errno == EINTR) {
+      continue;
+    }
+    if (written <= 0) {
+      // A partly written frame is dropped by the front with the connection.
+      broken_ = true;
+      shutdown(fd_, SHUT_RDWR);
+      return false;
+    }
+    bytes.remove_prefix(static_cast<std::size_t>(written));
+  }
+  return true;
+}
+
+#endif
+
+} // namespace vertel::adapters::shard
@@ -1,5 +1,7 @@
 #include "vertel/adapters/telegram/telegram_client.hpp"
 
+#include "vertel/adapters/telegram/update_decoder.hpp"
+
 #if VERTEL_HAS_LIBCURL
 #include <curl/curl.h>
 #else
@@ -9,6 +11,10 @@
 #endif
 
 #include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <exception>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
 #include <string>
@@ -32,21 +38,175 @@ size_t WriteBody(char *ptr, size_t size, size_t nmemb, void *userdata) {
   out->append(ptr, size * nmemb);
   return size * nmemb;
 }
+
+// Write target for PostForm: feeds a decoder when the status is a success,
+// otherwise keeps the body for the error message.
+struct StreamTarget {
+  CURL *curl{nullptr};
+  UpdateStreamDecoder *decoder{nullptr};
+  std::string *body{nullptr};
+  bool status_checked{false};
+  bool streaming{false};
+  std::exception_ptr error;
+  std::chrono::nanoseconds decode_time{0};
+};
+
+size_t WriteStream(char *ptr, size_t size, size_t nmemb, void *userdata) {
+  auto *target = static_cast<StreamTarget *>(userdata);
+  const std::size_t bytes = size * nmemb;
+  if (!target->status_checked) {
+    long status_code = 0;
+    curl_easy_getinfo(target->curl, CURLINFO_RESPONSE_CODE, &status_code);
+    target->status_checked = true;
+    target->streaming = status_code < 400;
+  }
+  if (!target->streaming) {
+    target->body->append(ptr, bytes);
+    return bytes;
+  }
+  try {
+    const auto started = std::chrono::steady_clock::now();
+    target->decoder->Feed(std::string_view(ptr, bytes));
+    target->decode_time += std::chrono::steady_clock::now() - started;
+  } catch (...) {
+    // Exceptions must not cross curl's C frames; abort the transfer instead.
+    target->error = std::current_exception();
+    return 0;
+  }
+  return bytes;
+}
 #endif
 
+// vertel_telegram_requests_total{endpoint, status}; status is "error" when no
+// HTTP response arrived.
+void CountRequest(vertel::runtime::MetricsRegistry *metrics, std::string_view endpoint,
+                  long status_code) {
+  if (metrics == nullptr) {
+    return;
+  }
+  metrics
+      ->GetCounter("vertel_telegram_requests_total", "Bot API requests by method and HTTP status",
+                   {{"endpoint", std::string(endpoint)},
+                    {"status", status_code > 0 ? std::to_string(status_code) : "error"}})
+      .Increment();
+}
+
+std::string ErrorMessage(long status_code, const std::string &description) {
+  std::string message = "telegram http status " + std::to_string(status_code);
+  if (!description.empty()) {
+    message += ": " + description;
+  }
+  return message;
+}
+
 } // namespace
 
+TelegramApiError::TelegramApiError(long status_code, std::string description,
+                                   std::chrono::seconds retry_after)
+    : std::runtime_error(ErrorMessage(status_code, description)), status_code_(status_code),
+      description_(std::move(description)), retry_after_(retry_after) {}
+
+TelegramApiError ParseApiError(long status_code, std::string_view body) {
+  // Error responses are rare and small, so the DOM parser is fine here.
+  const auto payload = nlohmann::json::parse(body, nullptr, /*allow_exceptions=*/false);
+  if (!payload.is_object()) {
+    return TelegramApiError(status_code, std::string(body), std::chrono::seconds(0));
+  }
+  std::string description;
+  if (const auto it = payload.find("description"); it != payload.end() && it->is_string()) {
+    description = it->get<std::string>();
+  }
+  std::chrono::seconds retry_after{0};
+  if (const auto params = payload.find("parameters");
+      params != payload.end() && params->is_object()) {
+    if (const auto it = params->find("retry_after");
+        it != params->end() && it->is_number_integer()) {
+      retry_after = std::chrono::seconds(std::max<std::int64_t>(0, it->get<std::int64_t>()));
+    }
+  }
+  return TelegramApiError(status_code, std::move(description), retry_after);
+}
+
+vertel::runtime::RetryOutcome RetryOutcomeFor(const std::exception &error) {
+  if (const auto *api = dynamic_cast<const TelegramApiError *>(&error); api != nullptr) {
+    return vertel::runtime::RetryOutcome{.ok = false,
+                                         .retryable = api->retryable(),
+                                         .retry_after = api->retry_after(),
+                                         .error = api->what()};
+  }
+  return vertel::runtime::RetryOutcome{.ok = false, .error = error.what()};
+}
+
 TelegramClient::TelegramClient(bool inject_sample_update)
-    : inject_sample_update_(inject_sample_update) {}
+    : inject_sample_update_(inject_sample_update), api_base_(kTelegramApiBase) {}
+
+TelegramClient::TelegramClient(std::string bot_token, int long_poll_timeout_seconds,
+                               int request_timeout_seconds,
+                               std::shared_ptr<HttpConnectionPool> pool,
+                               std::size_t max_in_flight_sends,
+                               vertel::runtime::MetricsRegistry *metrics)
+    : bot_token_(std::move(bot_token)), api_base_(kTelegramApiBase),
+      long_poll_timeout_seconds_(std::max(1, long_poll_timeout_seconds)),
+      request_timeout_seconds_(std::max(5, request_timeout_seconds)),
+      poll_options_{.timeout = std::chrono::seconds(long_poll_timeout_seconds_)},
+      pool_(pool != nullptr ? std::move(pool) : std::make_shared<HttpConnectionPool>()),
+      metrics_(metrics) {
+#if VERTEL_HAS_LIBCURL
+  sender_ = std::make_unique<AsyncSender>(
+      pool_, AsyncSender::Options{.max_in_flight = max_in_flight_sends,
+                                  .request_timeout_seconds = request_timeout_seconds_});
+#else
+  (void)max_in_flight_sends;
+#endif
+}
 
 TelegramClient::TelegramClient(std::string bot_token, int long_poll_timeout_seconds,
-                               int request_timeout_seconds)
-    : bot_token_(std::move(bot_token)),
+                               int request_timeout_seconds,
+                               std::shared_ptr<HttpConnectionPool> pool,
+                               std::shared_ptr<AsyncSender> sender,
+                               vertel::runtime::MetricsRegistry *metrics)
+    : bot_token_(std::move(bot_token)), api_base_(kTelegramApiBase),
       long_poll_timeout_seconds_(std::max(1, long_poll_timeout_seconds)),
-      request_timeout_seconds_(std::max(5, request_timeout_seconds)) {}
+      request_timeout_seconds_(std::max(5, request_timeout_seconds)),
+      poll_options_{.timeout = std::chrono::seconds(long_poll_timeout_seconds_)},
+      pool_(pool != nullptr ? std::move(pool) : std::make_shared<HttpConnectionPool>()),
+      sender_(std::move(sender)), metrics_(metrics) {}
+
+// Callbacks of sends still on a shared sender refer to this client.
+TelegramClient::~TelegramClient() { FlushSends(); }
+
+void TelegramClient::SetWebhook(const std::string &url, const std::string &secret_token) {
+  if (bot_token_.empty()) {
+    throw std::runtime_error("TELEGRAM_BOT_TOKEN is required");
+  }
+  std::string fields = "url=" + UrlEncode(url) + "&allowed_updates=%5B%22message%22%5D";
+  if (!secret_token.empty()) {
+    fields += "&secret_token=" + UrlEncode(secret_token);
+  }
+  (void)PostForm("setWebhook", fields);
+}
+
+void TelegramClient::SetApiBase(std::string api_base) {
+  while (!api_base.empty() && api_base.back() == '/') {
+    api_base.pop_back();
+  }
+  api_base_ = api_base.empty() ? kTelegramApiBase : std::move(api_base);
+}
+
+std::string TelegramClient::MethodUrl(const std::string &endpoint) const {
+  return api_base_ + "/bot" + bot_token_ + "/" + endpoint;
+}
+
+std::size_t TelegramClient::Warmup(std::size_t connections) {
+  if (bot_token_.empty() || pool_ == nullptr) {
+    return 0;
+  }
+  return pool_->Warmup(MethodUrl("getMe"), connections);
+}
 
 TelegramClient::HttpResponse TelegramClient::PostForm(const std::string &endpoint,
-                                                      const std::string &form_body) const {
+                                                      const std::string &form_body,
+                                                      UpdateStreamDecoder *decoder) const {
 #if !VERTEL_HAS_LIBCURL
   HINTERNET hSession = WinHttpOpen(L"VerTel-Bot/1.0", WINHTTP_ACCESS_TYPE_DEFAULT_PROXY,
                                    WINHTTP_NO_PROXY_NAME, WINHTTP_NO_PROXY_BYPASS, 0);
@@ -114,136 +274,126 @@ TelegramClient::HttpResponse TelegramClient::PostForm(const std::string &endpoin
   WinHttpCloseHandle(hConnect);
   WinHttpCloseHandle(hSession);
 
+  CountRequest(metrics_, endpoint, static_cast<long>(statusCode));
   if (statusCode >= 400) {
-    std::ostringstream oss;
-    oss << "telegram http status " << statusCode << " body: " << response_body;
-    throw std::runtime_error(oss.str());
+    throw ParseApiError(static_cast<long>(statusCode), response_body);
+  }
+
+  std::chrono::nanoseconds decode_time{0};
+  if (decoder != nullptr) {
+    const auto started = std::chrono::steady_clock::now();
+    decoder->Feed(response_body);
+    decoder->Finish();
+    decode_time = std::chrono::steady_clock::now() - started;
+    response_body.clear();
   }
 
   return HttpResponse{.status_code = static_cast<long>(statusCode),
-                      .body = std::move(response_body)};
+                      .body = std::move(response_body),
+                      .decode_time = decode_time};
 #else
-  CURL *curl = curl_easy_init();
-  if (curl == nullptr) {
+  auto lease = pool_->Acquire();
+  if (!lease) {
     throw std::runtime_error("curl_easy_init failed");
   }
+  auto *curl = static_cast<CURL *>(lease.handle());
 
   std::string response_body;
-  const std::string url = std::string(kTelegramApiBase) + "/bot" + bot_token_ + "/" + endpoint;
+  const std::string url = MethodUrl(endpoint);
 
   curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
   curl_easy_setopt(curl, CURLOPT_POST, 1L);
   curl_easy_setopt(curl, CURLOPT_POSTFIELDS, form_body.c_str());
   curl_easy_setopt(curl, CURLOPT_POSTFIELDSIZE, static_cast<long>(form_body.size()));
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteBody);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_body);
+  StreamTarget stream{.curl = curl,
+                      .decoder = decoder,
+                      .body = &response_body,
+                      .status_checked = false,
+                      .streaming = false,
+                      .error = nullptr,
+                      .decode_time = {}};
+  if (decoder != nullptr) {
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteStream);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &stream);
+  } else {
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteBody);
+    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_body);
+  }
   curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 10L);
   curl_easy_setopt(curl, CURLOPT_TIMEOUT, static_cast<long>(request_timeout_seconds_));
   curl_easy_setopt(curl, CURLOPT_USERAGENT, "vertel-bot/1.0");
 
   const CURLcode code = curl_easy_perform(curl);
+  if (stream.error) {
+    std::rethrow_exception(stream.error);
+  }
   if (code != CURLE_OK) {
+    CountRequest(metrics_, endpoint, 0);
     const std::string error = curl_easy_strerror(code);
-    curl_easy_cleanup(curl);
     throw std::runtime_error("telegram http error: " + error);
   }
 
   long status_code = 0;
   curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status_code);
-  curl_easy_cleanup(curl);
+  CountRequest(metrics_, endpoint, status_code);
 
   if (status_code >= 400) {
-    std::ostringstream oss;
-    oss << "telegram http status " << status_code;
-    throw std::runtime_error(oss.str());
+    throw ParseApiError(status_code, response_body);
+  }
+  if (decoder != nullptr) {
+    const auto started = std::chrono::steady_clock::now();
+    decoder->Finish();
+    stream.decode_time += std::chrono::steady_clock::now() - started;
   }
 
-  return HttpResponse{.status_code = status_code, .body = std::move(response_body)};
+  return HttpResponse{.status_code = status_code,
+                      .body = std::move(response_body),
+                      .decode_time = stream.decode_time};
 #endif
 }
 
-std::vector<vertel::core::Update> TelegramClient::ParseUpdates(const std::string &json) const {
-  nlohmann::json payload;
-  try {
-    payload = nlohmann::json::parse(json);
-  } catch (const nlohmann::json::parse_error &ex) {
-    throw std::runtime_error(std::string("telegram response parse error: ") + ex.what());
-  }
-
-  if (!payload.value("ok", false)) {
-    throw std::runtime_error("telegram response not ok");
+std::string TelegramClient::UrlEncode(const std::string &value) {
+  // Encoded by hand rather than with curl_easy_escape, which needs a throwaway
+  // easy handle per call.
+  static constexpr char kHex[] = "0123456789ABCDEF";
+  std::string escaped;
+  escaped.reserve(value.size() * 3);
+  for (const unsigned char c : value) {
+    if (std::isalnum(c) != 0 || c == '-' || c == '_' || c == '.' || c == '~') {
+      escaped.push_back(static_cast<char>(c));
+    } else {
+      escaped.push_back('%');
+      escaped.push_back(kHex[c >> 4]);
+      escaped.push_back(kHex[c & 0x0F]);
+    }
   }
+  return escaped;
+}
 
-  const auto result_it = payload.find("result");
-  if (result_it == payload.end() || !result_it->is_array()) {
-    return {};
+std::string TelegramClient::GetUpdatesFields() const {
+  std::ostringstream fields;
+  fields << "timeout=" << poll_options_.timeout.count() << "&limit=" << poll_options_.limit
+         << "&allowed_updates=%5B%22message%22%5D";
+  if (next_update_offset_ > 0) {
+    fields << "&offset=" << next_update_offset_;
   }
+  return fields.str();
+}
 
-  std::vector<vertel::core::Update> updates;
-  for (const auto &item : *result_it) {
-    try {
-      if (!item.is_object()) {
-        continue;
-      }
-      const auto message_it = item.find("message");
-      if (message_it == item.end() || !message_it->is_object()) {
-        continue;
-      }
-      const auto chat_it = message_it->find("chat");
-      if (chat_it == message_it->end() || !chat_it->is_object()) {
-        continue;
-      }
-      const auto text_it = message_it->find("text");
-      if (text_it == message_it->end() || !text_it->is_string()) {
-        continue;
-      }
-
-      const auto update_id_it = item.find("update_id");
-      const auto chat_id_it = chat_it->find("id");
-      if (update_id_it == item.end() || chat_id_it == chat_it->end() ||
-          !update_id_it->is_number_integer() || !chat_id_it->is_number_integer()) {
-        continue;
-      }
-
-      updates.push_back(vertel::core::Update{.update_id = update_id_it->get<std::int64_t>(),
-                                             .chat_id = chat_id_it->get<std::int64_t>(),
-                                             .text = text_it->get<std::string>()});
-    } catch (const nlohmann::json::exception &) {
-      continue;
-    }
+bool TelegramClient::FetchUpdates(UpdateSink &sink) {
+  if (bot_token_.empty()) {
+    return false;
   }
 
-  return updates;
-}
-
-std::string TelegramClient::UrlEncode(const std::string &value) {
-#if !VERTEL_HAS_LIBCURL
-  std::ostringstream escaped;
-  escaped.fill('0');
-  escaped << std::hex;
-  for (unsigned char c : value) {
-    if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
-      escaped << c;
-    } else {
-      escaped << std::uppercase << '%' << std::setw(2) << int((unsigned char)c);
-    }
+  UpdateStreamDecoder decoder(sink);
+  const auto started = std::chrono::steady_clock::now();
+  const HttpResponse response = PostForm("getUpdates", GetUpdatesFields(), &decoder);
+  if (metrics_ != nullptr) {
+    metrics_->ObserveLatency(vertel::runtime::LatencyStage::kPoll,
+                             std::chrono::steady_clock::now() - started);
+    metrics_->ObserveLatency(vertel::runtime::LatencyStage::kParse, response.decode_time);
   }
-  return escaped.str();
-#else
-  CURL *curl = curl_easy_init();
-  if (curl == nullptr) {
-    throw std::runtime_error("curl_easy_init failed for encode");
-  }
-  char *escaped = curl_easy_escape(curl, value.c_str(), static_cast<int>(value.size()));
-  if (escaped == nullptr) {
-    curl_easy_cleanup(curl);
-    throw std::runtime_error("curl_easy_escape failed");
-  }
-  std::string encoded(escaped);
-  curl_free(escaped);
-  curl_easy_cleanup(curl);
-  return encoded;
-#endif
+  return true;
 }
 
 std::vector<vertel::core::Update> TelegramClient::PollUpdates() {
@@ -251,27 +401,94 @@ std::vector<vertel::core::Update> TelegramClient::PollUpdates() {
     sample_emitted_ = true;
     return {vertel::core::Update{.update_id = 1, .chat_id = 1001, .text = "/start"}};
   }
-  if (bot_token_.empty()) {
+
+  std::vector<vertel::core::Update> updates;
+  UpdateCollector collector(updates);
+  if (!FetchUpdates(collector)) {
     return {};
   }
+  for (const auto &update : updates) {
+    next_update_offset_ = std::max(next_update_offset_, update.update_id + 1);
+  }
+  return updates;
+}
 
-  std::ostringstream fields;
-  fields << "timeout=" << long_poll_timeout_seconds_ << "&allowed_updates=%5B%22message%22%5D";
-  if (next_update_offset_ > 0) {
-    fields << "&offset=" << next_update_offset_;
+void TelegramClient::PollBatch(vertel::core::UpdateBatch &batch) {
+  if (inject_sample_update_ && !sample_emitted_) {
+    sample_emitted_ = true;
+    batch.Add(1, 1001, "/start");
+    return;
   }
 
-  const auto response = PostForm("getUpdates", fields.str());
-  auto updates = ParseUpdates(response.body);
-  for (const auto &update : updates) {
+  UpdateBatchCollector collector(batch);
+  if (!FetchUpdates(collector)) {
+    return;
+  }
+  for (const auto &update : batch) {
     next_update_offset_ = std::max(next_update_offset_, update.update_id + 1);
   }
-  return updates;
+}
+
+void TelegramClient::PollBatchAsync(AsyncSender &poller, vertel::core::UpdateBatch &batch,
+                                    std::function<void(std::exception_ptr error)> done) {
+  if (inject_sample_update_ || bot_token_.empty()) {
+    std::exception_ptr error;
+    try {
+      PollBatch(batch);
+    } catch (...) {
+      error = std::current_exception();
+    }
+    done(error);
+    return;
+  }
+
+  // Unlike PollBatch(), the body is decoded once it is complete: the poller
+  // buffers responses.
+  poller.Submit(
+      MethodUrl("getUpdates"), GetUpdatesFields(),
+      [this, &batch, done = std::move(done),
+       started = std::chrono::steady_clock::now()](AsyncSender::Response response) {
+        std::exception_ptr error;
+        try {
+          CountRequest(metrics_, "getUpdates",
+                       response.error.empty() ? response.status_code : 0);
+          if (!response.error.empty()) {
+            throw std::runtime_error("telegram http error: " + response.error);
+          }
+          if (response.status_code >= 400) {
+            throw ParseApiError(response.status_code, response.body);
+          }
+          const auto received = std::chrono::steady_clock::now();
+          UpdateBatchCollector collector(batch);
+          UpdateStreamDecoder decoder(collector);
+          decoder.Feed(response.body);
+          decoder.Finish();
+          if (metrics_ != nullptr) {
+            metrics_->ObserveLatency(vertel::runtime::LatencyStage::kPoll, received - started);
+            metrics_->ObserveLatency(vertel::runtime::LatencyStage::kParse,
+                                     std::chrono::steady_clock::now() - received);
+          }
+          for (const auto &update : batch) {
+            next_update_offset_ = std::max(next_update_offset_, update.update_id + 1);
+          }
+        } catch (...) {
+          batch.Clear();
+          error = std::current_exception();
+        }
+        done(error);
+      });
+}
+
+void TelegramClient::SetPollOptions(const vertel::core::PollOptions &options) {
+  poll_options_.limit = std::clamp(options.limit, 1, 100);
+  poll_options_.timeout = std::clamp<std::chrono::seconds>(
+      options.timeout, std::chrono::seconds(0), std::chrono::seconds(long_poll_timeout_seconds_));
 }
 
 void TelegramClient::SendMessage(const vertel::core::OutgoingMessage &message) {
-  sent_messages_.push_back(message);
   if (inject_sample_update_) {
+    std::scoped_lock lock(sent_mutex_);
+    sent_messages_.push_back(message);
     return;
   }
   if (bot_token_.empty()) {
@@ -280,7 +497,79 @@ void TelegramClient::SendMessage(const vertel::core::OutgoingMessage &message) {
 
   std::ostringstream fields;
   fields << "chat_id=" << message.chat_id << "&text=" << UrlEncode(message.text);
+  const auto started = std::chrono::steady_clock::now();
   (void)PostForm("sendMessage", fields.str());
+  if (metrics_ != nullptr) {
+    metrics_->ObserveLatency(vertel::runtime::LatencyStage::kSend,
+                             std::chrono::steady_clock::now() - started);
+  }
+}
+
+void TelegramClient::SendMessageAsync(const vertel::core::OutgoingMessage &message,
+                                      vertel::core::SendCallback done) {
+  if (sender_ == nullptr || inject_sample_update_ || bot_token_.empty()) {
+    TelegramGateway::SendMessageAsync(message, std::move(done));
+    return;
+  }
+
+  std::ostringstream fields;
+  fields << "chat_id=" << message.chat_id << "&text=" << UrlEncode(message.text);
+  {
+    std::scoped_lock lock(sends_mutex_);
+    ++pending_sends_;
+  }
+  // Keyed by chat so replies to one chat keep their order on the wire.
+  sender_->Submit(
+      MethodUrl("sendMessage"), fields.str(),
+      [this, message, done = std::move(done), metrics = metrics_,
+       started = std::chrono::steady_clock::now()](AsyncSender::Response response) {
+        if (metrics != nullptr) {
+          metrics->ObserveLatency(vertel::runtime::LatencyStage::kSend,
+                                  std::chrono::steady_clock::now() - started);
+        }
+        CountRequest(metrics, "sendMessage", response.error.empty() ? response.status_code : 0);
+        vertel::core::SendResult result{.ok = response.error.empty() &&
+                                              response.status_code < 400,
+                                        .status_code = response.status_code,
+                                        .error = {},
+                                        .retry_after = {}};
+        if (!response.error.empty()) {
+          result.error = "telegram http error: " + response.error;
+        } else if (!result.ok) {
+          const TelegramApiError error = ParseApiError(response.status_code, response.body);
+          result.error = error.what();
+          result.retry_after = error.retry_after();
+        }
+        if (done) {
+          try {
+            done(message, result);
+          } catch (...) {
+          }
+        }
+        std::scoped_lock lock(sends_mutex_);
+        if (--pending_sends_ == 0) {
+          sends_idle_.notify_all();
+        }
+      },
+      message.chat_id);
+}
+
+void TelegramClient::FlushSends() {
+  std::unique_lock lock(sends_mutex_);
+  sends_idle_.wait(lock, [this] { return pending_sends_ == 0; });
+}
+
+void TelegramClient::UseCheckpoint(vertel::runtime::OffsetCheckpoint *checkpoint) {
+  checkpoint_ = checkpoint;
+  if (checkpoint_ != nullptr) {
+    next_update_offset_ = std::max(next_update_offset_, checkpoint_->Load());
+  }
+}
+
+void TelegramClient::CommitUpdates(std::int64_t next_offset) {
+  if (checkpoint_ != nullptr) {
+    checkpoint_->Commit(next_offset);
+  }
 }
 
 const std::vector<vertel::core::OutgoingMessage> &TelegramClient::SentMessages() const {
@@ -0,0 +1,524 @@
+#include "vertel/adapters/telegram/update_decoder.hpp"
+
+#include <charconv>
+#include <stdexcept>
+#include <utility>
+
+namespace vertel::adapters::telegram {
+namespace {
+
+constexpr std::size_t kMaxDepth = 256;
+
+bool IsWhitespace(char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+
+bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+bool IsValidNumber(std::string_view number, bool &is_integer) {
+  std::size_t i = 0;
+  const auto digits = [&] {
+    const std::size_t start = i;
+    while (i < number.size() && IsDigit(number[i])) {
+      ++i;
+    }
+    return i - start;
+  };
+
+  if (i < number.size() && number[i] == '-') {
+    ++i;
+  }
+  if (i < number.size() && number[i] == '0') {
+    ++i;
+  } else if (digits() == 0) {
+    return false;
+  }
+  is_integer = true;
+  if (i < number.size() && number[i] == '.') {
+    ++i;
+    is_integer = false;
+    if (digits() == 0) {
+      return false;
+    }
+  }
+  if (i < number.size() && (number[i] == 'e' || number[i] == 'E')) {
+    ++i;
+    is_integer = false;
+    if (i < number.size() && (number[i] == '+' || number[i] == '-')) {
+      ++i;
+    }
+    if (digits() == 0) {
+      return false;
+    }
+  }
+  return i == number.size();
+}
+
+} // namespace
+
+UpdateStreamDecoder::UpdateStreamDecoder(UpdateSink &sink, Mode mode) : sink_(sink), mode_(mode) {
+  stack_.reserve(8);
+}
+
+void UpdateStreamDecoder::Reset() {
+  stack_.clear();
+  expect_ = Expect::kValue;
+  lex_ = Lex::kStructure;
+  string_target_ = StringTarget::kDiscard;
+  key_.clear();
+  text_.clear();
+  number_.clear();
+  high_surrogate_ = 0;
+  ok_ = false;
+  has_update_id_ = has_chat_id_ = has_text_ = false;
+}
+
+void UpdateStreamDecoder::Fail(const char *what) {
+  throw std::runtime_error(std::string("telegram response parse error: ") + what);
+}
+
+void UpdateStreamDecoder::Feed(std::string_view chunk) {
+  std::size_t i = 0;
+  const std::size_t n = chunk.size();
+  while (i < n) {
+    switch (lex_) {
+    case Lex::kStructure:
+      Structural(chunk[i++]);
+      break;
+
+    case Lex::kString: {
+      // Copy the run up to the next quote, escape or control byte in one go.
+      const std::size_t start = i;
+      while (i < n) {
+        const auto c = static_cast<unsigned char>(chunk[i]);
+        if (c == '"' || c == '\\' || c < 0x20) {
+          break;
+        }
+        ++i;
+      }
+      AppendString(chunk.substr(start, i - start));
+      if (i == n) {
+        return;
+      }
+      const char c = chunk[i++];
+      if (c == '"') {
+        EndString();
+      } else if (c == '\\') {
+        lex_ = Lex::kEscape;
+      } else {
+        Fail("control character in string");
+      }
+      break;
+    }
+
+    case Lex::kEscape: {
+      const char c = chunk[i++];
+      char decoded = 0;
+      switch (c) {
+      case '"':
+      case '\\':
+      case '/':
+        decoded = c;
+        break;
+      case 'b':
+        decoded = '\b';
+        break;
+      case 'f':
+        decoded = '\f';
+        break;
+      case 'n':
+        decoded = '\n';
+        break;
+      case 'r':
+        decoded = '\r';
+        break;
+      case 't':
+        decoded = '\t';
+        break;
+      case 'u':
+        lex_ = Lex::kUnicode;
+        unicode_value_ = 0;
+        unicode_digits_ = 0;
+        continue;
+      default:
+        Fail("invalid escape");
+      }
+      AppendString(std::string_view(&decoded, 1));
+      lex_ = Lex::kString;
+      break;
+    }
+
+    case Lex::kUnicode: {
+      const int value = HexValue(chunk[i++]);
+      if (value < 0) {
+        Fail("invalid \\u escape");
+      }
+      unicode_value_ = (unicode_value_ << 4) | static_cast<std::uint32_t>(value);
+      if (++unicode_digits_ < 4) {
+        break;
+      }
+      if (high_surrogate_ != 0) {
+        if (unicode_value_ < 0xDC00 || unicode_value_ > 0xDFFF) {
+          Fail("unpaired surrogate");
+        }
+        AppendCodePoint(0x10000 + ((high_surrogate_ - 0xD800) << 10) + (unicode_value_ - 0xDC00));
+        high_surrogate_ = 0;
+        lex_ = Lex::kString;
+      } else if (unicode_value_ >= 0xD800 && unicode_value_ <= 0xDBFF) {
+        high_surrogate_ = unicode_value_;
+        lex_ = Lex::kLowSurrogateBackslash;
+      } else if (unicode_value_ >= 0xDC00 && unicode_value_ <= 0xDFFF) {
+        Fail("unpaired surrogate");
+      } else {
+        AppendCodePoint(unicode_value_);
+        lex_ = Lex::kString;
+      }
+      break;
+    }
+
+    case Lex::kLowSurrogateBackslash:
+      if (chunk[i++] != '\\') {
+        Fail("unpaired surrogate");
+      }
+      lex_ = Lex::kLowSurrogateU;
+      break;
+
+    case Lex::kLowSurrogateU:
+      if (chunk[i++] != 'u') {
+        Fail("unpaired surrogate");
+      }
+      lex_ = Lex::kUnicode;
+      unicode_value_ = 0;
+      unicode_digits_ = 0;
+      break;
+
+    case Lex::kNumber: {
+      const std::size_t start = i;
+      while (i < n && (IsDigit(chunk[i]) || chunk[i] == '-' || chunk[i] == '+' ||
+                       chunk[i] == '.' || chunk[i] == 'e' || chunk[i] == 'E')) {
+        ++i;
+      }
+      number_.append(chunk.data() + start, i - start);
+      if (i < n) {
+        // The terminating byte is structural; leave it for the next iteration.
+        EndNumber();
+      }
+      break;
+    }
+
+    case Lex::kLiteral:
+      if (chunk[i++] != literal_[literal_pos_]) {
+        Fail("invalid literal");
+      }
+      if (++literal_pos_ == literal_.size()) {
+        EndLiteral();
+      }
+      break;
+    }
+  }
+}
+
+void UpdateStreamDecoder::Finish() {
+  if (lex_ == Lex::kNumber && stack_.empty()) {
+    EndNumber();
+  }
+  if (lex_ != Lex::kStructure || expect_ != Expect::kDone) {
+    Fail("unexpected end of input");
+  }
+  if (mode_ == Mode::kGetUpdatesResponse && !ok_) {
+    throw std::runtime_error("telegram response not ok");
+  }
+}
+
+void UpdateStreamDecoder::Structural(char c) {
+  if (IsWhitespace(c)) {
+    return;
+  }
+
+  switch (expect_) {
+  case Expect::kFirstValueOrEnd:
+    if (c == ']') {
+      CloseContainer();
+      return;
+    }
+    [[fallthrough]];
+  case Expect::kValue:
+    BeginValue(c);
+    return;
+
+  case Expect::kFirstKeyOrEnd:
+    if (c == '}') {
+      CloseContainer();
+      return;
+    }
+    [[fallthrough]];
+  case Expect::kKey:
+    if (c != '"') {
+      Fail("expected object key");
+    }
+    key_.clear();
+    string_target_ = StringTarget::kKey;
+    lex_ = Lex::kString;
+    return;
+
+  case Expect::kColon:
+    if (c != ':') {
+      Fail("expected ':'");
+    }
+    expect_ = Expect::kValue;
+    return;
+
+  case Expect::kCommaOrEnd: {
+    const bool is_object = stack_.back().is_object;
+    if (c == ',') {
+      expect_ = is_object ? Expect::kKey : Expect::kValue;
+      return;
+    }
+    if (c == (is_object ? '}' : ']')) {
+      CloseContainer();
+      return;
+    }
+    Fail("expected ',' or closing bracket");
+  }
+
+  case Expect::kDone:
+    Fail("trailing characters after document");
+  }
+}
+
+void UpdateStreamDecoder::BeginValue(char c) {
+  switch (c) {
+  case '{':
+    OpenContainer(/*is_object=*/true);
+    return;
+  case '[':
+    OpenContainer(/*is_object=*/false);
+    return;
+  case '"': {
+    const bool is_text = !stack_.empty() && stack_.back().context == Context::kMessage &&
+                         stack_.back().key == Key::kText;
+    if (is_text) {
+      text_.clear();
+    }
+    string_target_ = is_text ? StringTarget::kText : StringTarget::kDiscard;
+    lex_ = Lex::kString;
+    return;
+  }
+  case 't':
+    literal_ = "true";
+    break;
+  case 'f':
+    literal_ = "false";
+    break;
+  case 'n':
+    literal_ = "null";
+    break;
+  default:
+    if (c == '-' || IsDigit(c)) {
+      number_.assign(1, c);
+      lex_ = Lex::kNumber;
+      return;
+    }
+    Fail("unexpected character");
+  }
+  literal_pos_ = 1;
+  lex_ = Lex::kLiteral;
+}
+
+void UpdateStreamDecoder::OpenContainer(bool is_object) {
+  if (stack_.size() >= kMaxDepth) {
+    Fail("nesting too deep");
+  }
+
+  Context context = Context::kOther;
+  if (stack_.empty()) {
+    if (is_object) {
+      context = mode_ == Mode::kGetUpdatesResponse ? Context::kRoot : Context::kUpdate;
+    }
+  } else {
+    const Frame &parent = stack_.back();
+    if (parent.context == Context::kRoot && parent.key == Key::kResult && !is_object) {
+      context = Context::kResult;
+    } else if (parent.context == Context::kResult && is_object) {
+      context = Context::kUpdate;
+    } else if (parent.context == Context::kUpdate && parent.key == Key::kMessage && is_object) {
+      context = Context::kMessage;
+    } else if (parent.context == Context::kMessage && parent.key == Key::kChat && is_object) {
+      context = Context::kChat;
+    }
+  }
+
+  if (context == Context::kUpdate) {
+    has_update_id_ = has_chat_id_ = has_text_ = false;
+    date_ = 0;
+  }
+  stack_.push_back(Frame{.context = context, .is_object = is_object, .key = Key::kNone});
+  expect_ = is_object ? Expect::kFirstKeyOrEnd : Expect::kFirstValueOrEnd;
+}
+
+void UpdateStreamDecoder::CloseContainer() {
+  const Context context = stack_.back().context;
+  stack_.pop_back();
+  if (context == Context::kUpdate && has_update_id_ && has_chat_id_ && has_text_) {
+    sink_.OnUpdate(vertel::core::UpdateView{
+        .update_id = update_id_, .chat_id = chat_id_, .text = text_, .date = date_});
+  }
+  ValueDone();
+}
+
+void UpdateStreamDecoder::ValueDone() {
+  expect_ = stack_.empty() ? Expect::kDone : Expect::kCommaOrEnd;
+}
+
+void UpdateStreamDecoder::EndString() {
+  lex_ = Lex::kStructure;
+  if (string_target_ == StringTarget::kKey) {
+    Frame &frame = stack_.back();
+    frame.key = Key::kNone;
+    switch (frame.context) {
+    case Context::kRoot:
+      frame.key = key_ == "ok" ? Key::kOk : key_ == "result" ? Key::kResult : Key::kNone;
+      break;
+    case Context::kUpdate:
+      frame.key = key_ == "update_id" ? Key::kUpdateId
+                  : key_ == "message" ? Key::kMessage
+                                      : Key::kNone;
+      break;
+    case Context::kMessage:
+      frame.key = key_ == "chat"   ? Key::kChat
+                  : key_ == "text" ? Key::kText
+                  : key_ == "date" ? Key::kDate
+                                   : Key::kNone;
+      break;
+    case Context::kChat:
+      frame.key = key_ == "id" ? Key::kId : Key::kNone;
+      break;
+    case Context::kResult:
+    case Context::kOther:
+      break;
+    }
+    expect_ = Expect::kColon;
+    return;
+  }
+  OnScalar(/*is_integer=*/false, 0, /*is_true=*/false, /*is_string=*/true);
+}
+
+void UpdateStreamDecoder::EndNumber() {
+  lex_ = Lex::kStructure;
+  bool is_integer = false;
+  if (!IsValidNumber(number_, is_integer)) {
+    Fail("invalid number");
+  }
+  std::int64_t value = 0;
+  if (is_integer) {
+    const auto [ptr, ec] = std::from_chars(number_.data(), number_.data() + number_.size(), value);
+    is_integer = ec == std::errc{};
+  }
+  OnScalar(is_integer, value, /*is_true=*/false, /*is_string=*/false);
+}
+
+void UpdateStreamDecoder::EndLiteral() {
+  lex_ = Lex::kStructure;
+  OnScalar(/*is_integer=*/false, 0, /*is_true=*/literal_ == "true", /*is_string=*/false);
+}
+
+void UpdateStreamDecoder::OnScalar(bool is_integer, std::int64_t integer, bool is_true,
+                                   bool is_string) {
+  if (!stack_.empty()) {
+    const Frame &frame = stack_.back();
+    switch (frame.context) {
+    case Context::kRoot:
+      if (frame.key == Key::kOk) {
+        ok_ = is_true;
+      }
+      break;
+    case Context::kUpdate:
+      if (frame.key == Key::kUpdateId) {
+        has_update_id_ = is_integer;
+        update_id_ = integer;
+      }
+      break;
+    case Context::kMessage:
+      if (frame.key == Key::kText) {
+        has_text_ = is_string;
+      } else if (frame.key == Key::kDate && is_integer) {
+        date_ = integer;
+      }
+      break;
+    case Context::kChat:
+      if (frame.key == Key::kId) {
+        has_chat_id_ = is_integer;
+        chat_id_ = integer;
+      }
+      break;
+    case Context::kResult:
+    case Context::kOther:
+      break;
+    }
+  }
+  ValueDone();
+}
+
+void UpdateStreamDecoder::AppendString(std::string_view bytes) {
+  if (string_target_ == StringTarget::kKey) {
+    key_.append(bytes);
+  } else if (string_target_ == StringTarget::kText) {
+    text_.append(bytes);
+  }
+}
+
+void UpdateStreamDecoder::AppendCodePoint(std::uint32_t code_point) {
+  char utf8[4];
+  std::size_t length = 0;
+  if (code_point < 0x80) {
+    utf8[length++] = static_cast<char>(code_point);
+  } else if (code_point < 0x800) {
+    utf8[length++] = static_cast<char>(0xC0 | (code_point >> 6));
+    utf8[length++] = static_cast<char>(0x80 | (code_point & 0x3F));
+  } else if (code_point < 0x10000) {
+    utf8[length++] = static_cast<char>(0xE0 | (code_point >> 12));
+    utf8[length++] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    utf8[length++] = static_cast<char>(0x80 | (code_point & 0x3F));
+  } else {
+    utf8[length++] = static_cast<char>(0xF0 | (code_point >> 18));
+    utf8[length++] = static_cast<char>(0x80 | ((code_point >> 12) & 0x3F));
+    utf8[length++] = static_cast<char>(0x80 | ((code_point >> 6) & 0x3F));
+    utf8[length++] = static_cast<char>(0x80 | (code_point & 0x3F));
+  }
+  AppendString(std::string_view(utf8, length));
+}
+
+std::vector<vertel::core::Update> DecodeGetUpdatesResponse(std::string_view json) {
+  std::vector<vertel::core::Update> updates;
+  UpdateCollector collector(updates);
+  UpdateStreamDecoder decoder(collector);
+  decoder.Feed(json);
+  decoder.Finish();
+  return updates;
+}
+
+std::optional<vertel::core::Update> DecodeUpdate(std::string_view json) {
+  std::vector<vertel::core::Update> updates;
+  UpdateCollector collector(updates);
+  UpdateStreamDecoder decoder(collector, UpdateStreamDecoder::Mode::kSingleUpdate);
+  decoder.Feed(json);
+  decoder.Finish();
+  if (updates.empty()) {
+    return std::nullopt;
+  }
+  return std::move(updates.front());
+}
+
+} // namespace vertel::adapters::telegram
@@ -0,0 +1,116 @@
+#include "vertel/adapters/telegram/webhook_gateway.hpp"
+
+#include <algorithm>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <optional>
+#include <utility>
+
+#include "vertel/adapters/telegram/update_decoder.hpp"
+
+namespace vertel::adapters::telegram {
+
+WebhookGateway::WebhookGateway(Options options, vertel::core::TelegramGateway &outbound)
+    : options_(std::move(options)), outbound_(outbound), poll_limit_(options_.max_batch),
+      poll_wait_(options_.poll_wait),
+      server_(runtime::HttpServer::Options{.port = options_.port,
+                                           .threads = options_.listener_threads},
+              [this](const runtime::HttpRequest &request, runtime::HttpResponse &response) {
+                HandleRequest(request, response);
+              }) {}
+
+WebhookGateway::~WebhookGateway() { Stop(); }
+
+bool WebhookGateway::Start() { return server_.Start(); }
+
+void WebhookGateway::Stop() {
+  server_.Stop();
+  cv_.notify_all();
+}
+
+void WebhookGateway::HandleRequest(const runtime::HttpRequest &request,
+                                   runtime::HttpResponse &response) {
+  if (request.path != options_.path) {
+    response = runtime::HttpResponse{.status_code = 404, .body = "not found\n"};
+    return;
+  }
+  if (request.method != "POST") {
+    response = runtime::HttpResponse{.status_code = 405, .body = "method not allowed\n"};
+    return;
+  }
+  if (!options_.secret_token.empty() &&
+      request.Header("X-Telegram-Bot-Api-Secret-Token") != options_.secret_token) {
+    response = runtime::HttpResponse{.status_code = 403, .body = "forbidden\n"};
+    return;
+  }
+
+  std::optional<vertel::core::Update> update;
+  try {
+    update = DecodeUpdate(request.body);
+  } catch (const std::exception &) {
+    response = runtime::HttpResponse{.status_code = 400, .body = "bad request\n"};
+    return;
+  }
+
+  if (update.has_value()) {
+    std::scoped_lock lock(mutex_);
+    if (queue_.size() >= options_.max_queued_updates) {
+      response = runtime::HttpResponse{.status_code = 503, .body = "busy\n"};
+      return;
+    }
+    queue_.push_back(std::move(*update));
+  }
+  // Updates without a text message are acknowledged too, so Telegram drops them.
+  cv_.notify_one();
+  response = runtime::HttpResponse{.status_code = 200, .body = {}};
+}
+
+std::vector<vertel::core::Update> WebhookGateway::PollUpdates() {
+  std::unique_lock lock(mutex_);
+  cv_.wait_for(lock, poll_wait_, [this] { return !queue_.empty(); });
+
+  const auto count = std::min(queue_.size(), poll_limit_);
+  std::vector<vertel::core::Update> updates;
+  updates.reserve(count);
+  std::move(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count),
+            std::back_inserter(updates));
+  queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+  return updates;
+}
+
+void WebhookGateway::PollBatch(vertel::core::UpdateBatch &batch) {
+  std::unique_lock lock(mutex_);
+  cv_.wait_for(lock, poll_wait_, [this] { return !queue_.empty(); });
+
+  const auto count = std::min(queue_.size(), poll_limit_);
+  for (std::size_t i = 0; i < count; ++i) {
+    const auto &update = queue_[i];
+    batch.Add(update.update_id, update.chat_id, update.text, update.date);
+  }
+  queue_.erase(queue_.begin(), queue_.begin() + static_cast<std::ptrdiff_t>(count));
+}
+
+void WebhookGateway::SetPollOptions(const vertel::core::PollOptions &options) {
+  std::lock_guard lock(mutex_);
+  poll_limit_ = std::min(static_cast<std::size_t>(std::max(1, options.limit)), options_.max_batch);
+  poll_wait_ = std::min<std::chrono::milliseconds>(options.timeout, options_.poll_wait);
+}
+
+void WebhookGateway::SendMessage(const vertel::core::OutgoingMessage &message) {
+  outbound_.SendMessage(message);
+}
+
+void WebhookGateway::SendMessageAsync(const vertel::core::OutgoingMessage &message,
+                                      vertel::core::SendCallback done) {
+  outbound_.SendMessageAsync(message, std::move(done));
+}
+
+void WebhookGateway::FlushSends() { outbound_.FlushSends(); }
+
+std::size_t WebhookGateway::QueuedUpdates() const {
+  std::scoped_lock lock(mutex_);
+  return queue_.size();
+}
+
+} // namespace vertel::adapters::telegram
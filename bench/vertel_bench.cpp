@@ -0,0 +1,525 @@
+// Microbenchmarks for the per-update hot paths, with machine-readable output.
+//
+//   vertel_bench [--filter=SUBSTRING] [--min-time-ms=N] [--repetitions=N] [--out=FILE] [--list]
+//
+// Every case is calibrated until one run lasts --min-time-ms, then run
+// --repetitions times; the median, minimum and maximum time per iteration are
+// reported. Results are one JSON document on stdout (or in --out) and progress
+// goes to stderr, so runs of two releases can be stored and compared.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "vertel/adapters/telegram/update_decoder.hpp"
+#include "vertel/core/bot_service.hpp"
+#include "vertel/core/command_handler.hpp"
+#include "vertel/core/rate_limiter.hpp"
+#include "vertel/runtime/logger.hpp"
+#include "vertel/runtime/metrics.hpp"
+#include "vertel/vertel_version.h"
+
+#ifndef VERTEL_BENCH_BUILD_TYPE
+#define VERTEL_BENCH_BUILD_TYPE ""
+#endif
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Keeps results observable so the optimiser cannot drop the measured work.
+volatile std::uint64_t g_sink = 0;
+
+// The measured part of a case: runs the given number of iterations.
+using Loop = std::function<void(std::uint64_t iterations)>;
+
+struct Case {
+  std::string name;
+  // Operations (updates, Allow() calls, log lines) one iteration performs.
+  std::uint64_t items_per_iteration{1};
+  // Input or output bytes of one iteration; 0 when not meaningful.
+  std::uint64_t bytes_per_iteration{0};
+  // Builds the case's state and returns the loop to time; neither this nor
+  // destroying the loop afterwards is part of the measurement.
+  std::function<Loop()> setup;
+};
+
+struct Result {
+  const Case *benchmark;
+  std::uint64_t iterations;
+  double ns_median;
+  double ns_min;
+  double ns_max;
+};
+
+// --- Payloads --------------------------------------------------------------
+
+// A getUpdates response as the Bot API sends it: full sender and chat objects
+// and entities, of which the decoder only keeps a few fields.
+std::string GetUpdatesPayload(int updates) {
+  std::string body = R"({"ok":true,"result":[)";
+  for (int i = 0; i < updates; ++i) {
+    if (i > 0) {
+      body += ',';
+    }
+    const std::string id = std::to_string(100000 + i % 97);
+    body += R"({"update_id":)" + std::to_string(734500000 + i) +
+            R"(,"message":{"message_id":)" + std::to_string(5000 + i) +
+            R"(,"from":{"id":)" + id +
+            R"(,"is_bot":false,"first_name":"Ada","last_name":"Lovelace","username":"ada_l",)"
+            R"("language_code":"en"},"chat":{"id":)" +
+            id +
+            R"(,"first_name":"Ada","last_name":"Lovelace","username":"ada_l","type":"private"},)"
+            R"("date":1700000000,"text":"/echo café \"quoted\" text #)" +
+            std::to_string(i) + R"(","entities":[{"offset":0,"length":5,"type":"bot_command"}]}})";
+  }
+  body += "]}";
+  return body;
+}
+
+// --- In-memory collaborators -----------------------------------------------
+
+class NullStreamBuf final : public std::streambuf {
+protected:
+  int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+  std::streamsize xsputn(const char *, std::streamsize count) override { return count; }
+};
+
+// Serves the same updates on every poll, with fresh ids, and discards replies.
+class InMemoryGateway final : public vertel::core::TelegramGateway {
+public:
+  explicit InMemoryGateway(std::vector<vertel::core::Update> updates)
+      : updates_(std::move(updates)) {}
+
+  std::vector<vertel::core::Update> PollUpdates() override { return updates_; }
+  void PollBatch(vertel::core::UpdateBatch &batch) override {
+    for (const auto &update : updates_) {
+      batch.Add(next_id_++, update.chat_id, update.text, update.date);
+    }
+  }
+  void SendMessage(const vertel::core::OutgoingMessage &message) override {
+    g_sink = g_sink + message.text.size();
+  }
+
+private:
+  std::vector<vertel::core::Update> updates_;
+  std::int64_t next_id_{1};
+};
+
+class EchoArgsHandler final : public vertel::core::CommandHandler {
+public:
+  std::optional<vertel::core::OutgoingMessage> Handle(const vertel::core::Update &) override {
+    return std::nullopt;
+  }
+  std::optional<vertel::core::OutgoingMessage>
+  HandleCommand(const vertel::core::UpdateView &update,
+                const vertel::core::CommandView &command) override {
+    return vertel::core::OutgoingMessage{.chat_id = update.chat_id,
+                                         .text = std::string(command.args)};
+  }
+};
+
+// --- Cases -----------------------------------------------------------------
+
+void AddDecoderCases(std::vector<Case> &cases) {
+  for (const int updates : {1, 10, 100}) {
+    auto payload = std::make_shared<const std::string>(GetUpdatesPayload(updates));
+    cases.push_back(
+        {.name = "update_decoder/updates:" + std::to_string(updates),
+         .items_per_iteration = static_cast<std::uint64_t>(updates),
+         .bytes_per_iteration = payload->size(),
+         .setup = [payload] {
+           struct State {
+             vertel::core::UpdateBatch batch;
+             vertel::adapters::telegram::UpdateBatchCollector collector{batch};
+             vertel::adapters::telegram::UpdateStreamDecoder decoder{collector};
+           };
+           return Loop([payload, state = std::make_shared<State>()](std::uint64_t iterations) {
+             // curl hands the body over in chunks of up to 16 KiB.
+             constexpr std::size_t kChunk = 16 * 1024;
+             for (std::uint64_t i = 0; i < iterations; ++i) {
+               state->batch.Clear();
+               state->decoder.Reset();
+               for (std::size_t at = 0; at < payload->size(); at += kChunk) {
+                 state->decoder.Feed(std::string_view(*payload).substr(at, kChunk));
+               }
+               state->decoder.Finish();
+               g_sink = g_sink + state->batch.size();
+             }
+           });
+         }});
+  }
+}
+
+void AddRouterCases(std::vector<Case> &cases) {
+  for (const int handlers : {3, 50, 500}) {
+    cases.push_back(
+        {.name = "command_router/handlers:" + std::to_string(handlers),
+         .setup = [handlers] {
+           struct State {
+             EchoArgsHandler echo;
+             vertel::runtime::MetricsRegistry metrics;
+             vertel::core::CommandRouter router{{}, "vertel_bot", &metrics};
+             vertel::core::UpdateBatch batch;
+           };
+           auto state = std::make_shared<State>();
+           for (int h = 0; h < handlers; ++h) {
+             state->router.Register("command" + std::to_string(h), state->echo);
+           }
+           for (int u = 0; u < 256; ++u) {
+             const int command = (u * 7919) % handlers;
+             state->batch.Add(u, 1000 + u,
+                              "/command" + std::to_string(command) + " some arguments");
+           }
+           return Loop([state](std::uint64_t iterations) {
+             for (std::uint64_t i = 0; i < iterations; ++i) {
+               const auto reply = state->router.HandleView(state->batch[i & 255]);
+               g_sink = g_sink + (reply.has_value() ? reply->text.size() : 0);
+             }
+           });
+         }});
+  }
+}
+
+void AddRateLimiterCases(std::vector<Case> &cases) {
+  const std::size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (std::size_t threads = 1; threads <= max_threads; threads *= 2) {
+    for (const bool shared : {false, true}) {
+      cases.push_back(
+          {.name = "rate_limiter/threads:" + std::to_string(threads) +
+                   (shared ? "/chats:shared" : "/chats:disjoint"),
+           .items_per_iteration = threads,
+           .setup = [threads, shared] {
+             auto limiter = std::make_shared<vertel::core::TokenBucketRateLimiter>(
+                 20, 20, std::chrono::seconds(1));
+             return Loop([threads, shared, limiter](std::uint64_t iterations) {
+               // Disjoint: 1000 chats per thread. Shared: 16 chats all threads hit.
+               const auto work = [&](std::size_t t) {
+                 const std::int64_t base = shared ? 0 : static_cast<std::int64_t>(t) * 1000;
+                 const std::int64_t span = shared ? 16 : 1000;
+                 std::uint64_t allowed = 0;
+                 for (std::uint64_t i = 0; i < iterations; ++i) {
+                   allowed += limiter->Allow(base + static_cast<std::int64_t>(i % span)) ? 1 : 0;
+                 }
+                 g_sink = g_sink + allowed;
+               };
+               if (threads == 1) {
+                 work(0);
+                 return;
+               }
+               std::vector<std::thread> workers;
+               for (std::size_t t = 0; t < threads; ++t) {
+                 workers.emplace_back(work, t);
+               }
+               for (auto &worker : workers) {
+                 worker.join();
+               }
+             });
+           }});
+    }
+  }
+}
+
+void AddLoggerCases(std::vector<Case> &cases) {
+  using vertel::runtime::LogLevel;
+  const auto log_case = [](std::string name, vertel::runtime::LoggerOptions options,
+                           LogLevel level) {
+    return Case{.name = std::move(name),
+                .setup = [options, level] {
+                  struct State {
+                    explicit State(const vertel::runtime::LoggerOptions &options)
+                        : logger(out, options) {}
+                    NullStreamBuf buffer;
+                    std::ostream out{&buffer};
+                    vertel::runtime::Logger logger;
+                  };
+                  auto state = std::make_shared<State>(options);
+                  return Loop([state, level](std::uint64_t iterations) {
+                    // What a VERTEL_LOG_* call does for a level it did not compile out.
+                    for (std::uint64_t i = 0; i < iterations; ++i) {
+                      if (state->logger.Enabled(level)) {
+                        state->logger.Log(level, "update_handled",
+                                          {{"component", "bot"},
+                                           {"chat_id", static_cast<std::int64_t>(i)},
+                                           {"latency_ms", 1.25},
+                                           {"cached", true}});
+                      }
+                    }
+                    // Async lines count once they have been written.
+                    state->logger.Flush();
+                  });
+                }};
+  };
+  cases.push_back(log_case("logger/sync", {}, LogLevel::kInfo));
+  cases.push_back(log_case(
+      "logger/async",
+      {.async = true, .overflow = vertel::runtime::LogOverflowPolicy::kBlock}, LogLevel::kInfo));
+  cases.push_back(log_case("logger/disabled_level", {}, LogLevel::kDebug));
+}
+
+void AddMetricsCases(std::vector<Case> &cases) {
+  // The built-in families plus per-command series for 50 commands, as a
+  // production bot exposes them.
+  auto metrics = std::make_shared<vertel::runtime::MetricsRegistry>();
+  for (int c = 0; c < 50; ++c) {
+    const std::string command = "command" + std::to_string(c);
+    metrics->GetCounter("vertel_commands_total", "Commands handled", {{"command", command}})
+        .Increment(static_cast<std::uint64_t>(c) * 13);
+    auto &histogram = metrics->GetHistogram("vertel_command_duration_seconds",
+                                            "Command handling time", {{"command", command}});
+    for (int r = 1; r <= 100; ++r) {
+      histogram.Record(std::chrono::microseconds(r * (c + 1)));
+    }
+  }
+  for (int i = 0; i < 1000; ++i) {
+    metrics->IncrementUpdatesProcessed();
+    metrics->ObserveLatency(vertel::runtime::LatencyStage::kHandle,
+                            std::chrono::microseconds(10 + i));
+  }
+
+  for (const bool open_metrics : {false, true}) {
+    std::string body;
+    metrics->WriteExposition(body, open_metrics);
+    cases.push_back({.name = open_metrics ? "metrics_exposition/openmetrics"
+                                          : "metrics_exposition/prometheus",
+                     .bytes_per_iteration = body.size(),
+                     .setup = [metrics, open_metrics] {
+                       return Loop([metrics, open_metrics](std::uint64_t iterations) {
+                         std::string out;
+                         for (std::uint64_t i = 0; i < iterations; ++i) {
+                           metrics->WriteExposition(out, open_metrics);
+                           g_sink = g_sink + out.size();
+                         }
+                       });
+                     }});
+  }
+}
+
+void AddBotServiceCases(std::vector<Case> &cases) {
+  for (const int updates : {1, 10, 100}) {
+    cases.push_back(
+        {.name = "bot_service/process_once/updates:" + std::to_string(updates),
+         .items_per_iteration = static_cast<std::uint64_t>(updates),
+         .setup = [updates] {
+           // The reference bot's chain: rate limit, admin guard, router.
+           struct State {
+             explicit State(std::vector<vertel::core::Update> polled)
+                 : gateway(std::move(polled)) {
+               router.Register("start", start);
+               router.Register("help", help);
+               router.Register("ping", ping);
+             }
+             InMemoryGateway gateway;
+             vertel::runtime::MetricsRegistry metrics;
+             vertel::core::StartCommandHandler start;
+             vertel::core::HelpCommandHandler help;
+             vertel::core::PingCommandHandler ping;
+             vertel::core::CommandRouter router{{}, "vertel_bot", &metrics};
+             vertel::core::AdminWhitelistCommandHandler admin{router, {}};
+             vertel::core::TokenBucketRateLimiter limiter{1000000, 1000000,
+                                                          std::chrono::seconds(1)};
+             vertel::core::RateLimitedCommandHandler guarded{admin, limiter, "Slow down.",
+                                                             &metrics};
+             vertel::core::BotService bot{gateway, guarded, &metrics};
+           };
+           std::vector<vertel::core::Update> polled;
+           const char *texts[] = {"/ping", "/start", "/help@vertel_bot", "hello there"};
+           for (int u = 0; u < updates; ++u) {
+             polled.push_back({.chat_id = 1000 + u % 37, .text = texts[u % 4]});
+           }
+           auto state = std::make_shared<State>(std::move(polled));
+           return Loop([state](std::uint64_t iterations) {
+             for (std::uint64_t i = 0; i < iterations; ++i) {
+               state->bot.ProcessOnce();
+             }
+           });
+         }});
+  }
+}
+
+// --- Runner ----------------------------------------------------------------
+
+double TimeRun(const Case &benchmark, std::uint64_t iterations) {
+  const Loop loop = benchmark.setup();
+  const auto started = Clock::now();
+  loop(iterations);
+  return std::chrono::duration<double, std::nano>(Clock::now() - started).count();
+}
+
+Result Measure(const Case &benchmark, double min_time_ns, int repetitions) {
+  // Grow the iteration count until one run lasts min_time, at most 10x a step.
+  std::uint64_t iterations = 1;
+  double elapsed = TimeRun(benchmark, iterations);
+  while (elapsed < min_time_ns) {
+    const double scale = elapsed > 0 ? 1.2 * min_time_ns / elapsed : 10.0;
+    iterations = std::max(iterations + 1,
+                          static_cast<std::uint64_t>(static_cast<double>(iterations) *
+                                                     std::min(10.0, scale)));
+    elapsed = TimeRun(benchmark, iterations);
+  }
+
+  std::vector<double> per_iteration{elapsed / static_cast<double>(iterations)};
+  for (int r = 1; r < repetitions; ++r) {
+    per_iteration.push_back(TimeRun(benchmark, iterations) / static_cast<double>(iterations));
+  }
+  std::sort(per_iteration.begin(), per_iteration.end());
+  return Result{.benchmark = &benchmark,
+                .iterations = iterations,
+                .ns_median = per_iteration[per_iteration.size() / 2],
+                .ns_min = per_iteration.front(),
+                .ns_max = per_iteration.back()};
+}
+
+std::string UtcNow() {
+  const std::time_t now = std::time(nullptr);
+  std::tm tm{};
+#if defined(_WIN32)
+  gmtime_s(&tm, &now);
+#else
+  gmtime_r(&now, &tm);
+#endif
+  char buffer[32];
+  return std::string(buffer, std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &tm));
+}
+
+std::string Compiler() {
+#if defined(__clang__)
+  return "clang " __clang_version__;
+#elif defined(__GNUC__)
+  return "gcc " __VERSION__;
+#elif defined(_MSC_VER)
+  return "msvc " + std::to_string(_MSC_FULL_VER);
+#else
+  return "unknown";
+#endif
+}
+
+void WriteJson(std::ostream &out, const std::vector<Result> &results, double min_time_ms,
+               int repetitions) {
+  out << std::fixed << std::setprecision(1) << "{\n  \"context\": {\n"
+      << "    \"vertel_version\": \"" << VERTEL_VERSION_STRING << "\",\n"
+      << "    \"build_type\": \"" << VERTEL_BENCH_BUILD_TYPE << "\",\n"
+      << "    \"compiler\": \"" << Compiler() << "\",\n"
+#ifdef NDEBUG
+      << "    \"assertions\": false,\n"
+#else
+      << "    \"assertions\": true,\n"
+#endif
+      << "    \"hardware_concurrency\": " << std::thread::hardware_concurrency() << ",\n"
+      << "    \"date\": \"" << UtcNow() << "\",\n"
+      << "    \"min_time_ms\": " << min_time_ms << ",\n"
+      << "    \"repetitions\": " << repetitions << "\n  },\n  \"benchmarks\": [";
+  for (std::size_t i = 0; i < results.size(); ++i) {
+    const Result &result = results[i];
+    const Case &benchmark = *result.benchmark;
+    const double seconds = result.ns_median / 1e9;
+    out << (i == 0 ? "\n" : ",\n") << "    {\"name\": \"" << benchmark.name << "\""
+        << ", \"iterations\": " << result.iterations
+        << ", \"ns_per_iteration\": " << result.ns_median
+        << ", \"ns_per_iteration_min\": " << result.ns_min
+        << ", \"ns_per_iteration_max\": " << result.ns_max
+        << ", \"items_per_iteration\": " << benchmark.items_per_iteration
+        << ", \"items_per_second\": "
+        << static_cast<double>(benchmark.items_per_iteration) / seconds;
+    if (benchmark.bytes_per_iteration > 0) {
+      out << ", \"bytes_per_second\": "
+          << static_cast<double>(benchmark.bytes_per_iteration) / seconds;
+    }
+    out << "}";
+  }
+  out << "\n  ]\n}\n";
+}
+
+int Usage(const char *program) {
+  std::cerr << "usage: " << program
+            << " [--filter=SUBSTRING] [--min-time-ms=N] [--repetitions=N] [--out=FILE]"
+               " [--list]\n";
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  std::string filter;
+  std::string out_path;
+  double min_time_ms = 200;
+  int repetitions = 5;
+  bool list = false;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const auto value = [&arg](std::string_view flag) -> std::optional<std::string> {
+      if (arg.substr(0, flag.size()) != flag) {
+        return std::nullopt;
+      }
+      return std::string(arg.substr(flag.size()));
+    };
+    if (auto v = value("--filter=")) {
+      filter = *v;
+    } else if (auto v = value("--min-time-ms=")) {
+      min_time_ms = std::max(1.0, std::strtod(v->c_str(), nullptr));
+    } else if (auto v = value("--repetitions=")) {
+      repetitions = std::max(1, std::atoi(v->c_str()));
+    } else if (auto v = value("--out=")) {
+      out_path = *v;
+    } else if (arg == "--list") {
+      list = true;
+    } else {
+      return Usage(argv[0]);
+    }
+  }
+
+  std::vector<Case> cases;
+  AddDecoderCases(cases);
+  AddRouterCases(cases);
+  AddRateLimiterCases(cases);
+  AddLoggerCases(cases);
+  AddMetricsCases(cases);
+  AddBotServiceCases(cases);
+  std::erase_if(cases, [&filter](const Case &benchmark) {
+    return benchmark.name.find(filter) == std::string::npos;
+  });
+
+  if (list) {
+    for (const auto &benchmark : cases) {
+      std::cout << benchmark.name << '\n';
+    }
+    return 0;
+  }
+
+  std::vector<Result> results;
+  for (const auto &benchmark : cases) {
+    results.push_back(Measure(benchmark, min_time_ms * 1e6, repetitions));
+    std::fprintf(stderr, "%-48s %14.1f ns/iter %16.0f items/s\n", benchmark.name.c_str(),
+                 results.back().ns_median,
+                 static_cast<double>(benchmark.items_per_iteration) * 1e9 /
+                     results.back().ns_median);
+  }
+
+  if (out_path.empty()) {
+    WriteJson(std::cout, results, min_time_ms, repetitions);
+    return 0;
+  }
+  std::ofstream file(out_path);
+  if (!file) {
+    std::cerr << "cannot write " << out_path << '\n';
+    return 1;
+  }
+  WriteJson(file, results, min_time_ms, repetitions);
+  return 0;
+}
@@ -0,0 +1,327 @@
+// End-to-end load generator: a MockBotApi fed with /ping updates at a fixed
+// rate, optionally with a bot process pointed at it.
+//
+//   vertel_loadgen [--rate=N] [--duration-s=N] [--chats=N] [--distribution=uniform|zipf|hot]
+//                  [--latency-ms=N] [--throttle-ratio=R] [--report-interval-s=N] [--port=N]
+//                  [--bot-pid=PID] [-- BOT_COMMAND [ARGS...]]
+//
+// A bot command is started with TELEGRAM_BOT_TOKEN and VERTEL_TELEGRAM_API_BASE
+// set for the mock, and with outbound pacing and the health port disabled
+// unless the environment already sets them. Without one, point a bot at the
+// printed base URL and pass --bot-pid to sample its memory.
+//
+// Every --report-interval-s one JSON line goes to stdout with the interval's
+// update and reply rates, reply latency quantiles (enqueue to sendMessage),
+// 429s, lost updates, backlog and the bot's RSS; a summary line of the whole
+// run closes the output. Progress and errors go to stderr.
+
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "vertel/runtime/histogram.hpp"
+#include "vertel/runtime/shutdown.hpp"
+#include "vertel/testing/mock_bot_api.hpp"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using vertel::runtime::HistogramSnapshot;
+using vertel::testing::MockBotApi;
+
+constexpr std::int64_t kFirstChatId = 100000;
+// Share of the "hot" distribution sent by its single hot chat.
+constexpr double kHotChatShare = 0.8;
+
+enum class Distribution { kUniform, kZipf, kHot };
+
+struct Settings {
+  double rate{1000};
+  int duration_s{60};
+  int chats{1000};
+  Distribution distribution{Distribution::kUniform};
+  int latency_ms{0};
+  double throttle_ratio{0};
+  int report_interval_s{5};
+  int port{0};
+  pid_t bot_pid{0};
+  std::vector<char *> bot_command;
+};
+
+// Picks the sending chat of each update.
+class ChatPicker {
+public:
+  explicit ChatPicker(const Settings &settings) : settings_(settings), random_(0x10ad) {
+    if (settings.distribution == Distribution::kZipf) {
+      // Zipf with s = 1: chat k is picked with weight 1/k.
+      double total = 0;
+      for (int k = 1; k <= settings.chats; ++k) {
+        total += 1.0 / k;
+        cdf_.push_back(total);
+      }
+      for (auto &value : cdf_) {
+        value /= total;
+      }
+    }
+  }
+
+  std::int64_t Next() {
+    const int chats = settings_.chats;
+    switch (settings_.distribution) {
+    case Distribution::kUniform:
+      return kFirstChatId + std::uniform_int_distribution<int>(0, chats - 1)(random_);
+    case Distribution::kZipf: {
+      const auto it = std::lower_bound(cdf_.begin(), cdf_.end(), unit_(random_));
+      return kFirstChatId + std::min<std::int64_t>(it - cdf_.begin(), chats - 1);
+    }
+    case Distribution::kHot:
+      if (chats == 1 || unit_(random_) < kHotChatShare) {
+        return kFirstChatId;
+      }
+      return kFirstChatId + std::uniform_int_distribution<int>(1, chats - 1)(random_);
+    }
+    return kFirstChatId;
+  }
+
+private:
+  const Settings &settings_;
+  std::mt19937_64 random_;
+  std::uniform_real_distribution<double> unit_{0.0, 1.0};
+  std::vector<double> cdf_;
+};
+
+// Resident set size of `pid` from /proc, 0 when unknown.
+std::uint64_t RssBytes(pid_t pid) {
+  if (pid <= 0) {
+    return 0;
+  }
+  std::ifstream status("/proc/" + std::to_string(pid) + "/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.rfind("VmRSS:", 0) == 0) {
+      return std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+    }
+  }
+  return 0;
+}
+
+// The recordings of `now` that were not yet in `before`.
+HistogramSnapshot Since(const HistogramSnapshot &now, const HistogramSnapshot &before) {
+  HistogramSnapshot delta = now;
+  for (std::size_t i = 0; i < delta.buckets.size() && i < before.buckets.size(); ++i) {
+    delta.buckets[i] -= before.buckets[i];
+  }
+  delta.count -= before.count;
+  delta.sum_ns -= before.sum_ns;
+  return delta;
+}
+
+double Millis(std::uint64_t ns) { return static_cast<double>(ns) / 1e6; }
+
+void WriteLatency(std::ostream &out, const HistogramSnapshot &latency) {
+  out << ",\"p50_ms\":" << Millis(latency.ValueAtQuantile(0.5))
+      << ",\"p99_ms\":" << Millis(latency.ValueAtQuantile(0.99))
+      << ",\"p999_ms\":" << Millis(latency.ValueAtQuantile(0.999));
+}
+
+pid_t StartBot(const Settings &settings, const std::string &base_url) {
+  const pid_t pid = fork();
+  if (pid != 0) {
+    return pid;
+  }
+  setenv("TELEGRAM_BOT_TOKEN", "loadgen:token", 1);
+  setenv("VERTEL_TELEGRAM_API_BASE", base_url.c_str(), 1);
+  setenv("VERTEL_OUTBOUND_MESSAGES_PER_SECOND", "0", 0);
+  setenv("VERTEL_HTTP_PORT", "0", 0);
+  std::vector<char *> argv = settings.bot_command;
+  argv.push_back(nullptr);
+  execvp(argv[0], argv.data());
+  std::cerr << "cannot start " << argv[0] << '\n';
+  _exit(127);
+}
+
+void StopBot(pid_t pid) {
+  kill(pid, SIGTERM);
+  const auto deadline = Clock::now() + std::chrono::seconds(10);
+  while (waitpid(pid, nullptr, WNOHANG) == 0) {
+    if (Clock::now() >= deadline) {
+      kill(pid, SIGKILL);
+      waitpid(pid, nullptr, 0);
+      return;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  }
+}
+
+int Usage(const char *program) {
+  std::cerr << "usage: " << program
+            << " [--rate=N] [--duration-s=N] [--chats=N] [--distribution=uniform|zipf|hot]"
+               " [--latency-ms=N] [--throttle-ratio=R] [--report-interval-s=N] [--port=N]"
+               " [--bot-pid=PID] [-- BOT_COMMAND [ARGS...]]\n";
+  return 2;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Settings settings;
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    const auto value = [&arg](std::string_view flag) -> std::optional<std::string> {
+      if (arg.substr(0, flag.size()) != flag) {
+        return std::nullopt;
+      }
+      return std::string(arg.substr(flag.size()));
+    };
+    if (arg == "--") {
+      settings.bot_command.assign(argv + i + 1, argv + argc);
+      break;
+    }
+    if (auto v = value("--rate=")) {
+      settings.rate = std::max(0.1, std::strtod(v->c_str(), nullptr));
+    } else if (auto v = value("--duration-s=")) {
+      settings.duration_s = std::max(1, std::atoi(v->c_str()));
+    } else if (auto v = value("--chats=")) {
+      settings.chats = std::max(1, std::atoi(v->c_str()));
+    } else if (auto v = value("--distribution=")) {
+      if (*v == "uniform") {
+        settings.distribution = Distribution::kUniform;
+      } else if (*v == "zipf") {
+        settings.distribution = Distribution::kZipf;
+      } else if (*v == "hot") {
+        settings.distribution = Distribution::kHot;
+      } else {
+        return Usage(argv[0]);
+      }
+    } else if (auto v = value("--latency-ms=")) {
+      settings.latency_ms = std::max(0, std::atoi(v->c_str()));
+    } else if (auto v = value("--throttle-ratio=")) {
+      settings.throttle_ratio = std::clamp(std::strtod(v->c_str(), nullptr), 0.0, 1.0);
+    } else if (auto v = value("--report-interval-s=")) {
+      settings.report_interval_s = std::max(1, std::atoi(v->c_str()));
+    } else if (auto v = value("--port=")) {
+      settings.port = std::max(0, std::atoi(v->c_str()));
+    } else if (auto v = value("--bot-pid=")) {
+      settings.bot_pid = static_cast<pid_t>(std::atoi(v->c_str()));
+    } else {
+      return Usage(argv[0]);
+    }
+  }
+
+  MockBotApi api(MockBotApi::Options{
+      .port = settings.port,
+      .latency = std::chrono::milliseconds(settings.latency_ms),
+      .throttle_ratio = settings.throttle_ratio,
+  });
+  if (!api.Start()) {
+    std::cerr << "cannot start the mock Bot API on port " << settings.port << '\n';
+    return 1;
+  }
+  std::cerr << "mock Bot API at " << api.base_url() << '\n';
+
+  vertel::runtime::ShutdownSignal::Install();
+  pid_t bot_pid = settings.bot_pid;
+  bool owns_bot = !settings.bot_command.empty();
+  if (owns_bot) {
+    bot_pid = StartBot(settings, api.base_url());
+    if (bot_pid < 0) {
+      std::cerr << "fork failed\n";
+      return 1;
+    }
+  }
+
+  const auto start = Clock::now();
+  const auto end = start + std::chrono::seconds(settings.duration_s);
+  std::atomic<bool> stop{false};
+  // Paced against the start time, so a late wakeup sends the overdue updates
+  // at once and the long-run rate stays --rate.
+  std::thread generator([&] {
+    ChatPicker picker(settings);
+    const std::chrono::duration<double> period(1.0 / settings.rate);
+    for (std::uint64_t sent = 0; !stop.load(std::memory_order_relaxed);) {
+      const auto due = start + std::chrono::duration_cast<Clock::duration>(period * sent);
+      if (due > Clock::now()) {
+        std::this_thread::sleep_until(std::min(due, Clock::now() + std::chrono::milliseconds(100)));
+        continue;
+      }
+      api.Enqueue(picker.Next(), "/ping");
+      ++sent;
+    }
+  });
+
+  std::cout << std::fixed << std::setprecision(3);
+  MockBotApi::Stats previous = api.Snapshot();
+  std::uint64_t peak_rss = 0;
+  auto report_at = start;
+  auto reported_at = start;
+  int exit_code = 0;
+  while (Clock::now() < end && !vertel::runtime::ShutdownSignal::IsRequested()) {
+    if (owns_bot && waitpid(bot_pid, nullptr, WNOHANG) == bot_pid) {
+      std::cerr << "bot exited early\n";
+      owns_bot = false;
+      exit_code = 1;
+      break;
+    }
+    report_at = std::min(report_at + std::chrono::seconds(settings.report_interval_s), end);
+    while (Clock::now() < report_at && !vertel::runtime::ShutdownSignal::IsRequested()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    const MockBotApi::Stats stats = api.Snapshot();
+    const std::uint64_t rss = RssBytes(bot_pid);
+    peak_rss = std::max(peak_rss, rss);
+    const auto now = Clock::now();
+    const double seconds = std::chrono::duration<double>(now - start).count();
+    const double interval = std::chrono::duration<double>(now - reported_at).count();
+    reported_at = now;
+    std::cout << "{\"t_s\":" << seconds << ",\"updates_per_s\":"
+              << static_cast<double>(stats.updates_delivered - previous.updates_delivered) /
+                     interval
+              << ",\"replies_per_s\":"
+              << static_cast<double>(stats.replies - previous.replies) / interval;
+    WriteLatency(std::cout, Since(stats.reply_latency, previous.reply_latency));
+    std::cout << ",\"throttled\":" << stats.throttled - previous.throttled
+              << ",\"lost\":" << stats.lost - previous.lost << ",\"backlog\":" << stats.backlog
+              << ",\"rss_bytes\":" << rss << "}" << std::endl;
+    previous = stats;
+  }
+
+  stop.store(true, std::memory_order_relaxed);
+  generator.join();
+  const double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  const MockBotApi::Stats total = api.Snapshot();
+  std::cout << "{\"summary\":true,\"duration_s\":" << elapsed
+            << ",\"updates_queued\":" << total.updates_queued
+            << ",\"updates_delivered\":" << total.updates_delivered
+            << ",\"replies\":" << total.replies << ",\"updates_per_s\":"
+            << static_cast<double>(total.updates_delivered) / elapsed
+            << ",\"replies_per_s\":" << static_cast<double>(total.replies) / elapsed;
+  WriteLatency(std::cout, total.reply_latency);
+  std::cout << ",\"throttled\":" << total.throttled
+            << ",\"unmatched_replies\":" << total.unmatched_replies << ",\"lost\":" << total.lost
+            << ",\"backlog\":" << total.backlog << ",\"peak_rss_bytes\":" << peak_rss << "}"
+            << std::endl;
+
+  // Stopping the mock first releases the bot's pending long poll.
+  api.Stop();
+  if (owns_bot) {
+    StopBot(bot_pid);
+  }
+  return exit_code;
+}
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../include/vertel/core/command_view.hpp"
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../include/vertel/core/outbound_scheduler.hpp"
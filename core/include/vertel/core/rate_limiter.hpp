@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../include/vertel/core/rate_limiter.hpp"
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../include/vertel/core/static_command_router.hpp"
@@ -1,77 +1,317 @@
 #include "vertel/core/bot_service.hpp"
 
 #include <algorithm>
-#include <cmath>
+#include <chrono>
 #include <exception>
+#include <stdexcept>
+#include <thread>
 #include <utility>
 
 namespace vertel::core {
+namespace {
+
+// Hands the runs of `updates` that `admit` accepts to `inner` in one
+// HandleBatch() call each and answers the others with `reject(update)`, so
+// replies keep the batch order and no update is copied.
+template <typename Admit, typename Reject>
+void FilterBatch(std::span<const UpdateView> updates, CommandHandler &inner, ReplySink &sink,
+                 Admit admit, Reject reject) {
+  std::size_t run_start = 0;
+  for (std::size_t i = 0; i < updates.size(); ++i) {
+    if (admit(updates[i])) {
+      continue;
+    }
+    if (i > run_start) {
+      inner.HandleBatch(updates.subspan(run_start, i - run_start), sink);
+    }
+    sink.Reply(updates[i], reject(updates[i]));
+    run_start = i + 1;
+  }
+  if (run_start < updates.size()) {
+    inner.HandleBatch(updates.subspan(run_start), sink);
+  }
+}
+
+// Forwards to `out` and notes which updates of `run` were answered, so the
+// router can offer the rest to its fallback chain.
+class AnsweredSink final : public ReplySink {
+public:
+  AnsweredSink(ReplySink &out, std::span<const UpdateView> run)
+      : out_(out), run_(run), answered_(run.size(), 0) {}
+
+  void Reply(const UpdateView &update, OutgoingMessage message) override {
+    Mark(update);
+    out_.Reply(update, std::move(message));
+  }
+  void Fail(const UpdateView &update, const std::exception &error) override {
+    Mark(update);
+    out_.Fail(update, error);
+  }
+
+  bool Answered(std::size_t index) const { return answered_[index] != 0; }
+
+private:
+  void Mark(const UpdateView &update) {
+    if (&update >= run_.data() && &update < run_.data() + run_.size()) {
+      answered_[static_cast<std::size_t>(&update - run_.data())] = 1;
+    }
+  }
+
+  ReplySink &out_;
+  std::span<const UpdateView> run_;
+  std::vector<char> answered_;
+};
+
+// The built-in handlers have no bot username to check a "@bot" suffix
+// against, so on their own they answer only the bare command. Routed through
+// a CommandRouter, the router checks the suffix and calls HandleCommand().
+bool IsBareCommand(const std::optional<CommandView> &command, std::string_view name) {
+  return command.has_value() && command->name == name && command->bot_username.empty();
+}
+
+} // namespace
+
+runtime::Task<std::optional<OutgoingMessage>> CommandHandler::HandleAsync(Update update) {
+  co_return HandleView(AsView(update));
+}
+
+void CommandHandler::HandleBatch(std::span<const UpdateView> updates, ReplySink &sink) {
+  for (const auto &update : updates) {
+    try {
+      if (auto response = HandleView(update); response.has_value()) {
+        sink.Reply(update, std::move(*response));
+      }
+    } catch (const std::exception &ex) {
+      sink.Fail(update, ex);
+    }
+  }
+}
+
+void CommandHandler::HandleCommandBatch(std::span<const UpdateView> updates,
+                                        std::span<const CommandView> commands, ReplySink &sink) {
+  for (std::size_t i = 0; i < updates.size(); ++i) {
+    try {
+      if (auto response = HandleCommand(updates[i], commands[i]); response.has_value()) {
+        sink.Reply(updates[i], std::move(*response));
+      }
+    } catch (const std::exception &ex) {
+      sink.Fail(updates[i], ex);
+    }
+  }
+}
+
+std::optional<OutgoingMessage> AsyncCommandHandler::Handle(const Update &update) {
+  (void)update;
+  throw std::logic_error("AsyncCommandHandler must be dispatched by a BotService with an executor");
+}
 
 std::optional<OutgoingMessage> StartCommandHandler::Handle(const Update &update) {
-  if (update.text == "/start") {
-    return OutgoingMessage{.chat_id = update.chat_id,
-                           .text = "Welcome to VerTel Bot. Ready when you are."};
+  return HandleView(AsView(update));
+}
+
+std::optional<OutgoingMessage> StartCommandHandler::HandleView(const UpdateView &update) {
+  const auto command = ParseCommand(update.text);
+  if (IsBareCommand(command, "start")) {
+    return HandleCommand(update, *command);
   }
   return std::nullopt;
 }
 
+std::optional<OutgoingMessage> StartCommandHandler::HandleCommand(const UpdateView &update,
+                                                                  const CommandView &) {
+  return OutgoingMessage{.chat_id = update.chat_id,
+                         .text = "Welcome to VerTel Bot. Ready when you are."};
+}
+
 std::optional<OutgoingMessage> HelpCommandHandler::Handle(const Update &update) {
-  if (update.text == "/help") {
-    return OutgoingMessage{.chat_id = update.chat_id,
-                           .text = "Available commands: /start, /help, /ping"};
+  return HandleView(AsView(update));
+}
+
+std::optional<OutgoingMessage> HelpCommandHandler::HandleView(const UpdateView &update) {
+  const auto command = ParseCommand(update.text);
+  if (IsBareCommand(command, "help")) {
+    return HandleCommand(update, *command);
   }
   return std::nullopt;
 }
 
+std::optional<OutgoingMessage> HelpCommandHandler::HandleCommand(const UpdateView &update,
+                                                                 const CommandView &) {
+  return OutgoingMessage{.chat_id = update.chat_id,
+                         .text = "Available commands: /start, /help, /ping"};
+}
+
 std::optional<OutgoingMessage> PingCommandHandler::Handle(const Update &update) {
-  if (update.text == "/ping") {
-    return OutgoingMessage{.chat_id = update.chat_id, .text = "pong"};
+  return HandleView(AsView(update));
+}
+
+std::optional<OutgoingMessage> PingCommandHandler::HandleView(const UpdateView &update) {
+  const auto command = ParseCommand(update.text);
+  if (IsBareCommand(command, "ping")) {
+    return HandleCommand(update, *command);
   }
   return std::nullopt;
 }
 
-CommandRouter::CommandRouter(std::vector<std::reference_wrapper<CommandHandler>> handlers)
-    : handlers_(std::move(handlers)) {}
+std::optional<OutgoingMessage> PingCommandHandler::HandleCommand(const UpdateView &update,
+                                                                 const CommandView &) {
+  return OutgoingMessage{.chat_id = update.chat_id, .text = "pong"};
+}
+
+CommandRouter::CommandRouter(std::vector<std::reference_wrapper<CommandHandler>> fallback,
+                             std::string bot_username, runtime::MetricsRegistry *metrics)
+    : fallback_(std::move(fallback)), bot_username_(std::move(bot_username)), metrics_(metrics) {}
+
+void CommandRouter::Register(std::string name, CommandHandler &handler) {
+  Route route{.handler = std::ref(handler)};
+  if (metrics_ != nullptr) {
+    // Resolved once here so dispatch never looks series up.
+    const runtime::MetricLabels labels{{"command", name}};
+    route.calls = &metrics_->GetCounter("vertel_commands_total",
+                                        "Updates routed to each registered command", labels);
+    route.duration = &metrics_->GetHistogram("vertel_command_duration_seconds",
+                                             "Handler time per registered command", labels);
+  }
+  commands_.insert_or_assign(std::move(name), route);
+}
 
 std::optional<OutgoingMessage> CommandRouter::Handle(const Update &update) {
-  for (auto &handler : handlers_) {
-    if (auto response = handler.get().Handle(update); response.has_value()) {
+  return HandleView(AsView(update));
+}
+
+std::optional<OutgoingMessage> CommandRouter::HandleView(const UpdateView &update) {
+  if (!commands_.empty()) {
+    if (const auto command = ParseCommand(update.text); command.has_value()) {
+      if (!IsAddressedTo(*command, bot_username_)) {
+        return std::nullopt;
+      }
+      if (const auto it = commands_.find(command->name); it != commands_.end()) {
+        const Route &route = it->second;
+        const auto started = std::chrono::steady_clock::now();
+        auto response = route.handler.get().HandleCommand(update, *command);
+        if (route.calls != nullptr) {
+          route.calls->Increment();
+          route.duration->Record(std::chrono::steady_clock::now() - started);
+        }
+        if (response.has_value()) {
+          return response;
+        }
+      }
+    }
+  }
+
+  for (auto &handler : fallback_) {
+    if (auto response = handler.get().HandleView(update); response.has_value()) {
       return response;
     }
   }
   return std::nullopt;
 }
 
-TokenBucketRateLimiter::TokenBucketRateLimiter(int capacity, int refill_tokens,
-                                               std::chrono::seconds refill_period)
-    : capacity_(std::max(1, capacity)), refill_tokens_(std::max(1, refill_tokens)),
-      refill_period_(std::max(std::chrono::seconds(1), refill_period)) {}
+void CommandRouter::HandleBatch(std::span<const UpdateView> updates, ReplySink &sink) {
+  // Parsed commands of the current run, which is updates[run_start, i).
+  std::vector<CommandView> commands;
+  const Route *run_route = nullptr;
+  std::size_t run_start = 0;
+  const auto flush_run = [&](std::size_t end) {
+    if (run_route != nullptr) {
+      DispatchRun(*run_route, updates.subspan(run_start, end - run_start), commands, sink);
+      commands.clear();
+      run_route = nullptr;
+    }
+  };
+
+  for (std::size_t i = 0; i < updates.size(); ++i) {
+    std::optional<CommandView> command;
+    if (!commands_.empty()) {
+      command = ParseCommand(updates[i].text);
+    }
+    if (command.has_value() && !IsAddressedTo(*command, bot_username_)) {
+      flush_run(i);
+      continue;
+    }
+    const Route *route = nullptr;
+    if (command.has_value()) {
+      if (const auto it = commands_.find(command->name); it != commands_.end()) {
+        route = &it->second;
+      }
+    }
+    if (route == nullptr) {
+      flush_run(i);
+      HandleFallback(updates[i], sink);
+      continue;
+    }
+    if (route != run_route) {
+      flush_run(i);
+      run_route = route;
+      run_start = i;
+    }
+    commands.push_back(*command);
+  }
+  flush_run(updates.size());
+}
+
+void CommandRouter::DispatchRun(const Route &route, std::span<const UpdateView> updates,
+                                std::span<const CommandView> commands, ReplySink &sink) {
+  AnsweredSink answered(sink, updates);
+  const auto started = std::chrono::steady_clock::now();
+  route.handler.get().HandleCommandBatch(updates, commands, answered);
+  if (route.calls != nullptr) {
+    // Each update is charged an equal share of the run.
+    const auto share = (std::chrono::steady_clock::now() - started) / updates.size();
+    route.calls->Increment(updates.size());
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+      route.duration->Record(share);
+    }
+  }
+  for (std::size_t i = 0; i < updates.size(); ++i) {
+    if (!answered.Answered(i)) {
+      HandleFallback(updates[i], sink);
+    }
+  }
+}
 
-bool TokenBucketRateLimiter::Allow(std::int64_t chat_id) {
-  const auto now = std::chrono::steady_clock::now();
-  std::scoped_lock lock(mutex_);
-  auto [it, _] = buckets_.emplace(chat_id, Bucket{});
-  Bucket &bucket = it->second;
-  if (bucket.last_refill.time_since_epoch().count() == 0) {
-    bucket.tokens = static_cast<double>(capacity_);
-    bucket.last_refill = now;
+void CommandRouter::HandleFallback(const UpdateView &update, ReplySink &sink) {
+  try {
+    for (auto &handler : fallback_) {
+      if (auto response = handler.get().HandleView(update); response.has_value()) {
+        sink.Reply(update, std::move(*response));
+        return;
+      }
+    }
+  } catch (const std::exception &ex) {
+    sink.Fail(update, ex);
   }
+}
 
-  const auto elapsed = now - bucket.last_refill;
-  const double periods =
-      std::chrono::duration_cast<std::chrono::duration<double>>(elapsed).count() /
-      static_cast<double>(refill_period_.count());
-  if (periods > 0.0) {
-    bucket.tokens =
-        std::min(static_cast<double>(capacity_), bucket.tokens + periods * refill_tokens_);
-    bucket.last_refill = now;
+runtime::Task<std::optional<OutgoingMessage>> CommandRouter::HandleAsync(Update update) {
+  if (!commands_.empty()) {
+    if (const auto command = ParseCommand(update.text); command.has_value()) {
+      if (!IsAddressedTo(*command, bot_username_)) {
+        co_return std::nullopt;
+      }
+      if (const auto it = commands_.find(command->name); it != commands_.end()) {
+        const Route route = it->second;
+        // Wall time, including any time the handler spent suspended.
+        const auto started = std::chrono::steady_clock::now();
+        auto response = co_await route.handler.get().HandleAsync(update);
+        if (route.calls != nullptr) {
+          route.calls->Increment();
+          route.duration->Record(std::chrono::steady_clock::now() - started);
+        }
+        if (response.has_value()) {
+          co_return response;
+        }
+      }
+    }
   }
 
-  if (bucket.tokens < 1.0) {
-    return false;
+  for (auto &handler : fallback_) {
+    if (auto response = co_await handler.get().HandleAsync(update); response.has_value()) {
+      co_return response;
+    }
   }
-  bucket.tokens -= 1.0;
-  return true;
+  co_return std::nullopt;
 }
 
 RateLimitedCommandHandler::RateLimitedCommandHandler(CommandHandler &inner,
@@ -82,13 +322,41 @@ RateLimitedCommandHandler::RateLimitedCommandHandler(CommandHandler &inner,
       metrics_(metrics) {}
 
 std::optional<OutgoingMessage> RateLimitedCommandHandler::Handle(const Update &update) {
+  return HandleView(AsView(update));
+}
+
+std::optional<OutgoingMessage> RateLimitedCommandHandler::HandleView(const UpdateView &update) {
   if (!limiter_.Allow(update.chat_id)) {
     if (metrics_ != nullptr) {
       metrics_->IncrementRateLimitRejections();
     }
     return OutgoingMessage{.chat_id = update.chat_id, .text = rejection_text_};
   }
-  return inner_.Handle(update);
+  return inner_.HandleView(update);
+}
+
+runtime::Task<std::optional<OutgoingMessage>>
+RateLimitedCommandHandler::HandleAsync(Update update) {
+  if (!limiter_.Allow(update.chat_id)) {
+    if (metrics_ != nullptr) {
+      metrics_->IncrementRateLimitRejections();
+    }
+    co_return OutgoingMessage{.chat_id = update.chat_id, .text = rejection_text_};
+  }
+  co_return co_await inner_.HandleAsync(std::move(update));
+}
+
+void RateLimitedCommandHandler::HandleBatch(std::span<const UpdateView> updates,
+                                            ReplySink &sink) {
+  FilterBatch(
+      updates, inner_, sink,
+      [this](const UpdateView &update) { return limiter_.Allow(update.chat_id); },
+      [this](const UpdateView &update) {
+        if (metrics_ != nullptr) {
+          metrics_->IncrementRateLimitRejections();
+        }
+        return OutgoingMessage{.chat_id = update.chat_id, .text = rejection_text_};
+      });
 }
 
 AdminWhitelistCommandHandler::AdminWhitelistCommandHandler(
@@ -98,39 +366,288 @@ AdminWhitelistCommandHandler::AdminWhitelistCommandHandler(
       rejection_text_(std::move(rejection_text)) {}
 
 std::optional<OutgoingMessage> AdminWhitelistCommandHandler::Handle(const Update &update) {
+  return HandleView(AsView(update));
+}
+
+std::optional<OutgoingMessage> AdminWhitelistCommandHandler::HandleView(const UpdateView &update) {
   if (admin_chat_ids_.empty() || admin_chat_ids_.contains(update.chat_id)) {
-    return inner_.Handle(update);
+    return inner_.HandleView(update);
   }
   return OutgoingMessage{.chat_id = update.chat_id, .text = rejection_text_};
 }
 
+runtime::Task<std::optional<OutgoingMessage>>
+AdminWhitelistCommandHandler::HandleAsync(Update update) {
+  if (admin_chat_ids_.empty() || admin_chat_ids_.contains(update.chat_id)) {
+    co_return co_await inner_.HandleAsync(std::move(update));
+  }
+  co_return OutgoingMessage{.chat_id = update.chat_id, .text = rejection_text_};
+}
+
+void AdminWhitelistCommandHandler::HandleBatch(std::span<const UpdateView> updates,
+                                               ReplySink &sink) {
+  FilterBatch(
+      updates, inner_, sink,
+      [this](const UpdateView &update) {
+        return admin_chat_ids_.empty() || admin_chat_ids_.contains(update.chat_id);
+      },
+      [this](const UpdateView &update) {
+        return OutgoingMessage{.chat_id = update.chat_id, .text = rejection_text_};
+      });
+}
+
+// Sends the replies of a HandleBatch() call and counts its failures.
+class BotService::ReplyCollector final : public ReplySink {
+public:
+  explicit ReplyCollector(BotService &service) : service_(service) {}
+
+  void Reply(const UpdateView &update, OutgoingMessage message) override {
+    service_.SendReply(message, update.date);
+  }
+  void Fail(const UpdateView &update, const std::exception &error) override {
+    (void)update;
+    (void)error;
+    if (service_.metrics_ != nullptr) {
+      service_.metrics_->IncrementHandlerFailures();
+    }
+  }
+
+private:
+  BotService &service_;
+};
+
 BotService::BotService(TelegramGateway &gateway, CommandHandler &handler,
-                       runtime::MetricsRegistry *metrics)
-    : gateway_(gateway), handler_(handler), metrics_(metrics) {}
+                       runtime::MetricsRegistry *metrics, BotServiceOptions options)
+    : gateway_(gateway), handler_(handler), metrics_(metrics), executor_(options.executor),
+      pipeline_depth_(options.pipeline_depth),
+      poll_options_{.limit = options.poll_limit, .timeout = options.poll_timeout},
+      idle_backoff_(options.idle_backoff) {
+  if (options.dispatch_workers > 0 && executor_ == nullptr) {
+    workers_ = std::make_unique<runtime::ShardedWorkerPool>(options.dispatch_workers, metrics_);
+  }
+}
 
 void BotService::ProcessOnce() {
-  for (const auto &update : gateway_.PollUpdates()) {
-    if (metrics_ != nullptr) {
-      metrics_->IncrementUpdatesProcessed();
+  batch_.Clear();
+  gateway_.PollBatch(batch_);
+  Dispatch(batch_);
+}
+
+void BotService::ProcessBatch(const UpdateBatch &batch) { Dispatch(batch); }
+
+void BotService::Run(const RunOptions &options) {
+  runtime::SpscRing<UpdateBatch> ring(pipeline_depth_);
+  std::atomic<bool> aborted{false};
+  std::exception_ptr poll_error;
+  std::thread poller([&] { PollLoop(ring, options, aborted, poll_error); });
+
+  try {
+    while (const UpdateBatch *batch = ring.WaitFront()) {
+      Dispatch(*batch);
+      ring.Pop();
     }
+  } catch (...) {
+    aborted.store(true, std::memory_order_relaxed);
+    ring.Close();
+    poller.join();
+    throw;
+  }
+  poller.join();
+  if (poll_error != nullptr) {
+    std::rethrow_exception(poll_error);
+  }
+}
 
-    std::optional<OutgoingMessage> response;
+void BotService::PollLoop(runtime::SpscRing<UpdateBatch> &ring, const RunOptions &options,
+                          const std::atomic<bool> &aborted, std::exception_ptr &error) {
+  const auto stopping = [&] {
+    return aborted.load(std::memory_order_relaxed) ||
+           (options.stop_requested && options.stop_requested());
+  };
+  // Waits in short slices so a stop request is not held up by a long backoff.
+  const auto pause = [&](std::chrono::steady_clock::duration delay) {
+    const auto deadline = std::chrono::steady_clock::now() + delay;
+    for (auto now = std::chrono::steady_clock::now(); now < deadline && !stopping();
+         now = std::chrono::steady_clock::now()) {
+      std::this_thread::sleep_for(std::min<std::chrono::steady_clock::duration>(
+          deadline - now, std::chrono::milliseconds(100)));
+    }
+  };
+
+  bool backlog = false;
+  while (!stopping()) {
+    UpdateBatch *batch = ring.WaitBeginPush();
+    if (batch == nullptr) {
+      break;
+    }
+    // A full batch means more updates are probably queued: ask for them
+    // without waiting. Otherwise long-poll until something arrives.
+    PollOptions poll = poll_options_;
+    if (backlog) {
+      poll.timeout = std::chrono::seconds(0);
+    }
+
+    batch->Clear();
+    const auto started = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration delay{0};
     try {
-      response = handler_.Handle(update);
-    } catch (const std::exception &) {
-      if (metrics_ != nullptr) {
-        metrics_->IncrementHandlerFailures();
+      gateway_.SetPollOptions(poll);
+      bool polled = false;
+      try {
+        gateway_.PollBatch(*batch);
+        polled = true;
+      } catch (const std::exception &ex) {
+        batch->Clear();
+        if (!options.after_poll) {
+          throw;
+        }
+        delay = options.after_poll(&ex);
       }
-      continue;
+      if (polled && options.after_poll) {
+        delay = options.after_poll(nullptr);
+      }
+    } catch (...) {
+      error = std::current_exception();
+      break;
     }
 
-    if (response.has_value()) {
-      gateway_.SendMessage(*response);
-      if (metrics_ != nullptr) {
-        metrics_->IncrementMessagesSent();
+    backlog = batch->size() >= static_cast<std::size_t>(poll.limit);
+    if (!batch->empty()) {
+      ring.CommitPush();
+    } else if (delay <= std::chrono::steady_clock::duration::zero()) {
+      delay = idle_backoff_ - (std::chrono::steady_clock::now() - started);
+    }
+    if (delay > std::chrono::steady_clock::duration::zero()) {
+      pause(delay);
+    }
+  }
+  ring.Close();
+}
+
+void BotService::Dispatch(const UpdateBatch &batch) {
+  for (const auto &update : batch) {
+    if (metrics_ != nullptr) {
+      metrics_->IncrementUpdatesProcessed();
+    }
+    polled_up_to_ = std::max(polled_up_to_, update.update_id + 1);
+  }
+
+  if (executor_ != nullptr) {
+    for (const auto &update : batch) {
+      {
+        std::lock_guard lock(in_flight_mutex_);
+        in_flight_.insert(update.update_id);
       }
+      executor_->Spawn(HandleUpdateAsync(ToUpdate(update)));
+    }
+  } else if (workers_ != nullptr) {
+    for (const auto &update : batch) {
+      workers_->Submit(static_cast<std::uint64_t>(update.chat_id),
+                       [this, update] { HandleUpdate(update); });
+    }
+    // Tasks hold views into `batch`; it must not be cleared before they finish.
+    workers_->WaitIdle();
+  } else {
+    HandleBatch(batch.views());
+  }
+
+  // Replies of one batch are in flight together; wait for the slowest rather
+  // than for the sum of their round-trips.
+  gateway_.FlushSends();
+  CommitHandled();
+}
+
+void BotService::CommitHandled() {
+  std::int64_t next_offset = polled_up_to_;
+  {
+    std::lock_guard lock(in_flight_mutex_);
+    if (!in_flight_.empty()) {
+      next_offset = std::min(next_offset, *in_flight_.begin());
+    }
+  }
+  if (next_offset > committed_) {
+    committed_ = next_offset;
+    gateway_.CommitUpdates(next_offset);
+  }
+}
+
+void BotService::HandleBatch(std::span<const UpdateView> updates) {
+  if (updates.empty()) {
+    return;
+  }
+  ReplyCollector sink(*this);
+  const auto started = std::chrono::steady_clock::now();
+  handler_.HandleBatch(updates, sink);
+  if (metrics_ != nullptr) {
+    // The chain ran once for the whole poll; each update is charged its share.
+    const auto share = (std::chrono::steady_clock::now() - started) / updates.size();
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+      metrics_->ObserveLatency(runtime::LatencyStage::kHandle, share);
+    }
+  }
+}
+
+void BotService::HandleUpdate(const UpdateView &update) {
+  std::optional<OutgoingMessage> response;
+  const auto started = std::chrono::steady_clock::now();
+  try {
+    response = handler_.HandleView(update);
+    if (metrics_ != nullptr) {
+      metrics_->ObserveLatency(runtime::LatencyStage::kHandle,
+                               std::chrono::steady_clock::now() - started);
     }
+  } catch (const std::exception &) {
+    if (metrics_ != nullptr) {
+      metrics_->IncrementHandlerFailures();
+    }
+    return;
   }
+
+  if (response.has_value()) {
+    SendReply(*response, update.date);
+  }
+}
+
+runtime::Task<> BotService::HandleUpdateAsync(Update update) {
+  std::optional<OutgoingMessage> response;
+  const auto started = std::chrono::steady_clock::now();
+  try {
+    response = co_await handler_.HandleAsync(update);
+    if (metrics_ != nullptr) {
+      metrics_->ObserveLatency(runtime::LatencyStage::kHandle,
+                               std::chrono::steady_clock::now() - started);
+    }
+  } catch (const std::exception &) {
+    if (metrics_ != nullptr) {
+      metrics_->IncrementHandlerFailures();
+    }
+  }
+
+  if (response.has_value()) {
+    SendReply(*response, update.date);
+  }
+  std::lock_guard lock(in_flight_mutex_);
+  in_flight_.erase(in_flight_.find(update.update_id));
+}
+
+void BotService::SendReply(const OutgoingMessage &response, std::int64_t date) {
+  gateway_.SendMessageAsync(response, [metrics = metrics_, date](const OutgoingMessage &,
+                                                                 const SendResult &result) {
+    if (metrics == nullptr) {
+      return;
+    }
+    if (!result.ok) {
+      metrics->IncrementSendFailures();
+      return;
+    }
+    metrics->IncrementMessagesSent();
+    if (date > 0) {
+      // message.date has one-second resolution, so this is within a second.
+      const std::chrono::system_clock::time_point received{std::chrono::seconds(date)};
+      metrics->ObserveLatency(runtime::LatencyStage::kEndToEnd,
+                              std::chrono::system_clock::now() - received);
+    }
+  });
 }
 
 } // namespace vertel::core
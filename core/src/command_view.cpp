@@ -0,0 +1,59 @@
+#include "vertel/core/command_view.hpp"
+
+#include <algorithm>
+#include <cctype>
+
+namespace vertel::core {
+namespace {
+
+constexpr std::string_view kWhitespace = " \t\r\n";
+
+} // namespace
+
+std::optional<CommandView> ParseCommand(std::string_view text) {
+  if (text.size() < 2 || text.front() != '/') {
+    return std::nullopt;
+  }
+
+  const std::size_t token_end = std::min(text.find_first_of(kWhitespace), text.size());
+  std::string_view token = text.substr(1, token_end - 1);
+  CommandView command;
+  if (const std::size_t at = token.find('@'); at != std::string_view::npos) {
+    command.bot_username = token.substr(at + 1);
+    token = token.substr(0, at);
+  }
+  if (token.empty()) {
+    return std::nullopt;
+  }
+  command.name = token;
+
+  if (const std::size_t args = text.find_first_not_of(kWhitespace, token_end);
+      args != std::string_view::npos) {
+    command.args = text.substr(args);
+  }
+  return command;
+}
+
+bool IsAddressedTo(const CommandView &command, std::string_view bot_username) {
+  if (command.bot_username.empty() || bot_username.empty()) {
+    return true;
+  }
+  return std::ranges::equal(command.bot_username, bot_username, [](char a, char b) {
+    return std::tolower(static_cast<unsigned char>(a)) ==
+           std::tolower(static_cast<unsigned char>(b));
+  });
+}
+
+std::string_view NextArgument(std::string_view &args) {
+  const std::size_t start = args.find_first_not_of(kWhitespace);
+  if (start == std::string_view::npos) {
+    args = {};
+    return {};
+  }
+  const std::size_t end = std::min(args.find_first_of(kWhitespace, start), args.size());
+  const std::string_view argument = args.substr(start, end - start);
+  args.remove_prefix(end);
+  return argument;
+}
+
+} // namespace vertel::core
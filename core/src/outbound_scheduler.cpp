@@ -0,0 +1,290 @@
+#include "vertel/core/outbound_scheduler.hpp"
+
+#include <algorithm>
+#include <future>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+namespace vertel::core {
+namespace {
+
+// Idle chat states are dropped after this many releases.
+constexpr std::uint64_t kCleanupEvery = 1024;
+
+} // namespace
+
+OutboundScheduler::OutboundScheduler(TelegramGateway &inner, OutboundSchedulerOptions options,
+                                     runtime::MetricsRegistry *metrics)
+    : inner_(inner), options_(options), metrics_(metrics) {
+  base_interval_ =
+      options_.max_messages_per_second > 0.0
+          ? std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(1.0 / options_.max_messages_per_second))
+          : Clock::duration::zero();
+  global_interval_ = base_interval_;
+  thread_ = std::thread(&OutboundScheduler::Run, this);
+}
+
+OutboundScheduler::~OutboundScheduler() {
+  {
+    std::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  wake_cv_.notify_all();
+  thread_.join();
+
+  std::vector<Pending> abandoned;
+  {
+    std::scoped_lock lock(mutex_);
+    for (auto &[chat_id, chat] : chats_) {
+      for (auto &lane : chat.lanes) {
+        std::move(lane.begin(), lane.end(), std::back_inserter(abandoned));
+      }
+    }
+    chats_.clear();
+    queued_ = 0;
+    for (const auto &pending : abandoned) {
+      unsettled_.erase(pending.ticket);
+    }
+  }
+  if (metrics_ != nullptr) {
+    metrics_->AddOutboundQueueDepth(-static_cast<std::int64_t>(abandoned.size()));
+  }
+  const SendResult stopped{.ok = false, .error = "outbound scheduler stopped"};
+  for (auto &pending : abandoned) {
+    if (pending.done) {
+      pending.done(pending.message, stopped);
+    }
+  }
+
+  // Completions of released messages still call back into this object.
+  inner_.FlushSends();
+  std::unique_lock lock(mutex_);
+  idle_cv_.wait(lock, [this] { return in_flight_ == 0; });
+}
+
+std::vector<Update> OutboundScheduler::PollUpdates() { return inner_.PollUpdates(); }
+
+void OutboundScheduler::PollBatch(UpdateBatch &batch) { inner_.PollBatch(batch); }
+
+void OutboundScheduler::SetPollOptions(const PollOptions &options) {
+  inner_.SetPollOptions(options);
+}
+
+void OutboundScheduler::SendMessage(const OutgoingMessage &message) {
+  std::promise<SendResult> promise;
+  auto result = promise.get_future();
+  SendMessageAsync(message, [&promise](const OutgoingMessage &, const SendResult &sent) {
+    promise.set_value(sent);
+  });
+  if (const SendResult sent = result.get(); !sent.ok) {
+    throw std::runtime_error(sent.error);
+  }
+}
+
+void OutboundScheduler::SendMessageAsync(const OutgoingMessage &message, SendCallback done) {
+  {
+    std::scoped_lock lock(mutex_);
+    if (!stopping_) {
+      const auto lane = static_cast<std::size_t>(message.priority);
+      ChatState &chat = chats_[message.chat_id];
+      if (chat.lanes[lane].empty()) {
+        ready_[lane].push(Ready{.at = std::max(chat.next_send, Clock::now()),
+                                .sequence = ++sequence_,
+                                .chat_id = message.chat_id});
+      }
+      unsettled_.insert(next_ticket_);
+      chat.lanes[lane].push_back(Pending{
+          .message = message, .done = std::move(done), .throttled = 0, .ticket = next_ticket_++});
+      ++queued_;
+      done = nullptr;
+    }
+  }
+  if (done) {
+    done(message, SendResult{.ok = false, .error = "outbound scheduler stopped"});
+    return;
+  }
+  if (metrics_ != nullptr) {
+    metrics_->AddOutboundQueueDepth(1);
+  }
+  wake_cv_.notify_one();
+}
+
+void OutboundScheduler::FlushSends() {
+  inner_.FlushSends();
+  ForwardCommits();
+}
+
+void OutboundScheduler::CommitUpdates(std::int64_t next_offset) {
+  {
+    std::scoped_lock lock(mutex_);
+    commits_.emplace_back(next_ticket_, next_offset);
+  }
+  ForwardCommits();
+}
+
+void OutboundScheduler::Drain() {
+  {
+    std::unique_lock lock(mutex_);
+    idle_cv_.wait(lock, [this] { return queued_ == 0 && in_flight_ == 0; });
+  }
+  ForwardCommits();
+}
+
+void OutboundScheduler::ForwardCommits() {
+  std::scoped_lock commit_lock(commit_mutex_);
+  std::optional<std::int64_t> next_offset;
+  {
+    std::scoped_lock lock(mutex_);
+    const std::uint64_t oldest = unsettled_.empty() ? next_ticket_ : *unsettled_.begin();
+    while (!commits_.empty() && commits_.front().first <= oldest) {
+      next_offset = commits_.front().second;
+      commits_.pop_front();
+    }
+  }
+  if (next_offset.has_value()) {
+    inner_.CommitUpdates(*next_offset);
+  }
+}
+
+std::size_t OutboundScheduler::QueuedMessages() const {
+  std::scoped_lock lock(mutex_);
+  return queued_;
+}
+
+OutboundScheduler::Clock::duration OutboundScheduler::ChatInterval(std::int64_t chat_id) const {
+  return chat_id < 0 ? options_.group_chat_interval : options_.private_chat_interval;
+}
+
+void OutboundScheduler::Run() {
+  std::uint64_t released = 0;
+  std::unique_lock lock(mutex_);
+  while (!stopping_) {
+    if (queued_ == 0) {
+      wake_cv_.wait(lock);
+      continue;
+    }
+    const auto now = Clock::now();
+    if (now < global_next_) {
+      wake_cv_.wait_until(lock, global_next_);
+      continue;
+    }
+
+    // Interactive first: the bulk lane only gets a slot no interactive chat can use.
+    std::size_t lane = kLanes;
+    auto earliest = Clock::time_point::max();
+    for (std::size_t l = 0; l < kLanes && lane == kLanes; ++l) {
+      ReadyQueue &ready = ready_[l];
+      // Entries are refreshed lazily when their chat sent from the other lane.
+      while (!ready.empty() && chats_[ready.top().chat_id].next_send > ready.top().at) {
+        Ready entry = ready.top();
+        ready.pop();
+        entry.at = chats_[entry.chat_id].next_send;
+        ready.push(entry);
+      }
+      if (ready.empty()) {
+        continue;
+      }
+      if (ready.top().at <= now) {
+        lane = l;
+      } else {
+        earliest = std::min(earliest, ready.top().at);
+      }
+    }
+    if (lane == kLanes) {
+      wake_cv_.wait_until(lock, earliest);
+      continue;
+    }
+
+    const std::int64_t chat_id = ready_[lane].top().chat_id;
+    ready_[lane].pop();
+    ChatState &chat = chats_[chat_id];
+    Pending pending = std::move(chat.lanes[lane].front());
+    chat.lanes[lane].pop_front();
+    chat.next_send = now + ChatInterval(chat_id);
+    global_next_ = now + global_interval_;
+    if (!chat.lanes[lane].empty()) {
+      ready_[lane].push(Ready{.at = chat.next_send, .sequence = ++sequence_, .chat_id = chat_id});
+    }
+    --queued_;
+    ++in_flight_;
+
+    if (++released % kCleanupEvery == 0) {
+      std::erase_if(chats_, [now](const auto &entry) {
+        const ChatState &state = entry.second;
+        return state.next_send <= now &&
+               std::all_of(state.lanes.begin(), state.lanes.end(),
+                           [](const auto &queue) { return queue.empty(); });
+      });
+    }
+
+    lock.unlock();
+    if (metrics_ != nullptr) {
+      metrics_->AddOutboundQueueDepth(-1);
+    }
+    auto complete = [this, done = std::move(pending.done), throttled = pending.throttled,
+                     ticket = pending.ticket](const OutgoingMessage &message,
+                                              const SendResult &result) mutable {
+      OnResult(result);
+      Pending retry{
+          .message = message, .done = std::move(done), .throttled = throttled, .ticket = ticket};
+      const bool requeued = result.status_code == 429 && Requeue(retry, result);
+      if (requeued) {
+        if (metrics_ != nullptr) {
+          metrics_->AddOutboundQueueDepth(1);
+        }
+        wake_cv_.notify_one();
+      } else if (retry.done) {
+        retry.done(message, result);
+      }
+      std::scoped_lock done_lock(mutex_);
+      if (!requeued) {
+        unsettled_.erase(ticket);
+      }
+      --in_flight_;
+      idle_cv_.notify_all();
+    };
+    inner_.SendMessageAsync(pending.message, std::move(complete));
+    lock.lock();
+  }
+}
+
+bool OutboundScheduler::Requeue(Pending &pending, const SendResult &result) {
+  std::scoped_lock lock(mutex_);
+  if (stopping_ || pending.throttled >= options_.max_throttled_retries) {
+    return false;
+  }
+  ++pending.throttled;
+  const auto lane = static_cast<std::size_t>(pending.message.priority);
+  ChatState &chat = chats_[pending.message.chat_id];
+  const auto wait = std::max<Clock::duration>(global_interval_, result.retry_after);
+  chat.next_send = std::max(chat.next_send, Clock::now() + wait);
+  if (chat.lanes[lane].empty()) {
+    ready_[lane].push(Ready{
+        .at = chat.next_send, .sequence = ++sequence_, .chat_id = pending.message.chat_id});
+  }
+  chat.lanes[lane].push_front(std::move(pending));
+  ++queued_;
+  return true;
+}
+
+void OutboundScheduler::OnResult(const SendResult &result) {
+  std::scoped_lock lock(mutex_);
+  if (result.status_code == 429) {
+    global_interval_ = std::min<Clock::duration>(
+        std::max<Clock::duration>(global_interval_ * 2, std::chrono::milliseconds(1)),
+        options_.max_backoff_interval);
+    // Telegram's retry_after, when present, is the authoritative wait.
+    global_next_ = std::max(global_next_,
+                            Clock::now() + std::max<Clock::duration>(global_interval_,
+                                                                     result.retry_after));
+    if (metrics_ != nullptr) {
+      metrics_->IncrementOutboundThrottled();
+    }
+  } else if (result.ok && global_interval_ > base_interval_) {
+    global_interval_ = std::max(base_interval_, global_interval_ - global_interval_ / 16);
+  }
+}
+
+} // namespace vertel::core
@@ -0,0 +1,221 @@
+#include "vertel/core/rate_limiter.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+namespace vertel::core {
+namespace {
+
+// Telegram chat ids never reach these values.
+constexpr std::int64_t kEmptyKey = std::numeric_limits<std::int64_t>::min();
+constexpr std::int64_t kTombstoneKey = kEmptyKey + 1;
+
+// Live arrival times are never negative, so evicted slots keep their last
+// arrival time in negated form. A lock-free updater that loses a race with an
+// eviction sees a negative value and retries under the mutex. A reused slot
+// starts above the saved time, so its state never returns to a value a stale
+// compare-exchange still expects.
+constexpr std::int64_t EncodeEvicted(std::int64_t tat) { return -tat - 1; }
+constexpr std::int64_t DecodeEvicted(std::int64_t encoded) { return -encoded - 1; }
+
+std::uint64_t MixChatId(std::int64_t chat_id) {
+  auto x = static_cast<std::uint64_t>(chat_id);
+  x ^= x >> 33;
+  x *= 0xff51afd7ed558ccdULL;
+  x ^= x >> 33;
+  x *= 0xc4ceb9fe1a85ec53ULL;
+  x ^= x >> 33;
+  return x;
+}
+
+} // namespace
+
+TokenBucketRateLimiter::TokenBucketRateLimiter(int capacity, int refill_tokens,
+                                               std::chrono::seconds refill_period,
+                                               std::size_t max_tracked_chats,
+                                               runtime::MetricsRegistry *metrics)
+    : epoch_(std::chrono::steady_clock::now()), metrics_(metrics),
+      shards_(std::make_unique<Shard[]>(kShardCount)) {
+  const auto period_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                             std::max(std::chrono::seconds(1), refill_period))
+                             .count();
+  emission_interval_ns_ = std::max<std::int64_t>(1, period_ns / std::max(1, refill_tokens));
+  burst_ns_ = emission_interval_ns_ * std::max(1, capacity);
+
+  max_live_per_shard_ =
+      std::max<std::size_t>(1, (max_tracked_chats + kShardCount - 1) / kShardCount);
+  // At most three quarters full keeps probe sequences short.
+  slots_per_shard_ = std::bit_ceil(std::max<std::size_t>(16, max_live_per_shard_ * 4 / 3 + 1));
+
+  for (std::size_t s = 0; s < kShardCount; ++s) {
+    shards_[s].slots = std::make_unique<Slot[]>(slots_per_shard_);
+    for (std::size_t i = 0; i < slots_per_shard_; ++i) {
+      shards_[s].slots[i].key.store(kEmptyKey, std::memory_order_relaxed);
+      shards_[s].slots[i].tat.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+TokenBucketRateLimiter::~TokenBucketRateLimiter() {
+  if (metrics_ != nullptr) {
+    metrics_->AddRateLimiterTrackedChats(-tracked_.load(std::memory_order_relaxed));
+  }
+}
+
+std::size_t TokenBucketRateLimiter::TrackedChats() const {
+  return static_cast<std::size_t>(tracked_.load(std::memory_order_relaxed));
+}
+
+std::int64_t TokenBucketRateLimiter::NowNanos() const {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                              epoch_)
+      .count();
+}
+
+TokenBucketRateLimiter::Slot *TokenBucketRateLimiter::Find(Shard &shard, std::size_t home,
+                                                           std::int64_t chat_id) const {
+  for (std::size_t probe = 0; probe < slots_per_shard_; ++probe) {
+    Slot &slot = shard.slots[(home + probe) & (slots_per_shard_ - 1)];
+    const std::int64_t key = slot.key.load(std::memory_order_acquire);
+    if (key == chat_id) {
+      return &slot;
+    }
+    if (key == kEmptyKey) {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+bool TokenBucketRateLimiter::TryConsume(Slot &slot, std::int64_t chat_id, std::int64_t now,
+                                        bool &allowed) const {
+  std::int64_t current = slot.tat.load(std::memory_order_acquire);
+  while (true) {
+    // Re-checked after every load: the slot may have been handed to another chat.
+    if (current < 0 || slot.key.load(std::memory_order_relaxed) != chat_id) {
+      return false;
+    }
+    const std::int64_t next = std::max(current, now) + emission_interval_ns_;
+    if (next - now > burst_ns_) {
+      allowed = false;
+      return true;
+    }
+    if (slot.tat.compare_exchange_weak(current, next, std::memory_order_acq_rel,
+                                       std::memory_order_acquire)) {
+      allowed = true;
+      return true;
+    }
+  }
+}
+
+bool TokenBucketRateLimiter::Evict(Shard &shard, std::size_t index, std::int64_t now,
+                                   bool idle_only) {
+  Slot &slot = shard.slots[index];
+  const std::int64_t key = slot.key.load(std::memory_order_relaxed);
+  if (key == kEmptyKey || key == kTombstoneKey) {
+    return false;
+  }
+  std::int64_t tat = slot.tat.load(std::memory_order_relaxed);
+  do {
+    // A bucket is full again once its arrival time has passed.
+    if (idle_only && tat > now) {
+      return false;
+    }
+  } while (!slot.tat.compare_exchange_weak(tat, EncodeEvicted(tat), std::memory_order_acq_rel,
+                                           std::memory_order_relaxed));
+  slot.key.store(kTombstoneKey, std::memory_order_release);
+
+  // Tombstones directly in front of an empty slot end no probe sequence and can
+  // be emptied.
+  const std::size_t mask = slots_per_shard_ - 1;
+  if (shard.slots[(index + 1) & mask].key.load(std::memory_order_relaxed) == kEmptyKey) {
+    for (std::size_t i = index;
+         shard.slots[i].key.load(std::memory_order_relaxed) == kTombstoneKey;
+         i = (i - 1) & mask) {
+      shard.slots[i].key.store(kEmptyKey, std::memory_order_release);
+    }
+  }
+
+  --shard.live;
+  tracked_.fetch_sub(1, std::memory_order_relaxed);
+  if (metrics_ != nullptr) {
+    metrics_->AddRateLimiterTrackedChats(-1);
+  }
+  return true;
+}
+
+std::size_t TokenBucketRateLimiter::Sweep(Shard &shard, std::int64_t now, std::size_t steps) {
+  std::size_t evicted = 0;
+  for (std::size_t i = 0; i < steps; ++i) {
+    const std::size_t index = shard.hand;
+    shard.hand = (shard.hand + 1) & (slots_per_shard_ - 1);
+    evicted += Evict(shard, index, now, /*idle_only=*/true) ? 1 : 0;
+  }
+  return evicted;
+}
+
+void TokenBucketRateLimiter::ForceEvict(Shard &shard, std::int64_t now) {
+  for (std::size_t i = 0; i < slots_per_shard_; ++i) {
+    const std::size_t index = shard.hand;
+    shard.hand = (shard.hand + 1) & (slots_per_shard_ - 1);
+    if (Evict(shard, index, now, /*idle_only=*/false)) {
+      return;
+    }
+  }
+}
+
+void TokenBucketRateLimiter::Insert(Shard &shard, std::size_t home, std::int64_t chat_id,
+                                    std::int64_t now) {
+  Sweep(shard, now, kSweepStep);
+  if (shard.live >= max_live_per_shard_ && Sweep(shard, now, slots_per_shard_) == 0) {
+    ForceEvict(shard, now);
+  }
+
+  for (std::size_t probe = 0; probe < slots_per_shard_; ++probe) {
+    Slot &slot = shard.slots[(home + probe) & (slots_per_shard_ - 1)];
+    const std::int64_t key = slot.key.load(std::memory_order_relaxed);
+    if (key != kEmptyKey && key != kTombstoneKey) {
+      continue;
+    }
+    // A new chat starts with a full burst. Only a slot taken over from a chat
+    // that was evicted early can carry more; see EncodeEvicted().
+    const std::int64_t previous = slot.tat.load(std::memory_order_relaxed);
+    const std::int64_t floor = previous < 0 ? DecodeEvicted(previous) + 1 : 0;
+    // Publish the state before the key so lock-free readers that see the key
+    // also see it.
+    slot.tat.store(std::max(now + emission_interval_ns_, floor), std::memory_order_release);
+    slot.key.store(chat_id, std::memory_order_release);
+    ++shard.live;
+    tracked_.fetch_add(1, std::memory_order_relaxed);
+    if (metrics_ != nullptr) {
+      metrics_->AddRateLimiterTrackedChats(1);
+    }
+    return;
+  }
+}
+
+bool TokenBucketRateLimiter::Allow(std::int64_t chat_id) {
+  const std::uint64_t hash = MixChatId(chat_id);
+  Shard &shard = shards_[hash & (kShardCount - 1)];
+  const std::size_t home = static_cast<std::size_t>(hash >> 32) & (slots_per_shard_ - 1);
+
+  bool allowed = false;
+  if (Slot *slot = Find(shard, home, chat_id);
+      slot != nullptr && TryConsume(*slot, chat_id, NowNanos(), allowed)) {
+    return allowed;
+  }
+
+  std::scoped_lock lock(shard.mutex);
+  // Read under the mutex so evictions and inserts see a monotonic clock.
+  const std::int64_t now = NowNanos();
+  if (Slot *slot = Find(shard, home, chat_id); slot != nullptr) {
+    // Evictions need the mutex, so the slot cannot change owner here.
+    TryConsume(*slot, chat_id, now, allowed);
+    return allowed;
+  }
+  Insert(shard, home, chat_id, now);
+  return true;
+}
+
+} // namespace vertel::core
@@ -0,0 +1,44 @@
+#include "vertel/core/update_batch.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace vertel::core {
+
+void UpdateBatch::Add(std::int64_t update_id, std::int64_t chat_id, std::string_view text,
+                      std::int64_t date) {
+  views_.push_back(
+      UpdateView{.update_id = update_id, .chat_id = chat_id, .text = Store(text), .date = date});
+}
+
+void UpdateBatch::Clear() {
+  views_.clear();
+  for (auto &block : blocks_) {
+    block.used = 0;
+  }
+  current_block_ = 0;
+}
+
+std::string_view UpdateBatch::Store(std::string_view text) {
+  if (text.empty()) {
+    return {};
+  }
+  // Blocks are never reallocated, so earlier views stay valid as the arena grows.
+  while (current_block_ < blocks_.size() &&
+         blocks_[current_block_].capacity - blocks_[current_block_].used < text.size()) {
+    ++current_block_;
+  }
+  if (current_block_ == blocks_.size()) {
+    const std::size_t capacity = std::max(kBlockSize, text.size());
+    blocks_.push_back(Block{.data = std::make_unique_for_overwrite<char[]>(capacity),
+                            .capacity = capacity});
+  }
+
+  Block &block = blocks_[current_block_];
+  char *out = block.data.get() + block.used;
+  std::memcpy(out, text.data(), text.size());
+  block.used += text.size();
+  return {out, text.size()};
+}
+
+} // namespace vertel::core
@@ -1,75 +1,253 @@
+#include <algorithm>
 #include <chrono>
+#include <cstddef>
+#include <cstdint>
 #include <exception>
-#include <thread>
+#include <iostream>
+#include <memory>
+#include <string>
 
+#include "vertel/adapters/shard/shard_front.hpp"
+#include "vertel/adapters/shard/shard_worker_gateway.hpp"
 #include "vertel/adapters/telegram/telegram_client.hpp"
+#include "vertel/adapters/telegram/webhook_gateway.hpp"
 #include "vertel/core/bot_service.hpp"
+#include "vertel/core/outbound_scheduler.hpp"
 #include "vertel/platform/config.hpp"
 #include "vertel/runtime/health_server.hpp"
 #include "vertel/runtime/logger.hpp"
 #include "vertel/runtime/metrics.hpp"
-#include "vertel/runtime/retry_policy.hpp"
+#include "vertel/runtime/offset_checkpoint.hpp"
+#include "vertel/runtime/retry_engine.hpp"
 #include "vertel/runtime/shutdown.hpp"
 
 int main() {
   using namespace vertel;
 
   const auto config = platform::Config::FromEnv();
-  runtime::Logger logger;
-  runtime::RetryPolicy retry_policy{.max_attempts = config.poll_max_attempts,
-                                    .initial_backoff =
-                                        std::chrono::milliseconds(config.poll_initial_backoff_ms)};
-  runtime::ShutdownSignal::Install();
   runtime::MetricsRegistry metrics;
-  runtime::HealthServer health_server(metrics, config.http_port);
+  // Declared early so it outlives everything that logs; its destructor writes
+  // out whatever is still queued.
+  runtime::Logger logger(
+      std::cout,
+      runtime::LoggerOptions{.async = config.log_async,
+                             .queue_capacity = static_cast<std::size_t>(config.log_queue_capacity),
+                             .overflow = config.log_block_on_overflow
+                                             ? runtime::LogOverflowPolicy::kBlock
+                                             : runtime::LogOverflowPolicy::kDrop,
+                             .min_level = runtime::ParseLogLevel(config.log_level)},
+      &metrics);
+  runtime::ShutdownSignal::Install();
+  // VERTEL_HTTP_PORT <= 0 disables the server.
+  runtime::HealthServer health_server(metrics, config.http_port > 0 ? config.http_port : -1);
   health_server.Start();
 
+  // A shard worker polls the front, and replies through it unless it sends
+  // with its own token.
+  const bool shard_worker = config.shard_role == "worker";
+  const bool shard_front = config.shard_role == "front";
+  const bool relay_replies = shard_worker && config.shard_replies != "direct";
+
+  // Declared before `telegram`, which keeps a pointer to it. Webhook mode has
+  // no offset to resume from: Telegram redelivers unacknowledged requests.
+  // Shard workers have none either: the front owns the offset.
+  std::unique_ptr<runtime::OffsetCheckpoint> checkpoint;
+  if (!config.offset_checkpoint_path.empty() && config.webhook_port <= 0 &&
+      !config.inject_sample_start && !shard_worker) {
+    try {
+      checkpoint = std::make_unique<runtime::OffsetCheckpoint>(
+          config.offset_checkpoint_path,
+          runtime::OffsetCheckpointOptions{
+              .sync = runtime::ParseCheckpointSync(config.offset_checkpoint_sync),
+              .sync_interval = std::chrono::milliseconds(config.offset_checkpoint_sync_ms)});
+    } catch (const std::exception &ex) {
+      VERTEL_LOG_ERROR(logger, "offset_checkpoint_failed",
+                       {{"component", "app"}, {"error", ex.what()}});
+      return 1;
+    }
+  }
+
+  const auto pool_size =
+      static_cast<std::size_t>(std::max(1, config.telegram_connection_pool_size));
+  auto connection_pool = std::make_shared<adapters::telegram::HttpConnectionPool>(
+      adapters::telegram::HttpConnectionPool::Options{.max_idle_handles = pool_size});
   adapters::telegram::TelegramClient telegram(
-      config.inject_sample_start ? adapters::telegram::TelegramClient(/*inject_sample_update=*/true)
-                                 : adapters::telegram::TelegramClient(
-                                       config.bot_token, config.telegram_long_poll_timeout_seconds,
-                                       config.telegram_request_timeout_seconds));
+      config.inject_sample_start
+          ? adapters::telegram::TelegramClient(/*inject_sample_update=*/true)
+          : adapters::telegram::TelegramClient(
+                config.bot_token, config.telegram_long_poll_timeout_seconds,
+                config.telegram_request_timeout_seconds, connection_pool,
+                static_cast<std::size_t>(std::max(1, config.telegram_max_in_flight_sends)),
+                &metrics));
+  telegram.SetApiBase(config.telegram_api_base);
+  if (!relay_replies) {
+    telegram.Warmup(pool_size);
+  }
+  if (checkpoint != nullptr) {
+    telegram.UseCheckpoint(checkpoint.get());
+    VERTEL_LOG_INFO(logger, "offset_checkpoint_loaded",
+                    {{"component", "app"}, {"offset", checkpoint->Load()}});
+  }
+
+  // Declared after `telegram`: retries still on the timer thread call into it.
+  runtime::RetryEngine retry_engine(
+      runtime::RetryEngineOptions{
+          .max_attempts = config.poll_max_attempts,
+          .initial_backoff = std::chrono::milliseconds(config.poll_initial_backoff_ms),
+          .max_backoff = std::chrono::milliseconds(config.poll_max_backoff_ms),
+          .retry_budget_ratio = std::max(0, config.retry_budget_percent) / 100.0,
+          .circuit_failure_threshold = config.circuit_failure_threshold,
+          .circuit_open_duration = std::chrono::milliseconds(config.circuit_open_ms)},
+      &metrics);
+
+  // Webhook mode: updates arrive over HTTP, replies still go out through `telegram`.
+  core::TelegramGateway *gateway = &telegram;
+  std::unique_ptr<adapters::telegram::WebhookGateway> webhook;
+  if (config.webhook_port > 0) {
+    webhook = std::make_unique<adapters::telegram::WebhookGateway>(
+        adapters::telegram::WebhookGateway::Options{
+            .port = config.webhook_port,
+            .path = config.webhook_path,
+            .secret_token = config.webhook_secret,
+            .listener_threads = static_cast<std::size_t>(std::max(1, config.webhook_threads))},
+        telegram);
+    if (!webhook->Start()) {
+      VERTEL_LOG_ERROR(logger, "webhook_listen_failed",
+                       {{"component", "app"}, {"port", config.webhook_port}});
+      return 1;
+    }
+    if (!config.webhook_url.empty()) {
+      retry_engine.Execute(
+          "setWebhook",
+          [&telegram, &config] {
+            try {
+              telegram.SetWebhook(config.webhook_url, config.webhook_secret);
+              return runtime::RetryOutcome{
+                  .ok = true, .retryable = true, .retry_after = {}, .error = {}};
+            } catch (const std::exception &ex) {
+              return adapters::telegram::RetryOutcomeFor(ex);
+            }
+          },
+          [&logger](const runtime::RetryOutcome &outcome, int attempts) {
+            if (!outcome.ok) {
+              VERTEL_LOG_ERROR(
+                  logger, "set_webhook_failed",
+                  {{"component", "app"}, {"error", outcome.error}, {"attempts", attempts}});
+            }
+          });
+    }
+    gateway = webhook.get();
+  }
+
+  // The front's scheduler paces relayed replies; a relaying worker sends none itself.
+  core::TelegramGateway *ingest = gateway;
+  std::unique_ptr<core::OutboundScheduler> outbound;
+  if (config.outbound_messages_per_second > 0 && !relay_replies) {
+    outbound = std::make_unique<core::OutboundScheduler>(
+        *gateway,
+        core::OutboundSchedulerOptions{
+            .max_messages_per_second = static_cast<double>(config.outbound_messages_per_second),
+            .private_chat_interval = std::chrono::milliseconds(config.outbound_chat_interval_ms),
+            .group_chat_interval = std::chrono::milliseconds(config.outbound_group_interval_ms)},
+        &metrics);
+    gateway = outbound.get();
+  }
+
+  std::unique_ptr<adapters::shard::ShardWorkerGateway> shard_gateway;
+  if (shard_worker) {
+    shard_gateway = std::make_unique<adapters::shard::ShardWorkerGateway>(
+        adapters::shard::ShardWorkerGateway::Options{
+            .socket_path = config.shard_socket,
+            .shard = static_cast<std::uint32_t>(std::max(0, config.shard_index)),
+            .shards = static_cast<std::uint32_t>(config.shard_count),
+            .max_batch = static_cast<std::size_t>(std::max(1, config.poll_limit))},
+        relay_replies ? nullptr : gateway);
+    gateway = shard_gateway.get();
+  }
 
   core::StartCommandHandler start_handler;
   core::HelpCommandHandler help_handler;
   core::PingCommandHandler ping_handler;
-  core::CommandRouter router({start_handler, help_handler, ping_handler});
+  core::CommandRouter router({}, config.bot_username, &metrics);
+  router.Register("start", start_handler);
+  router.Register("help", help_handler);
+  router.Register("ping", ping_handler);
   core::AdminWhitelistCommandHandler admin_guard(router, config.admin_chat_ids);
   core::TokenBucketRateLimiter limiter(config.rate_limit_capacity, config.rate_limit_refill_tokens,
-                                       std::chrono::seconds(config.rate_limit_refill_seconds));
+                                       std::chrono::seconds(config.rate_limit_refill_seconds),
+                                       static_cast<std::size_t>(config.rate_limit_max_chats),
+                                       &metrics);
   core::RateLimitedCommandHandler guarded_router(
       admin_guard, limiter, "Rate limit exceeded. Please slow down.", &metrics);
-  core::BotService bot(telegram, guarded_router, &metrics);
+  core::BotService bot(
+      *gateway, guarded_router, &metrics,
+      core::BotServiceOptions{
+          .dispatch_workers = static_cast<std::size_t>(std::max(0, config.dispatch_workers)),
+          .pipeline_depth = static_cast<std::size_t>(std::max(2, config.poll_pipeline_depth)),
+          .poll_limit = config.poll_limit,
+          .poll_timeout = std::chrono::seconds(config.telegram_long_poll_timeout_seconds),
+          .idle_backoff = std::chrono::milliseconds(config.loop_sleep_ms)});
 
-  logger.Log(runtime::LogLevel::kInfo, "bot_starting",
-             {{"component", "app"}, {"has_token", config.bot_token.empty() ? "false" : "true"}});
+  VERTEL_LOG_INFO(logger, "bot_starting",
+                  {{"component", "app"},
+                   {"has_token", !config.bot_token.empty()},
+                   {"shard_role", config.shard_role}});
 
-  while (!runtime::ShutdownSignal::IsRequested()) {
-    const bool processed = retry_policy.Execute(
-        [&] {
-          try {
-            bot.ProcessOnce();
-            return true;
-          } catch (const std::exception &ex) {
-            logger.Log(runtime::LogLevel::kWarn, "poll_iteration_failed",
-                       {{"component", "app"}, {"error", ex.what()}});
-            return false;
+  if (config.inject_sample_start) {
+    bot.ProcessOnce();
+  } else {
+    // getUpdates runs on Run()'s poll thread while this thread handles the
+    // previous batch. Failed polls back off through the retry engine, and an
+    // open circuit holds the next poll back.
+    int poll_attempt = 1;
+    const core::RunOptions run_options{
+        .stop_requested = [] { return runtime::ShutdownSignal::IsRequested(); },
+        .after_poll = [&](const std::exception *error) -> std::chrono::steady_clock::duration {
+          runtime::RetryOutcome outcome{
+              .ok = true, .retryable = true, .retry_after = {}, .error = {}};
+          if (error != nullptr) {
+            outcome = adapters::telegram::RetryOutcomeFor(*error);
+            VERTEL_LOG_WARN(logger, "poll_iteration_failed",
+                            {{"component", "app"}, {"error", error->what()},
+                             {"attempt", poll_attempt}});
           }
-        },
-        [] { return true; });
-
-    if (!processed) {
-      logger.Log(runtime::LogLevel::kError, "poll_iteration_exhausted", {{"component", "app"}});
-    }
-
-    std::this_thread::sleep_for(std::chrono::milliseconds(config.loop_sleep_ms));
-
-    if (config.inject_sample_start) {
-      break;
+          if (const auto decision = retry_engine.Record("getUpdates", poll_attempt, outcome);
+              decision.retry) {
+            ++poll_attempt;
+            return decision.delay;
+          }
+          if (!outcome.ok) {
+            VERTEL_LOG_ERROR(logger, "poll_iteration_exhausted", {{"component", "app"}});
+          }
+          poll_attempt = 1;
+          return retry_engine.Admit("getUpdates");
+        }};
+    if (shard_front) {
+      // Polls Telegram here and leaves handling to the workers.
+      adapters::shard::ShardFront front(
+          adapters::shard::ShardFront::Options{
+              .socket_path = config.shard_socket,
+              .shards = static_cast<std::uint32_t>(config.shard_count),
+              .poll_limit = config.poll_limit,
+              .poll_timeout = std::chrono::seconds(config.telegram_long_poll_timeout_seconds),
+              .idle_backoff = std::chrono::milliseconds(config.loop_sleep_ms)},
+          *ingest, *gateway, &metrics);
+      if (!front.Start()) {
+        VERTEL_LOG_ERROR(logger, "shard_listen_failed",
+                         {{"component", "app"}, {"socket", config.shard_socket}});
+        return 1;
+      }
+      front.Run(run_options);
+      front.Stop();
+    } else {
+      bot.Run(run_options);
     }
   }
 
-  logger.Log(runtime::LogLevel::kInfo, "bot_stopped", {{"component", "app"}});
+  if (outbound != nullptr) {
+    outbound->Drain();
+  }
+  VERTEL_LOG_INFO(logger, "bot_stopped", {{"component", "app"}});
   health_server.Stop();
   return 0;
 }
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "vertel/core/bot_service.hpp"
+#include "vertel/core/telegram_gateway.hpp"
+#include "vertel/runtime/metrics.hpp"
+
+// MSVC: windows.h #defines SendMessage as SendMessageA/W — undo it.
+#ifdef SendMessage
+#undef SendMessage
+#endif
+
+namespace vertel::adapters::shard {
+
+// Front process of a sharded bot. Telegram allows one getUpdates consumer per
+// token, so the front owns ingestion and routes every update to one of N
+// worker processes by ShardForChat(chat_id); each chat's updates reach one
+// worker, in order, and per-chat state can stay local to it.
+//
+// Workers connect over a Unix socket (ShardWorkerGateway) and announce their
+// shard. An update stays queued at the front until its worker acknowledges
+// it, and a worker that reconnects (e.g. after a restart) is sent everything
+// still unacknowledged, so a crashed worker loses no updates; at worst it
+// handles some twice. Replies relayed by workers go out through `outbound`.
+// The ingest gateway is committed up to the oldest unacknowledged update.
+//
+// Each connection gets a reader and a writer thread. Not available on Windows,
+// where Start() returns false.
+class ShardFront {
+public:
+  struct Options {
+    std::string socket_path;
+    std::uint32_t shards{1};
+    // Ingestion pauses while any shard has this many unacknowledged updates.
+    std::size_t max_unacked_per_shard{10000};
+    int poll_limit{100};
+    std::chrono::seconds poll_timeout{25};
+    // An empty poll that returns sooner than this is followed by a pause for
+    // the rest of it.
+    std::chrono::milliseconds idle_backoff{50};
+  };
+
+  // `ingest` and `outbound` may be the same gateway; both must outlive the front.
+  ShardFront(Options options, core::TelegramGateway &ingest, core::TelegramGateway &outbound,
+             runtime::MetricsRegistry *metrics = nullptr);
+  ~ShardFront();
+
+  ShardFront(const ShardFront &) = delete;
+  ShardFront &operator=(const ShardFront &) = delete;
+
+  // Replaces any stale socket file at socket_path and listens on it.
+  bool Start();
+  // Closes the socket and every worker connection; call after Run() returns.
+  void Stop();
+
+  // Polls `ingest` and routes updates until options.stop_requested, with the
+  // after_poll contract of BotService::Run().
+  void Run(const core::RunOptions &options);
+
+  // Updates routed to `shard` and not yet acknowledged.
+  std::size_t Unacked(std::uint32_t shard) const;
+  bool Connected(std::uint32_t shard) const;
+
+private:
+  struct Pending {
+    std::int64_t update_id;
+    std::string frame;
+  };
+
+  struct Connection {
+    int fd;
+    std::uint32_t shard;
+    std::thread reader;
+    std::thread writer;
+    bool finished{false};
+  };
+
+  struct Shard {
+    // Routed updates in id order, until acknowledged.
+    std::deque<Pending> unacked;
+    // unacked[sent..] are not yet written to `connection`.
+    std::size_t sent{0};
+    // Highest update_id written to any connection, to count redeliveries.
+    std::int64_t written_through{0};
+    Connection *connection{nullptr};
+    runtime::Gauge *unacked_gauge{nullptr};
+    runtime::Counter *redelivered{nullptr};
+  };
+
+  void AcceptLoop();
+  // Reads the worker's hello and hands it its shard; closes `fd` otherwise.
+  void Attach(int fd);
+  void ReadLoop(Connection &connection);
+  void WriteLoop(Connection &connection);
+  void ReapConnections(bool all);
+  // First update id the ingest gateway may not forget yet.
+  std::int64_t CommittableLocked() const;
+
+  Options options_;
+  core::TelegramGateway &ingest_;
+  core::TelegramGateway &outbound_;
+  runtime::MetricsRegistry *metrics_;
+  runtime::Counter *relayed_replies_{nullptr};
+
+  mutable std::mutex mutex_;
+  // Signalled when a shard gains updates, acknowledges some or changes
+  // connection, and on Stop().
+  std::condition_variable cv_;
+  std::vector<Shard> shards_;
+  std::int64_t polled_through_{0};
+  bool stopping_{false};
+  // Run()'s thread only.
+  std::int64_t committed_{0};
+
+  int listen_fd_{-1};
+  std::thread accept_thread_;
+  // Guarded by mutex_.
+  std::list<Connection> connections_;
+};
+
+} // namespace vertel::adapters::shard
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "vertel/core/message.hpp"
+#include "vertel/core/update_batch.hpp"
+
+namespace vertel::adapters::shard {
+
+// Framing of the Unix-socket link between a ShardFront and its workers.
+//
+// A frame is a 4-byte little-endian payload length, a type byte and the
+// payload. Integers in payloads are LEB128 varints, signed ones zigzag-coded;
+// a string is a varint length and its bytes. A typical /command update costs
+// about 20 bytes on the wire.
+enum class FrameType : std::uint8_t {
+  // worker -> front, first on every connection: shard index, shard count.
+  kHello = 1,
+  // front -> worker: update_id, chat_id, date, text.
+  kUpdate = 2,
+  // worker -> front: every update of the shard below next_offset is handled.
+  kAck = 3,
+  // worker -> front: chat_id, priority, text, to send through the front.
+  kReply = 4,
+};
+
+inline constexpr std::size_t kFrameHeaderSize = 5;
+inline constexpr std::size_t kMaxFramePayload = std::size_t{1} << 20;
+
+struct Hello {
+  std::uint32_t shard{0};
+  std::uint32_t shards{0};
+};
+
+struct Frame {
+  FrameType type{};
+  std::string_view payload;
+};
+
+void AppendHelloFrame(std::string &out, const Hello &hello);
+void AppendUpdateFrame(std::string &out, const core::UpdateView &update);
+void AppendAckFrame(std::string &out, std::int64_t next_offset);
+void AppendReplyFrame(std::string &out, const core::OutgoingMessage &message);
+
+// Each returns false for a truncated or malformed payload. Decoded texts point
+// into `payload`.
+bool DecodeHello(std::string_view payload, Hello &out);
+bool DecodeUpdate(std::string_view payload, core::UpdateView &out);
+bool DecodeAck(std::string_view payload, std::int64_t &next_offset);
+bool DecodeReply(std::string_view payload, core::OutgoingMessage &out);
+
+// Cuts complete frames off a byte stream received in arbitrary chunks.
+class FrameReader {
+public:
+  void Append(std::string_view bytes);
+
+  // The next complete frame, or nullopt until more bytes arrive. Its payload
+  // stays valid until the next Append(). Throws std::runtime_error when the
+  // length exceeds kMaxFramePayload, as the stream cannot be resynchronised.
+  std::optional<Frame> Next();
+
+  // Bytes received but not yet returned as frames.
+  std::size_t buffered() const { return buffer_.size() - consumed_; }
+
+private:
+  std::string buffer_;
+  std::size_t consumed_{0};
+};
+
+// Shard of `chat_id` among `shards`, by jump consistent hashing: going from N
+// to N + 1 shards moves only 1 / (N + 1) of the chats, all onto the new one.
+std::uint32_t ShardForChat(std::int64_t chat_id, std::uint32_t shards);
+
+} // namespace vertel::adapters::shard
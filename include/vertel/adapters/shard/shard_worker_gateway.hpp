@@ -0,0 +1,92 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vertel/adapters/shard/shard_protocol.hpp"
+#include "vertel/core/telegram_gateway.hpp"
+
+// MSVC: windows.h #defines SendMessage as SendMessageA/W — undo it.
+#ifdef SendMessage
+#undef SendMessage
+#endif
+
+namespace vertel::adapters::shard {
+
+// Worker side of a ShardFront: a TelegramGateway whose polls read the updates
+// the front routes to this shard, so an unchanged BotService runs in each
+// worker process. CommitUpdates() acknowledges handled updates to the front.
+//
+// Replies go back to the front, which sends them, unless an `outbound`
+// gateway is given (e.g. a TelegramClient of the worker's own). Relayed
+// replies written while the front is unreachable are kept and sent first
+// once the worker reconnects; polls keep retrying the connection meanwhile.
+// Updates the front sends again after a reconnect are dropped when this
+// process has already polled them.
+class ShardWorkerGateway final : public core::TelegramGateway {
+public:
+  struct Options {
+    std::string socket_path;
+    std::uint32_t shard{0};
+    // Must match the front's shard count.
+    std::uint32_t shards{1};
+    // Pause after a failed connection attempt, capped at the poll wait.
+    std::chrono::milliseconds reconnect_interval{500};
+    std::size_t max_batch{100};
+    std::chrono::milliseconds poll_wait{1000};
+  };
+
+  explicit ShardWorkerGateway(Options options, core::TelegramGateway *outbound = nullptr);
+  ~ShardWorkerGateway() override;
+
+  ShardWorkerGateway(const ShardWorkerGateway &) = delete;
+  ShardWorkerGateway &operator=(const ShardWorkerGateway &) = delete;
+
+  std::vector<core::Update> PollUpdates() override;
+  // Waits up to `poll_wait` for the first update, then takes what has arrived,
+  // up to `max_batch`.
+  void PollBatch(core::UpdateBatch &batch) override;
+  // Lowers the batch size and wait below max_batch and poll_wait.
+  void SetPollOptions(const core::PollOptions &options) override;
+  void SendMessage(const core::OutgoingMessage &message) override;
+  void SendMessageAsync(const core::OutgoingMessage &message, core::SendCallback done) override;
+  void FlushSends() override;
+  void CommitUpdates(std::int64_t next_offset) override;
+
+  bool Connected() const;
+
+private:
+  // Poll thread only.
+  bool Connect();
+  void Disconnect();
+  // Moves buffered update frames into `batch`; false on a protocol error.
+  bool TakeUpdates(core::UpdateBatch &batch);
+  // Writes queued replies in order; on failure the connection is shut down
+  // and they stay queued. Call with write_mutex_ held.
+  void FlushOutboxLocked();
+  bool WriteLocked(std::string_view bytes);
+
+  Options options_;
+  core::TelegramGateway *outbound_;
+  std::size_t poll_limit_;
+  std::chrono::milliseconds poll_wait_;
+
+  // Poll thread only.
+  FrameReader reader_;
+  std::int64_t delivered_through_{0};
+
+  mutable std::mutex write_mutex_;
+  // Replaced by the poll thread only, under write_mutex_.
+  int fd_{-1};
+  // Set by a failed write; the poll thread reconnects.
+  bool broken_{false};
+  std::deque<std::string> outbox_;
+  std::int64_t acked_{0};
+};
+
+} // namespace vertel::adapters::shard
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <string>
+
+#include "vertel/adapters/telegram/http_connection_pool.hpp"
+
+namespace vertel::adapters::telegram {
+
+// Non-blocking HTTP POST pipeline. Requests go into an outbound queue that a
+// dedicated thread drains through one curl multi handle, keeping up to
+// `max_in_flight` transfers open at once and multiplexing them over HTTP/2
+// when the server supports it. Completions are reported on that thread.
+class AsyncSender {
+public:
+  struct Options {
+    std::size_t max_in_flight{32};
+    long connect_timeout_seconds{10};
+    long request_timeout_seconds{35};
+  };
+
+  struct Response {
+    long status_code{0};
+    std::string body;
+    std::string error; // empty on transport success
+  };
+
+  using Callback = std::function<void(Response)>;
+
+  AsyncSender(std::shared_ptr<HttpConnectionPool> pool, Options options);
+  // Lets queued and in-flight requests finish before stopping the loop.
+  ~AsyncSender();
+
+  AsyncSender(const AsyncSender &) = delete;
+  AsyncSender &operator=(const AsyncSender &) = delete;
+
+  // Requests that share an `ordering_key` (typically the chat id) are sent one
+  // at a time in submission order; unkeyed requests never wait for each other.
+  void Submit(std::string url, std::string form_body, Callback done,
+              std::optional<std::int64_t> ordering_key = std::nullopt);
+
+  // Blocks until every submitted request has completed and its callback ran.
+  void Flush();
+
+  std::size_t Outstanding() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+} // namespace vertel::adapters::telegram
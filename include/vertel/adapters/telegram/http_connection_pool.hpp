@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace vertel::adapters::telegram {
+
+// Keeps warm libcurl easy handles for reuse across requests. All handles share
+// one DNS cache, TLS session cache and connection cache, so a request to a host
+// that was already contacted skips the TCP connect, DNS lookup and TLS handshake.
+// Without libcurl the pool is inert and Acquire() returns empty leases.
+class HttpConnectionPool {
+public:
+  struct Options {
+    std::size_t max_idle_handles{8};
+    long tcp_keepalive_idle_seconds{30};
+    long tcp_keepalive_interval_seconds{15};
+  };
+
+  // Exclusive use of one pooled handle; returns it to the pool on destruction.
+  class Lease {
+  public:
+    Lease() = default;
+    ~Lease();
+
+    Lease(Lease &&other) noexcept;
+    Lease &operator=(Lease &&other) noexcept;
+    Lease(const Lease &) = delete;
+    Lease &operator=(const Lease &) = delete;
+
+    // The underlying CURL* (opaque so this header does not need curl/curl.h).
+    void *handle() const { return handle_; }
+    explicit operator bool() const { return handle_ != nullptr; }
+
+  private:
+    friend class HttpConnectionPool;
+    Lease(HttpConnectionPool *pool, void *handle) : pool_(pool), handle_(handle) {}
+
+    HttpConnectionPool *pool_{nullptr};
+    void *handle_{nullptr};
+  };
+
+  HttpConnectionPool();
+  explicit HttpConnectionPool(Options options);
+  ~HttpConnectionPool();
+
+  HttpConnectionPool(const HttpConnectionPool &) = delete;
+  HttpConnectionPool &operator=(const HttpConnectionPool &) = delete;
+
+  // Hands out an idle handle, or a freshly configured one when none is idle.
+  // Handles come with keep-alive and the shared caches already applied.
+  Lease Acquire();
+
+  // Opens up to `connections` parallel connections by issuing HEAD requests to
+  // `url`, leaving them in the shared connection cache. Returns how many
+  // succeeded; failures are not fatal since the first real request reconnects.
+  std::size_t Warmup(const std::string &url, std::size_t connections);
+
+  std::size_t IdleHandles() const;
+
+private:
+  void Release(void *handle);
+
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+} // namespace vertel::adapters::telegram
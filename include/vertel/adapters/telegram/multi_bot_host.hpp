@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "vertel/adapters/telegram/async_sender.hpp"
+#include "vertel/adapters/telegram/http_connection_pool.hpp"
+#include "vertel/adapters/telegram/telegram_client.hpp"
+#include "vertel/core/bot_service.hpp"
+#include "vertel/core/command_handler.hpp"
+#include "vertel/runtime/metrics.hpp"
+#include "vertel/runtime/offset_checkpoint.hpp"
+#include "vertel/runtime/retry_engine.hpp"
+#include "vertel/runtime/worker_pool.hpp"
+
+namespace vertel::adapters::telegram {
+
+// Runs many bots in one process.
+//
+// Every bot keeps its own TelegramClient (token, offset, checkpoint), handler
+// chain, rate limits and BotService, and its metrics carry a bot="<name>"
+// label. Everything else is shared: one HttpConnectionPool, one AsyncSender
+// for all replies, a second one whose curl multi loop carries every bot's
+// getUpdates long poll, a ShardedWorkerPool that handles polled batches, and
+// one timer thread for backoffs. An idle bot costs an open transfer and its
+// state instead of a poll thread, a send thread and their curl handles.
+//
+// Each bot cycles through poll -> handle -> poll, so it never has two batches
+// out at once and they can go to any worker; a worker stays with a batch
+// until its replies are delivered. A failed poll is retried after the
+// RetryEngine backoff of that bot's "getUpdates/<name>" endpoint, which also
+// gets its own circuit.
+class MultiBotHost {
+public:
+  struct Options {
+    // Threads handling polled batches, shared by all bots.
+    std::size_t workers{4};
+    int long_poll_timeout_seconds{25};
+    int request_timeout_seconds{35};
+    // Sends in flight across all bots.
+    std::size_t max_in_flight_sends{64};
+    int poll_limit{100};
+    // Empty for api.telegram.org; see TelegramClient::SetApiBase().
+    std::string api_base;
+    // An empty poll that returns sooner than this is followed by a pause for
+    // the rest of it.
+    std::chrono::milliseconds idle_backoff{50};
+    runtime::RetryEngineOptions retry{};
+  };
+
+  explicit MultiBotHost(Options options, runtime::MetricsRegistry *metrics = nullptr);
+  // Stops first.
+  ~MultiBotHost();
+
+  MultiBotHost(const MultiBotHost &) = delete;
+  MultiBotHost &operator=(const MultiBotHost &) = delete;
+
+  // The series of bot `name` in the host's registry, for building its handler
+  // chain (router, rate limiter) before AddBot(); null without a registry.
+  runtime::MetricsRegistry *MetricsFor(std::string_view name);
+
+  // Registers a bot before Start(). Throws std::invalid_argument for a
+  // duplicate name. `handler` and `checkpoint` must outlive the host.
+  void AddBot(std::string name, std::string token, core::CommandHandler &handler,
+              runtime::OffsetCheckpoint *checkpoint = nullptr);
+
+  // Starts every bot's first poll and returns. A host starts once.
+  void Start();
+  // Starts no further polls, waits for those in flight (up to the long-poll
+  // timeout, as BotService::Run() does) and for their batches to be handled.
+  void Stop();
+
+  std::size_t size() const { return bots_.size(); }
+
+private:
+  struct Bot {
+    std::string name;
+    std::string endpoint; // "getUpdates/<name>"
+    runtime::MetricsRegistry *metrics;
+    std::unique_ptr<TelegramClient> client;
+    std::unique_ptr<core::BotService> service;
+    core::UpdateBatch batch;
+    std::chrono::steady_clock::time_point poll_started;
+    bool backlog{false};
+    int poll_attempt{1};
+  };
+
+  struct Timer {
+    std::chrono::steady_clock::time_point at;
+    Bot *bot;
+    bool operator>(const Timer &other) const { return at > other.at; }
+  };
+
+  void Poll(Bot &bot);
+  // Runs on the poller's thread.
+  void OnPolled(Bot &bot, std::exception_ptr error);
+  void PollAfter(Bot &bot, std::chrono::steady_clock::duration delay);
+  // Ends a bot's cycle once the host is stopping; call with mutex_ held.
+  void RetireLocked();
+  void RunTimers();
+
+  Options options_;
+  runtime::MetricsRegistry *metrics_;
+  std::shared_ptr<HttpConnectionPool> pool_;
+  std::shared_ptr<AsyncSender> sender_;
+  runtime::RetryEngine retry_;
+  std::map<std::string, std::unique_ptr<runtime::MetricsRegistry>, std::less<>> bot_metrics_;
+  std::vector<std::unique_ptr<Bot>> bots_;
+  // Created by Start(), once the number of long polls is known.
+  std::unique_ptr<AsyncSender> poller_;
+  std::unique_ptr<runtime::ShardedWorkerPool> workers_;
+  std::atomic<std::uint64_t> next_worker_{0};
+
+  std::mutex mutex_;
+  std::condition_variable timer_cv_;
+  std::condition_variable stopped_cv_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+  bool started_{false};
+  bool stopping_{false};
+  // Bots still cycling; Stop() waits for it to reach zero.
+  std::size_t running_{0};
+  std::thread timer_thread_;
+};
+
+} // namespace vertel::adapters::telegram
@@ -1,10 +1,25 @@
 #pragma once
 
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "vertel/adapters/telegram/async_sender.hpp"
+#include "vertel/adapters/telegram/http_connection_pool.hpp"
+#include "vertel/adapters/telegram/update_decoder.hpp"
 #include "vertel/core/telegram_gateway.hpp"
+#include "vertel/runtime/metrics.hpp"
+#include "vertel/runtime/offset_checkpoint.hpp"
+#include "vertel/runtime/retry_engine.hpp"
 
 // MSVC: windows.h (transitively via curl/curl.h) #defines SendMessage as
 // SendMessageA/W. Undo it so our method name compiles correctly.
@@ -14,32 +29,127 @@
 
 namespace vertel::adapters::telegram {
 
+// Thrown when the Bot API answers with an HTTP error status.
+class TelegramApiError : public std::runtime_error {
+public:
+  TelegramApiError(long status_code, std::string description, std::chrono::seconds retry_after);
+
+  long status_code() const noexcept { return status_code_; }
+  const std::string &description() const noexcept { return description_; }
+  // parameters.retry_after of a 429 response; zero otherwise.
+  std::chrono::seconds retry_after() const noexcept { return retry_after_; }
+  // 429 and 5xx are transient; any other 4xx means the request itself is wrong.
+  bool retryable() const noexcept { return status_code_ == 429 || status_code_ >= 500; }
+
+private:
+  long status_code_;
+  std::string description_;
+  std::chrono::seconds retry_after_;
+};
+
+// Builds the TelegramApiError for an error response body such as
+// {"ok":false,"error_code":429,"description":"...","parameters":{"retry_after":5}}.
+// Bodies that are not JSON are used as the description.
+TelegramApiError ParseApiError(long status_code, std::string_view body);
+
+// Describes a failed TelegramClient call for RetryEngine. API errors keep
+// their retry_after and are retryable when transient; transport errors are
+// always retryable.
+vertel::runtime::RetryOutcome RetryOutcomeFor(const std::exception &error);
+
 class TelegramClient final : public vertel::core::TelegramGateway {
 public:
   explicit TelegramClient(bool inject_sample_update);
-  TelegramClient(std::string bot_token, int long_poll_timeout_seconds, int request_timeout_seconds);
+  TelegramClient(std::string bot_token, int long_poll_timeout_seconds, int request_timeout_seconds,
+                 std::shared_ptr<HttpConnectionPool> pool = nullptr,
+                 std::size_t max_in_flight_sends = 32,
+                 vertel::runtime::MetricsRegistry *metrics = nullptr);
+  // Sends replies through `sender` instead of starting a send thread of its
+  // own, so many clients can share one curl multi loop (see MultiBotHost).
+  // Requests of different clients to the same chat id are then serialised too.
+  TelegramClient(std::string bot_token, int long_poll_timeout_seconds, int request_timeout_seconds,
+                 std::shared_ptr<HttpConnectionPool> pool, std::shared_ptr<AsyncSender> sender,
+                 vertel::runtime::MetricsRegistry *metrics = nullptr);
+  // Waits for the client's sends still in flight.
+  ~TelegramClient() override;
+
+  // Sends every request to `api_base` ("https://api.telegram.org" by default)
+  // instead, e.g. a self-hosted Bot API server or a MockBotApi. Call it before
+  // Warmup() and the first request. Only the libcurl transport honours it.
+  void SetApiBase(std::string api_base);
+
+  // Pre-opens `connections` keep-alive connections to the Bot API so the first
+  // replies do not pay for the TCP and TLS handshakes. Returns how many opened.
+  std::size_t Warmup(std::size_t connections);
+
+  // Registers `url` as the bot's webhook (an empty url removes it). Telegram
+  // refuses getUpdates while a webhook is set.
+  void SetWebhook(const std::string &url, const std::string &secret_token = {});
 
   std::vector<vertel::core::Update> PollUpdates() override;
+  void PollBatch(vertel::core::UpdateBatch &batch) override;
+  // Starts the same getUpdates request on `poller` and returns at once; `done`
+  // runs on the poller's thread once the updates are in `batch`, or with the
+  // error. One poll at a time: the next may start once `done` has run.
+  // `poller` needs a request timeout above the long-poll timeout.
+  void PollBatchAsync(AsyncSender &poller, vertel::core::UpdateBatch &batch,
+                      std::function<void(std::exception_ptr error)> done);
+  // Sent as getUpdates' limit and timeout; the timeout is capped at the
+  // long-poll timeout given to the constructor, which the request timeout
+  // was sized for.
+  void SetPollOptions(const vertel::core::PollOptions &options) override;
   void SendMessage(const vertel::core::OutgoingMessage &message) override;
+  void SendMessageAsync(const vertel::core::OutgoingMessage &message,
+                        vertel::core::SendCallback done) override;
+  // Waits for this client's own sends only, also on a shared sender.
+  void FlushSends() override;
+
+  // Resumes polling from the offset stored in `checkpoint` and records every
+  // CommitUpdates() there, so a restart neither replays handled updates nor
+  // skips unhandled ones. Null detaches it. `checkpoint` must outlive the
+  // client or be detached first.
+  void UseCheckpoint(vertel::runtime::OffsetCheckpoint *checkpoint);
+  void CommitUpdates(std::int64_t next_offset) override;
 
+  // Messages "sent" in sample mode; a live client does not keep them. Not
+  // synchronised with concurrent sends; read it once sending has stopped.
   const std::vector<vertel::core::OutgoingMessage> &SentMessages() const;
 
 private:
   struct HttpResponse {
     long status_code{0};
     std::string body;
+    // Time spent inside the decoder, when one was given.
+    std::chrono::nanoseconds decode_time{0};
   };
 
-  HttpResponse PostForm(const std::string &endpoint, const std::string &form_body) const;
-  std::vector<vertel::core::Update> ParseUpdates(const std::string &json) const;
+  // Long-polls getUpdates into `sink`. Returns false when there is no token.
+  bool FetchUpdates(UpdateSink &sink);
+  std::string GetUpdatesFields() const;
+  std::string MethodUrl(const std::string &endpoint) const;
+  // With a decoder, a successful response body is streamed into it as it
+  // arrives instead of being buffered; the returned body is then empty.
+  HttpResponse PostForm(const std::string &endpoint, const std::string &form_body,
+                        UpdateStreamDecoder *decoder = nullptr) const;
   static std::string UrlEncode(const std::string &value);
 
   bool inject_sample_update_{false};
   bool sample_emitted_{false};
   std::string bot_token_;
+  std::string api_base_;
   int long_poll_timeout_seconds_{25};
   int request_timeout_seconds_{35};
+  vertel::core::PollOptions poll_options_{};
   std::int64_t next_update_offset_{0};
+  vertel::runtime::OffsetCheckpoint *checkpoint_{nullptr};
+  std::shared_ptr<HttpConnectionPool> pool_;
+  std::shared_ptr<AsyncSender> sender_;
+  vertel::runtime::MetricsRegistry *metrics_{nullptr};
+  // Sends submitted to sender_ whose callback has not run yet.
+  std::mutex sends_mutex_;
+  std::condition_variable sends_idle_;
+  std::size_t pending_sends_{0};
+  std::mutex sent_mutex_;
   std::vector<vertel::core::OutgoingMessage> sent_messages_;
 };
 
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vertel/core/message.hpp"
+#include "vertel/core/update_batch.hpp"
+
+namespace vertel::adapters::telegram {
+
+// Receives updates as the decoder completes them. `update.text` points into
+// decoder scratch space and is only valid for the duration of the call.
+class UpdateSink {
+public:
+  virtual ~UpdateSink() = default;
+  virtual void OnUpdate(const vertel::core::UpdateView &update) = 0;
+};
+
+// Appends every decoded update to a vector.
+class UpdateCollector final : public UpdateSink {
+public:
+  explicit UpdateCollector(std::vector<vertel::core::Update> &out) : out_(out) {}
+
+  void OnUpdate(const vertel::core::UpdateView &update) override {
+    out_.push_back(vertel::core::ToUpdate(update));
+  }
+
+private:
+  std::vector<vertel::core::Update> &out_;
+};
+
+// Copies every decoded update into a batch arena; no per-update allocation.
+class UpdateBatchCollector final : public UpdateSink {
+public:
+  explicit UpdateBatchCollector(vertel::core::UpdateBatch &batch) : batch_(batch) {}
+
+  void OnUpdate(const vertel::core::UpdateView &update) override {
+    batch_.Add(update.update_id, update.chat_id, update.text, update.date);
+  }
+
+private:
+  vertel::core::UpdateBatch &batch_;
+};
+
+// Incremental JSON scanner for Bot API update payloads. Bytes can be fed in
+// arbitrary chunks as they come off the network; the decoder never builds a
+// DOM and only materialises the fields BotService needs (update_id,
+// message.chat.id, message.text, message.date), reusing its buffers across
+// updates.
+// Updates without a text message, or whose ids are not integers, are skipped.
+class UpdateStreamDecoder {
+public:
+  enum class Mode {
+    kGetUpdatesResponse, // {"ok":true,"result":[update, ...]}
+    kSingleUpdate,       // one update object, as POSTed to a webhook
+  };
+
+  explicit UpdateStreamDecoder(UpdateSink &sink, Mode mode = Mode::kGetUpdatesResponse);
+
+  // Prepares the decoder for a new document, keeping buffer capacity.
+  void Reset();
+
+  // Throws std::runtime_error on malformed JSON.
+  void Feed(std::string_view chunk);
+
+  // Throws std::runtime_error when the document is truncated or, for
+  // getUpdates responses, when "ok" is not true.
+  void Finish();
+
+private:
+  enum class Context : std::uint8_t { kRoot, kResult, kUpdate, kMessage, kChat, kOther };
+  enum class Key : std::uint8_t {
+    kNone,
+    kOk,
+    kResult,
+    kUpdateId,
+    kMessage,
+    kChat,
+    kText,
+    kDate,
+    kId,
+  };
+  enum class Expect : std::uint8_t {
+    kValue,
+    kFirstValueOrEnd,
+    kFirstKeyOrEnd,
+    kKey,
+    kColon,
+    kCommaOrEnd,
+    kDone,
+  };
+  enum class Lex : std::uint8_t {
+    kStructure,
+    kString,
+    kEscape,
+    kUnicode,
+    kLowSurrogateBackslash,
+    kLowSurrogateU,
+    kNumber,
+    kLiteral,
+  };
+  enum class StringTarget : std::uint8_t { kKey, kText, kDiscard };
+
+  struct Frame {
+    Context context;
+    bool is_object;
+    Key key;
+  };
+
+  [[noreturn]] static void Fail(const char *what);
+
+  void Structural(char c);
+  void BeginValue(char c);
+  void OpenContainer(bool is_object);
+  void CloseContainer();
+  void ValueDone();
+  void EndString();
+  void EndNumber();
+  void EndLiteral();
+  void OnScalar(bool is_integer, std::int64_t integer, bool is_true, bool is_string);
+  void AppendCodePoint(std::uint32_t code_point);
+  void AppendString(std::string_view bytes);
+
+  UpdateSink &sink_;
+  Mode mode_;
+
+  std::vector<Frame> stack_;
+  Expect expect_{Expect::kValue};
+  Lex lex_{Lex::kStructure};
+  StringTarget string_target_{StringTarget::kDiscard};
+  std::string key_;
+  std::string text_;
+  std::string number_;
+  std::string_view literal_;
+  std::size_t literal_pos_{0};
+  std::uint32_t unicode_value_{0};
+  int unicode_digits_{0};
+  std::uint32_t high_surrogate_{0};
+
+  bool ok_{false};
+  bool has_update_id_{false};
+  bool has_chat_id_{false};
+  bool has_text_{false};
+  std::int64_t update_id_{0};
+  std::int64_t chat_id_{0};
+  std::int64_t date_{0};
+};
+
+// Decodes a getUpdates response (`{"ok":true,"result":[...]}`). Throws
+// std::runtime_error on malformed JSON or `"ok":false`; updates without a text
+// message are skipped.
+std::vector<vertel::core::Update> DecodeGetUpdatesResponse(std::string_view json);
+
+// Decodes one Update object, as Telegram POSTs it to a webhook. Returns
+// std::nullopt for updates without a text message; throws on malformed JSON.
+std::optional<vertel::core::Update> DecodeUpdate(std::string_view json);
+
+} // namespace vertel::adapters::telegram
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "vertel/core/telegram_gateway.hpp"
+#include "vertel/runtime/http_server.hpp"
+
+// MSVC: windows.h #defines SendMessage as SendMessageA/W — undo it.
+#ifdef SendMessage
+#undef SendMessage
+#endif
+
+namespace vertel::adapters::telegram {
+
+// Receives updates through Telegram's webhook instead of long polling. An
+// epoll HTTP listener acknowledges each POST with 200 as soon as the update is
+// decoded and queued; PollUpdates() hands queued updates to BotService.
+// Replies still go out through the `outbound` gateway (usually a TelegramClient).
+class WebhookGateway final : public vertel::core::TelegramGateway {
+public:
+  struct Options {
+    int port{8443};
+    std::string path{"/telegram/webhook"};
+    // Compared with X-Telegram-Bot-Api-Secret-Token when not empty.
+    std::string secret_token;
+    std::size_t listener_threads{2};
+    std::size_t max_batch{100};
+    // Once this many updates are waiting, POSTs get 503 and Telegram retries later.
+    std::size_t max_queued_updates{10000};
+    std::chrono::milliseconds poll_wait{1000};
+  };
+
+  WebhookGateway(Options options, vertel::core::TelegramGateway &outbound);
+  ~WebhookGateway() override;
+
+  WebhookGateway(const WebhookGateway &) = delete;
+  WebhookGateway &operator=(const WebhookGateway &) = delete;
+
+  bool Start();
+  void Stop();
+  int port() const { return server_.port(); }
+
+  // Waits up to `poll_wait` for the first update, then drains up to `max_batch`.
+  std::vector<vertel::core::Update> PollUpdates() override;
+  void PollBatch(vertel::core::UpdateBatch &batch) override;
+  // Lowers the batch size and wait below max_batch and poll_wait.
+  void SetPollOptions(const vertel::core::PollOptions &options) override;
+  void SendMessage(const vertel::core::OutgoingMessage &message) override;
+  void SendMessageAsync(const vertel::core::OutgoingMessage &message,
+                        vertel::core::SendCallback done) override;
+  void FlushSends() override;
+
+  std::size_t QueuedUpdates() const;
+
+private:
+  void HandleRequest(const runtime::HttpRequest &request, runtime::HttpResponse &response);
+
+  Options options_;
+  vertel::core::TelegramGateway &outbound_;
+  mutable std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<vertel::core::Update> queue_;
+  std::size_t poll_limit_;
+  std::chrono::milliseconds poll_wait_;
+  runtime::HttpServer server_;
+};
+
+} // namespace vertel::adapters::telegram
@@ -1,22 +1,111 @@
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <span>
+
 #include "vertel/core/command_handler.hpp"
 #include "vertel/core/telegram_gateway.hpp"
+#include "vertel/runtime/executor.hpp"
 #include "vertel/runtime/metrics.hpp"
+#include "vertel/runtime/spsc_ring.hpp"
+#include "vertel/runtime/worker_pool.hpp"
 
 namespace vertel::core {
 
+struct BotServiceOptions {
+  // 0 handles updates on the polling thread. N > 0 shards updates by chat_id
+  // onto N workers: each chat stays in order, different chats run in parallel.
+  // The handler chain and gateway must then be safe to call concurrently.
+  std::size_t dispatch_workers{0};
+  // When set, every update runs as CommandHandler::HandleAsync() on this
+  // executor and ProcessOnce() returns without waiting for it, so handlers
+  // that await I/O stay in flight across polls; dispatch_workers is then
+  // ignored. Replies to one chat may complete out of order. The executor must
+  // be drained (WaitIdle()) before the BotService is destroyed.
+  runtime::Executor *executor{nullptr};
+
+  // The rest only affects Run().
+  // Batches Run() holds between its poll thread and the handling thread: one
+  // being handled and one being fetched at the least.
+  std::size_t pipeline_depth{2};
+  // getUpdates limit, and the long-poll timeout used while the bot is idle.
+  int poll_limit{100};
+  std::chrono::seconds poll_timeout{25};
+  // An empty poll that returns sooner than this is followed by a pause for the
+  // rest of it, so gateways that do not block while idle are not spun on.
+  std::chrono::milliseconds idle_backoff{50};
+};
+
+struct RunOptions {
+  // Checked before every poll; Run() returns once it is true and the batches
+  // already fetched have been handled.
+  std::function<bool()> stop_requested;
+  // Called on the poll thread after every poll with the exception it threw,
+  // or null. Returns how long to wait before polling again, e.g. a
+  // RetryEngine backoff. Without it, a failed poll ends Run() and is rethrown.
+  std::function<std::chrono::steady_clock::duration(const std::exception *error)> after_poll;
+};
+
 class BotService {
 public:
   BotService(TelegramGateway &gateway, CommandHandler &handler,
-             runtime::MetricsRegistry *metrics = nullptr);
+             runtime::MetricsRegistry *metrics = nullptr, BotServiceOptions options = {});
 
+  // Polls once and handles the batch on the calling thread.
   void ProcessOnce();
 
+  // Handles a batch polled elsewhere (e.g. by a MultiBotHost) the way
+  // ProcessOnce() handles its own: replies are delivered and the batch is
+  // committed before it returns.
+  void ProcessBatch(const UpdateBatch &batch);
+
+  // Polls on a dedicated thread and handles batches on the calling one, so the
+  // next getUpdates is in flight while the previous batch is handled and its
+  // replies are sent. Batches pass through a SPSC ring; a full batch makes
+  // the next poll return at once and only idle polls wait the full timeout.
+  // The gateway's PollBatch() then runs concurrently with its sends and
+  // commits. A poll acknowledges the previous batch to Telegram before it has
+  // been handled, so up to pipeline_depth batches are lost on a crash unless
+  // the gateway resumes from its committed offset. Not to be combined with
+  // concurrent ProcessOnce() calls.
+  void Run(const RunOptions &options);
+
 private:
+  class ReplyCollector;
+
+  void Dispatch(const UpdateBatch &batch);
+  void PollLoop(runtime::SpscRing<UpdateBatch> &ring, const RunOptions &options,
+                const std::atomic<bool> &aborted, std::exception_ptr &error);
+  void HandleBatch(std::span<const UpdateView> updates);
+  void HandleUpdate(const UpdateView &update);
+  runtime::Task<> HandleUpdateAsync(Update update);
+  void SendReply(const OutgoingMessage &response, std::int64_t date);
+  void CommitHandled();
+
   TelegramGateway &gateway_;
   CommandHandler &handler_;
   runtime::MetricsRegistry *metrics_;
+  std::unique_ptr<runtime::ShardedWorkerPool> workers_;
+  runtime::Executor *executor_{nullptr};
+  std::size_t pipeline_depth_;
+  PollOptions poll_options_;
+  std::chrono::milliseconds idle_backoff_;
+  // Reused across polls so its arena stops allocating once warm.
+  UpdateBatch batch_;
+  // One past the highest update polled, and the offset last committed.
+  std::int64_t polled_up_to_{0};
+  std::int64_t committed_{0};
+  // Update ids still running on the executor; commits stop below the oldest.
+  std::mutex in_flight_mutex_;
+  std::multiset<std::int64_t> in_flight_;
 };
 
 } // namespace vertel::core
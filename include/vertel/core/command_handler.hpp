@@ -1,69 +1,152 @@
 #pragma once
 
-#include <chrono>
 #include <cstdint>
+#include <exception>
 #include <functional>
-#include <mutex>
 #include <optional>
+#include <span>
 #include <string>
+#include <string_view>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "vertel/core/command_view.hpp"
 #include "vertel/core/message.hpp"
+#include "vertel/core/rate_limiter.hpp"
+#include "vertel/core/update_batch.hpp"
 #include "vertel/runtime/metrics.hpp"
+#include "vertel/runtime/task.hpp"
 
 namespace vertel::core {
 
+// Receives the outcome of each update of a HandleBatch() call. `update` is
+// always an element of the span the batch was given, in span order; updates
+// that produce no reply are not reported.
+class ReplySink {
+public:
+  virtual ~ReplySink() = default;
+  virtual void Reply(const UpdateView &update, OutgoingMessage message) = 0;
+  // Handling `update` threw; the rest of the batch is still handled.
+  virtual void Fail(const UpdateView &update, const std::exception &error) = 0;
+};
+
 class CommandHandler {
 public:
   virtual ~CommandHandler() = default;
   virtual std::optional<OutgoingMessage> Handle(const Update &update) = 0;
+
+  // Batch path used by BotService. The default materialises an Update for
+  // Handle(); handlers that can work on the view override it to skip the copy.
+  virtual std::optional<OutgoingMessage> HandleView(const UpdateView &update) {
+    return Handle(ToUpdate(update));
+  }
+
+  // Called by CommandRouter for a handler registered under `command.name`,
+  // with the command already parsed. Defaults to HandleView().
+  virtual std::optional<OutgoingMessage> HandleCommand(const UpdateView &update,
+                                                       const CommandView &command) {
+    (void)command;
+    return HandleView(update);
+  }
+
+  // Coroutine path used by BotService when it dispatches on a
+  // runtime::Executor. The update is taken by value because the handler may
+  // outlive the batch it came from. Handlers that wait on I/O override this
+  // and co_await instead of blocking; the default runs HandleView() inline.
+  virtual runtime::Task<std::optional<OutgoingMessage>> HandleAsync(Update update);
+
+  // Handles a whole poll at once, which lets middleware filter it in one pass
+  // and handlers batch their backend lookups. The default calls HandleView()
+  // per update and reports exceptions through the sink.
+  virtual void HandleBatch(std::span<const UpdateView> updates, ReplySink &sink);
+
+  // Batch form of HandleCommand(), used by CommandRouter for a run of updates
+  // routed to this handler; `commands[i]` is the parsed `updates[i]`.
+  virtual void HandleCommandBatch(std::span<const UpdateView> updates,
+                                  std::span<const CommandView> commands, ReplySink &sink);
+};
+
+// Base for handlers that only have a coroutine implementation. The
+// synchronous entry points throw std::logic_error, so it must be dispatched by
+// a BotService with an executor.
+class AsyncCommandHandler : public CommandHandler {
+public:
+  std::optional<OutgoingMessage> Handle(const Update &update) final;
+  runtime::Task<std::optional<OutgoingMessage>> HandleAsync(Update update) override = 0;
 };
 
 class StartCommandHandler final : public CommandHandler {
 public:
   std::optional<OutgoingMessage> Handle(const Update &update) override;
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override;
+  std::optional<OutgoingMessage> HandleCommand(const UpdateView &update,
+                                               const CommandView &command) override;
 };
 
 class HelpCommandHandler final : public CommandHandler {
 public:
   std::optional<OutgoingMessage> Handle(const Update &update) override;
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override;
+  std::optional<OutgoingMessage> HandleCommand(const UpdateView &update,
+                                               const CommandView &command) override;
 };
 
 class PingCommandHandler final : public CommandHandler {
 public:
   std::optional<OutgoingMessage> Handle(const Update &update) override;
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override;
+  std::optional<OutgoingMessage> HandleCommand(const UpdateView &update,
+                                               const CommandView &command) override;
 };
 
+// Parses each update once and dispatches commands through a hash index keyed
+// by command name, so routing cost does not grow with the number of commands.
+// Text that is not a registered command falls through to the handlers given to
+// the constructor, tried in order. With a MetricsRegistry, every registered
+// command gets its own vertel_commands_total and vertel_command_duration_seconds
+// series, labeled by command.
 class CommandRouter final : public CommandHandler {
 public:
-  explicit CommandRouter(std::vector<std::reference_wrapper<CommandHandler>> handlers);
+  explicit CommandRouter(std::vector<std::reference_wrapper<CommandHandler>> fallback = {},
+                         std::string bot_username = {},
+                         runtime::MetricsRegistry *metrics = nullptr);
+
+  // Routes "/name", "/name args" and "/name@bot_username ..." to `handler`.
+  // Replaces any handler already registered under `name` (given without '/').
+  void Register(std::string name, CommandHandler &handler);
 
   std::optional<OutgoingMessage> Handle(const Update &update) override;
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override;
+  // Awaits the registered handler's HandleAsync(), then the fallback chain's.
+  runtime::Task<std::optional<OutgoingMessage>> HandleAsync(Update update) override;
+  // Hands each run of consecutive updates for the same command to its
+  // handler's HandleCommandBatch(); the rest go through the fallback chain.
+  void HandleBatch(std::span<const UpdateView> updates, ReplySink &sink) override;
 
 private:
-  std::vector<std::reference_wrapper<CommandHandler>> handlers_;
-};
-
-class TokenBucketRateLimiter {
-public:
-  TokenBucketRateLimiter(int capacity, int refill_tokens,
-                         std::chrono::seconds refill_period = std::chrono::seconds(1));
-
-  bool Allow(std::int64_t chat_id);
+  struct NameHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
 
-private:
-  struct Bucket {
-    double tokens{0.0};
-    std::chrono::steady_clock::time_point last_refill;
+  struct Route {
+    std::reference_wrapper<CommandHandler> handler;
+    // Null without a MetricsRegistry.
+    runtime::Counter *calls{nullptr};
+    runtime::LatencyHistogram *duration{nullptr};
   };
 
-  int capacity_;
-  int refill_tokens_;
-  std::chrono::seconds refill_period_;
-  std::mutex mutex_;
-  std::unordered_map<std::int64_t, Bucket> buckets_;
+  void DispatchRun(const Route &route, std::span<const UpdateView> updates,
+                   std::span<const CommandView> commands, ReplySink &sink);
+  void HandleFallback(const UpdateView &update, ReplySink &sink);
+
+  std::unordered_map<std::string, Route, NameHash, std::equal_to<>> commands_;
+  std::vector<std::reference_wrapper<CommandHandler>> fallback_;
+  std::string bot_username_;
+  runtime::MetricsRegistry *metrics_{nullptr};
 };
 
 class RateLimitedCommandHandler final : public CommandHandler {
@@ -73,6 +156,11 @@ public:
                             runtime::MetricsRegistry *metrics = nullptr);
 
   std::optional<OutgoingMessage> Handle(const Update &update) override;
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override;
+  runtime::Task<std::optional<OutgoingMessage>> HandleAsync(Update update) override;
+  // Answers rejected updates itself and passes the runs in between to the
+  // inner handler's HandleBatch(), keeping the batch order.
+  void HandleBatch(std::span<const UpdateView> updates, ReplySink &sink) override;
 
 private:
   CommandHandler &inner_;
@@ -88,6 +176,11 @@ public:
                                std::string rejection_text = "Unauthorized.");
 
   std::optional<OutgoingMessage> Handle(const Update &update) override;
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override;
+  runtime::Task<std::optional<OutgoingMessage>> HandleAsync(Update update) override;
+  // Answers rejected updates itself and passes the runs in between to the
+  // inner handler's HandleBatch(), keeping the batch order.
+  void HandleBatch(std::span<const UpdateView> updates, ReplySink &sink) override;
 
 private:
   CommandHandler &inner_;
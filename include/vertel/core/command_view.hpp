@@ -0,0 +1,28 @@
+#pragma once
+
+#include <optional>
+#include <string_view>
+
+namespace vertel::core {
+
+// A bot command split out of message text, e.g. "/ban@my_bot 42 spam" gives
+// name "ban", bot_username "my_bot" and args "42 spam". All fields view the
+// original text.
+struct CommandView {
+  std::string_view name;
+  std::string_view bot_username; // empty unless the command was addressed
+  std::string_view args;         // leading whitespace removed
+};
+
+// Returns std::nullopt unless `text` starts with '/' followed by a name.
+std::optional<CommandView> ParseCommand(std::string_view text);
+
+// True unless the command names a bot other than `bot_username`. Unaddressed
+// commands, or an empty `bot_username`, always match. Case-insensitive, like
+// Telegram usernames.
+bool IsAddressedTo(const CommandView &command, std::string_view bot_username);
+
+// Pops the next whitespace-separated argument off `args`; empty when none remain.
+std::string_view NextArgument(std::string_view &args);
+
+} // namespace vertel::core
@@ -9,11 +9,18 @@ struct Update {
   std::int64_t update_id{};
   std::int64_t chat_id{};
   std::string text;
+  // message.date: Unix time in seconds at which Telegram received the message.
+  std::int64_t date{};
 };
 
+// Used by OutboundScheduler: interactive replies go out ahead of bulk traffic
+// such as broadcasts.
+enum class MessagePriority : std::uint8_t { kInteractive, kBulk };
+
 struct OutgoingMessage {
   std::int64_t chat_id{};
   std::string text;
+  MessagePriority priority{MessagePriority::kInteractive};
 };
 
 } // namespace vertel::core
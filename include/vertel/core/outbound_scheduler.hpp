@@ -0,0 +1,139 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <queue>
+#include <set>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "vertel/core/telegram_gateway.hpp"
+#include "vertel/runtime/metrics.hpp"
+
+namespace vertel::core {
+
+struct OutboundSchedulerOptions {
+  // Telegram's documented limits: ~30 messages/s per bot, 1/s per chat and
+  // 20/min per group. Group and channel ids are negative.
+  double max_messages_per_second{30.0};
+  std::chrono::milliseconds private_chat_interval{1000};
+  std::chrono::milliseconds group_chat_interval{3000};
+  // Cap on the global interval while backing off from HTTP 429 responses.
+  std::chrono::milliseconds max_backoff_interval{1000};
+  // Times a message refused with HTTP 429 is queued again before its
+  // callback gets the 429.
+  int max_throttled_retries{3};
+};
+
+// Gateway decorator that paces outgoing messages to stay inside Telegram's
+// flood limits instead of being rejected with HTTP 429.
+//
+// Each chat has a virtual clock (the earliest time its next message may go
+// out) and so does the bot as a whole; a message is released when both have
+// passed. Chats waiting in the interactive lane are served before the bulk
+// lane. A 429 from the inner gateway doubles the global interval, and each
+// accepted message shrinks it again towards the configured rate, so the queue
+// drains at the highest rate Telegram currently accepts. The refused message
+// goes back to the head of its chat's lane, keeping the chat's order, and is
+// sent again once retry_after has passed.
+//
+// SendMessageAsync() only queues. FlushSends() waits for messages already
+// released to the inner gateway, not for queued ones still waiting for their
+// slot; Drain() waits for those too. So that a crash cannot lose queued
+// replies, CommitUpdates() is held back until every message queued before it
+// has completed, and is passed on by a later CommitUpdates(), FlushSends() or
+// Drain() call.
+class OutboundScheduler final : public TelegramGateway {
+public:
+  OutboundScheduler(TelegramGateway &inner, OutboundSchedulerOptions options = {},
+                    runtime::MetricsRegistry *metrics = nullptr);
+  // Messages still queued are completed with an error.
+  ~OutboundScheduler() override;
+
+  OutboundScheduler(const OutboundScheduler &) = delete;
+  OutboundScheduler &operator=(const OutboundScheduler &) = delete;
+
+  std::vector<Update> PollUpdates() override;
+  void PollBatch(UpdateBatch &batch) override;
+  void SetPollOptions(const PollOptions &options) override;
+  // Queues the message and blocks until it has been delivered.
+  void SendMessage(const OutgoingMessage &message) override;
+  void SendMessageAsync(const OutgoingMessage &message, SendCallback done) override;
+  void FlushSends() override;
+  void CommitUpdates(std::int64_t next_offset) override;
+
+  // Blocks until every queued message has been delivered.
+  void Drain();
+  std::size_t QueuedMessages() const;
+
+private:
+  using Clock = std::chrono::steady_clock;
+  static constexpr std::size_t kLanes = 2;
+
+  struct Pending {
+    OutgoingMessage message;
+    SendCallback done;
+    int throttled{0};
+    std::uint64_t ticket{0};
+  };
+
+  struct ChatState {
+    std::array<std::deque<Pending>, kLanes> lanes;
+    Clock::time_point next_send{};
+  };
+
+  // A chat with messages waiting in a lane, ordered by when it may send.
+  struct Ready {
+    Clock::time_point at;
+    std::uint64_t sequence;
+    std::int64_t chat_id;
+
+    bool operator>(const Ready &other) const {
+      return at != other.at ? at > other.at : sequence > other.sequence;
+    }
+  };
+  using ReadyQueue = std::priority_queue<Ready, std::vector<Ready>, std::greater<>>;
+
+  void Run();
+  void OnResult(const SendResult &result);
+  // Queues a message refused with 429 again; false once it is out of retries
+  // or the scheduler is stopping.
+  bool Requeue(Pending &pending, const SendResult &result);
+  // Passes the newest held-back commit whose messages have all completed on
+  // to the inner gateway.
+  void ForwardCommits();
+  Clock::duration ChatInterval(std::int64_t chat_id) const;
+
+  TelegramGateway &inner_;
+  OutboundSchedulerOptions options_;
+  runtime::MetricsRegistry *metrics_;
+  Clock::duration base_interval_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_cv_;
+  std::condition_variable idle_cv_;
+  std::unordered_map<std::int64_t, ChatState> chats_;
+  std::array<ReadyQueue, kLanes> ready_;
+  std::uint64_t sequence_{0};
+  std::size_t queued_{0};
+  std::size_t in_flight_{0};
+  Clock::time_point global_next_{};
+  Clock::duration global_interval_;
+  bool stopping_{false};
+  // Messages accepted so far, and the ones among them not yet completed.
+  std::uint64_t next_ticket_{0};
+  std::set<std::uint64_t> unsettled_;
+  // Commits waiting for the messages accepted before them: (ticket, offset).
+  std::deque<std::pair<std::uint64_t, std::int64_t>> commits_;
+  // Serialises the inner gateway's CommitUpdates() across callers.
+  std::mutex commit_mutex_;
+  std::thread thread_;
+};
+
+} // namespace vertel::core
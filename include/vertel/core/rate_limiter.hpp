@@ -0,0 +1,86 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+
+#include "vertel/runtime/metrics.hpp"
+
+namespace vertel::core {
+
+// Per-chat rate limiter: bursts of up to `capacity` messages, refilled at
+// `refill_tokens` per `refill_period`.
+//
+// Implemented as GCRA: each chat's state is a single 64-bit "theoretical
+// arrival time" in integer nanoseconds, advanced by one emission interval per
+// allowed message. Chats are spread over cache-line-aligned shards, each an
+// open-addressing table whose slots are claimed under the shard mutex and
+// then updated with a lock-free compare-exchange, so Allow() on a known chat
+// never takes a lock.
+//
+// Memory is bounded by `max_tracked_chats` (rounded up to a multiple of the
+// shard count). A CLOCK hand sweeps a few slots on every insert and drops
+// chats whose bucket has refilled completely, which is indistinguishable from
+// never having seen them. Only when a shard is full of active chats is the
+// chat under the hand evicted early; it then starts over with a fresh burst.
+class TokenBucketRateLimiter {
+public:
+  static constexpr std::size_t kDefaultMaxTrackedChats = 65536;
+
+  TokenBucketRateLimiter(int capacity, int refill_tokens,
+                         std::chrono::seconds refill_period = std::chrono::seconds(1),
+                         std::size_t max_tracked_chats = kDefaultMaxTrackedChats,
+                         runtime::MetricsRegistry *metrics = nullptr);
+  ~TokenBucketRateLimiter();
+
+  TokenBucketRateLimiter(const TokenBucketRateLimiter &) = delete;
+  TokenBucketRateLimiter &operator=(const TokenBucketRateLimiter &) = delete;
+
+  bool Allow(std::int64_t chat_id);
+
+  // Chats currently holding rate-limit state.
+  std::size_t TrackedChats() const;
+
+private:
+  static constexpr std::size_t kShardCount = 64;
+  // Slots examined by the CLOCK hand per insert.
+  static constexpr std::size_t kSweepStep = 4;
+
+  struct Slot {
+    std::atomic<std::int64_t> key;
+    // Theoretical arrival time, or EncodeEvicted(tat) once the chat is gone.
+    std::atomic<std::int64_t> tat;
+  };
+
+  struct alignas(64) Shard {
+    std::mutex mutex;
+    std::unique_ptr<Slot[]> slots;
+    std::size_t live{0};
+    std::size_t hand{0};
+  };
+
+  std::int64_t NowNanos() const;
+  Slot *Find(Shard &shard, std::size_t home, std::int64_t chat_id) const;
+  // Lock-free update of a slot found for `chat_id`. Returns false when the
+  // chat was evicted meanwhile and the caller must retry under the mutex.
+  bool TryConsume(Slot &slot, std::int64_t chat_id, std::int64_t now, bool &allowed) const;
+  void Insert(Shard &shard, std::size_t home, std::int64_t chat_id, std::int64_t now);
+  // The helpers below require the shard mutex.
+  bool Evict(Shard &shard, std::size_t index, std::int64_t now, bool idle_only);
+  std::size_t Sweep(Shard &shard, std::int64_t now, std::size_t steps);
+  void ForceEvict(Shard &shard, std::int64_t now);
+
+  std::int64_t emission_interval_ns_;
+  std::int64_t burst_ns_;
+  std::size_t slots_per_shard_;
+  std::size_t max_live_per_shard_;
+  std::chrono::steady_clock::time_point epoch_;
+  runtime::MetricsRegistry *metrics_;
+  std::atomic<std::int64_t> tracked_{0};
+  std::unique_ptr<Shard[]> shards_;
+};
+
+} // namespace vertel::core
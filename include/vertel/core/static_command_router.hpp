@@ -0,0 +1,260 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "vertel/core/command_handler.hpp"
+#include "vertel/core/command_view.hpp"
+
+namespace vertel::core {
+
+// A string literal usable as a template argument: Cmd<"start", ...>.
+template <std::size_t N> struct CommandName {
+  char value[N]{};
+
+  constexpr CommandName(const char (&name)[N]) { std::copy_n(name, N, value); }
+  constexpr std::string_view view() const { return {value, N - 1}; }
+};
+
+// One entry of a StaticCommandRouter: routes "/Name" to a Handler. Handler is
+// stored by value, or by reference when given as `H&`.
+template <CommandName Name, typename Handler> struct Cmd {
+  static constexpr std::string_view kName = Name.view();
+  using HandlerType = Handler;
+};
+
+template <typename H>
+concept StaticCommandHandler =
+    requires(std::remove_reference_t<H> &handler, const UpdateView &update,
+             const CommandView &command) {
+      { handler.HandleCommand(update, command) } -> std::same_as<std::optional<OutgoingMessage>>;
+    };
+
+struct StaticCommandRouterOptions {
+  std::string bot_username;
+  // Receives updates that are not one of the table's commands.
+  CommandHandler *fallback{nullptr};
+};
+
+namespace detail {
+
+constexpr std::uint32_t CommandHash(std::string_view name, std::uint32_t seed) {
+  std::uint32_t hash = 2166136261u ^ seed;
+  for (const char c : name) {
+    hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u;
+  }
+  return hash;
+}
+
+// Final step of MurmurHash3: spreads every input bit over the result.
+constexpr std::uint32_t MixHash(std::uint32_t hash) {
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+  return hash;
+}
+
+template <std::size_t N> struct PerfectHashTable {
+  static constexpr std::size_t kSlots = std::bit_ceil(N * 2);
+  static constexpr std::size_t kBuckets = std::bit_ceil(N);
+  static constexpr std::uint8_t kEmpty = 0xFF;
+
+  std::uint32_t seed{0};
+  std::array<std::uint16_t, kBuckets> displacements{};
+  std::array<std::uint8_t, kSlots> slots{};
+  bool found{false};
+
+  static constexpr std::size_t Place(std::uint32_t hash, std::uint16_t displacement) {
+    return MixHash(hash ^ (static_cast<std::uint32_t>(displacement) * 0x9e3779b9u)) &
+           (kSlots - 1);
+  }
+
+  constexpr std::size_t Slot(std::string_view name) const {
+    const std::uint32_t hash = CommandHash(name, seed);
+    return Place(hash, displacements[hash & (kBuckets - 1)]);
+  }
+};
+
+template <std::size_t N>
+consteval bool HasUniqueNames(const std::array<std::string_view, N> &names) {
+  for (std::size_t i = 0; i < N; ++i) {
+    for (std::size_t j = i + 1; j < N; ++j) {
+      if (names[i] == names[j]) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Hash and displace: names are grouped into buckets by their hash and each
+// bucket, largest first, gets the first displacement that moves all of its
+// names into free slots. Buckets are searched one at a time, so the work grows
+// about linearly with the number of names. The seed only changes when two
+// names share all 32 hash bits, which no displacement can separate.
+template <std::size_t N>
+consteval PerfectHashTable<N> BuildPerfectHash(const std::array<std::string_view, N> &names) {
+  using Table = PerfectHashTable<N>;
+  constexpr std::uint32_t kSeeds = 16;
+  constexpr std::uint32_t kDisplacements = 1u << 16;
+  constexpr std::size_t kBucketMask = Table::kBuckets - 1;
+
+  Table table;
+  // No table separates equal names; the router reports those on their own.
+  if (!HasUniqueNames(names)) {
+    return table;
+  }
+  for (std::uint32_t seed = 0; seed < kSeeds; ++seed) {
+    table.seed = seed;
+    table.displacements.fill(0);
+    table.slots.fill(Table::kEmpty);
+    std::array<std::uint32_t, N> hashes{};
+    std::array<std::size_t, Table::kBuckets> sizes{};
+    std::array<std::size_t, N> order{};
+    for (std::size_t i = 0; i < N; ++i) {
+      hashes[i] = CommandHash(names[i], seed);
+      ++sizes[hashes[i] & kBucketMask];
+      order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      const std::size_t bucket_a = hashes[a] & kBucketMask;
+      const std::size_t bucket_b = hashes[b] & kBucketMask;
+      return sizes[bucket_a] != sizes[bucket_b] ? sizes[bucket_a] > sizes[bucket_b]
+                                                : bucket_a < bucket_b;
+    });
+
+    bool placed = true;
+    for (std::size_t begin = 0; begin < N && placed;) {
+      const std::size_t bucket = hashes[order[begin]] & kBucketMask;
+      const std::size_t end = begin + sizes[bucket];
+      placed = false;
+      for (std::uint32_t displacement = 0; displacement < kDisplacements && !placed;
+           ++displacement) {
+        const auto shift = static_cast<std::uint16_t>(displacement);
+        std::size_t taken = begin;
+        while (taken < end) {
+          auto &slot = table.slots[Table::Place(hashes[order[taken]], shift)];
+          if (slot != Table::kEmpty) {
+            break;
+          }
+          slot = static_cast<std::uint8_t>(order[taken]);
+          ++taken;
+        }
+        placed = taken == end;
+        if (placed) {
+          table.displacements[bucket] = shift;
+        } else {
+          for (std::size_t k = begin; k < taken; ++k) {
+            table.slots[Table::Place(hashes[order[k]], shift)] = Table::kEmpty;
+          }
+        }
+      }
+      begin = end;
+    }
+    if (placed) {
+      table.found = true;
+      return table;
+    }
+  }
+  return table;
+}
+
+} // namespace detail
+
+// Router for a command set known at compile time. Command names are placed in
+// a constexpr perfect-hash table and handlers are called directly rather than
+// through CommandHandler, so routing an update costs one parse, one hash and
+// displacement lookup, one name compare and a call the compiler can inline.
+//
+//   StaticCommandRouter<Cmd<"start", StartCommandHandler>,
+//                       Cmd<"ping", PingCommandHandler>> router;
+//
+// Handlers need HandleCommand(const UpdateView&, const CommandView&), as every
+// CommandHandler has; declaring them `final` lets the call devirtualise.
+template <typename... Cmds> class StaticCommandRouter final : public CommandHandler {
+  static_assert(sizeof...(Cmds) > 0, "StaticCommandRouter needs at least one command");
+  static_assert(sizeof...(Cmds) < 255, "StaticCommandRouter supports at most 254 commands");
+  static_assert((StaticCommandHandler<typename Cmds::HandlerType> && ...),
+                "command handlers must provide HandleCommand(UpdateView, CommandView)");
+
+  static constexpr std::array<std::string_view, sizeof...(Cmds)> kNames{Cmds::kName...};
+  static constexpr bool kUniqueNames = detail::HasUniqueNames(kNames);
+  static_assert(kUniqueNames, "duplicate command names in StaticCommandRouter");
+  static constexpr auto kTable = detail::BuildPerfectHash(kNames);
+  static_assert(!kUniqueNames || kTable.found,
+                "no perfect hash found for these command names; split them across routers");
+
+public:
+  explicit StaticCommandRouter(StaticCommandRouterOptions options = {})
+    requires(std::is_default_constructible_v<typename Cmds::HandlerType> && ...)
+      : options_(std::move(options)) {}
+
+  explicit StaticCommandRouter(StaticCommandRouterOptions options,
+                               typename Cmds::HandlerType... handlers)
+      : options_(std::move(options)),
+        handlers_(std::forward<typename Cmds::HandlerType>(handlers)...) {}
+
+  std::optional<OutgoingMessage> Handle(const Update &update) override {
+    return HandleView(AsView(update));
+  }
+
+  std::optional<OutgoingMessage> HandleView(const UpdateView &update) override {
+    if (const auto command = ParseCommand(update.text); command.has_value()) {
+      if (!IsAddressedTo(*command, options_.bot_username)) {
+        return std::nullopt;
+      }
+      if (const std::size_t index = Find(command->name); index < sizeof...(Cmds)) {
+        auto response = Dispatch(index, update, *command,
+                                 std::make_index_sequence<sizeof...(Cmds)>{});
+        if (response.has_value()) {
+          return response;
+        }
+      }
+    }
+    if (options_.fallback != nullptr) {
+      return options_.fallback->HandleView(update);
+    }
+    return std::nullopt;
+  }
+
+  // Index of `name` in the command list, or the list size when absent.
+  static constexpr std::size_t Find(std::string_view name) {
+    const std::uint8_t slot = kTable.slots[kTable.Slot(name)];
+    if (slot == kTable.kEmpty || kNames[slot] != name) {
+      return sizeof...(Cmds);
+    }
+    return slot;
+  }
+
+  template <std::size_t I> auto &handler() { return std::get<I>(handlers_); }
+
+private:
+  template <std::size_t... I>
+  std::optional<OutgoingMessage> Dispatch(std::size_t index, const UpdateView &update,
+                                          const CommandView &command,
+                                          std::index_sequence<I...>) {
+    std::optional<OutgoingMessage> response;
+    // Expands to a chain of direct calls; only the matching one runs.
+    (void)((index == I ? (response = std::get<I>(handlers_).HandleCommand(update, command), true)
+                       : false) ||
+           ...);
+    return response;
+  }
+
+  StaticCommandRouterOptions options_;
+  std::tuple<typename Cmds::HandlerType...> handlers_;
+};
+
+} // namespace vertel::core
@@ -5,17 +5,78 @@
 #undef SendMessage
 #endif
 
+#include <chrono>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <string>
 #include <vector>
 
 #include "vertel/core/message.hpp"
+#include "vertel/core/update_batch.hpp"
 
 namespace vertel::core {
 
+struct SendResult {
+  bool ok{false};
+  long status_code{0};
+  std::string error;
+  // Set on HTTP 429: how long Telegram asked the bot to wait.
+  std::chrono::seconds retry_after{0};
+};
+
+// Shape of the next polls.
+struct PollOptions {
+  // Most updates one poll returns; the Bot API accepts 1-100.
+  int limit{100};
+  // Longest a poll waits for the first update. Zero returns at once.
+  std::chrono::seconds timeout{25};
+};
+
+// Invoked once per queued message, possibly on a transport-owned thread.
+using SendCallback = std::function<void(const OutgoingMessage &, const SendResult &)>;
+
 class TelegramGateway {
 public:
   virtual ~TelegramGateway() = default;
   virtual std::vector<Update> PollUpdates() = 0;
+
+  // Appends the next updates to `batch`, which the caller has cleared. Gateways
+  // that decode straight into the batch's arena override this; the default
+  // copies out of PollUpdates().
+  virtual void PollBatch(UpdateBatch &batch) {
+    for (const auto &update : PollUpdates()) {
+      batch.Add(update.update_id, update.chat_id, update.text, update.date);
+    }
+  }
+
+  // Applies to every later poll. Gateways may cap the timeout at their own
+  // configured maximum; the default ignores the options.
+  virtual void SetPollOptions(const PollOptions &options) { (void)options; }
+
   virtual void SendMessage(const OutgoingMessage &message) = 0;
+
+  // Queues `message` and returns without waiting for delivery. Gateways without
+  // a non-blocking transport fall back to a synchronous SendMessage().
+  virtual void SendMessageAsync(const OutgoingMessage &message, SendCallback done) {
+    SendResult result{.ok = true, .status_code = 0, .error = {}, .retry_after = {}};
+    try {
+      SendMessage(message);
+    } catch (const std::exception &ex) {
+      result.ok = false;
+      result.error = ex.what();
+    }
+    if (done) {
+      done(message, result);
+    }
+  }
+
+  // Blocks until every message queued through SendMessageAsync() has completed.
+  virtual void FlushSends() {}
+
+  // Called once every update below `next_offset` has been handled, so a
+  // gateway with durable state can record it. The default does nothing.
+  virtual void CommitUpdates(std::int64_t next_offset) { (void)next_offset; }
 };
 
 } // namespace vertel::core
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "vertel/core/message.hpp"
+
+namespace vertel::core {
+
+// Non-owning view of an update. Views handed out by an UpdateBatch stay valid
+// until the batch is cleared or destroyed.
+struct UpdateView {
+  std::int64_t update_id{};
+  std::int64_t chat_id{};
+  std::string_view text;
+  std::int64_t date{};
+};
+
+inline UpdateView AsView(const Update &update) {
+  return UpdateView{.update_id = update.update_id,
+                    .chat_id = update.chat_id,
+                    .text = update.text,
+                    .date = update.date};
+}
+
+inline Update ToUpdate(const UpdateView &view) {
+  return Update{.update_id = view.update_id,
+                .chat_id = view.chat_id,
+                .text = std::string(view.text),
+                .date = view.date};
+}
+
+// The updates of one poll. Texts are copied into a block arena owned by the
+// batch, so a poll costs no per-update allocation once the batch has grown to
+// its working size; Clear() keeps that memory for the next poll.
+class UpdateBatch {
+public:
+  UpdateBatch() = default;
+  UpdateBatch(UpdateBatch &&) noexcept = default;
+  UpdateBatch &operator=(UpdateBatch &&) noexcept = default;
+  UpdateBatch(const UpdateBatch &) = delete;
+  UpdateBatch &operator=(const UpdateBatch &) = delete;
+
+  // Copies `text` into the arena and appends the update.
+  void Add(std::int64_t update_id, std::int64_t chat_id, std::string_view text,
+           std::int64_t date = 0);
+  void Clear();
+
+  std::size_t size() const { return views_.size(); }
+  bool empty() const { return views_.empty(); }
+  const UpdateView &operator[](std::size_t index) const { return views_[index]; }
+  std::vector<UpdateView>::const_iterator begin() const { return views_.begin(); }
+  std::vector<UpdateView>::const_iterator end() const { return views_.end(); }
+  std::span<const UpdateView> views() const { return views_; }
+
+private:
+  static constexpr std::size_t kBlockSize = 16 * 1024;
+
+  struct Block {
+    std::unique_ptr<char[]> data;
+    std::size_t capacity{0};
+    std::size_t used{0};
+  };
+
+  std::string_view Store(std::string_view text);
+
+  std::vector<UpdateView> views_;
+  std::vector<Block> blocks_;
+  std::size_t current_block_{0};
+};
+
+} // namespace vertel::core
@@ -8,16 +8,66 @@ namespace vertel::platform {
 
 struct Config {
   std::string bot_token;
+  // Commands addressed to another bot ("/start@other_bot") are ignored when set.
+  std::string bot_username;
+  // Bot API endpoint; point it at a local server for load tests.
+  std::string telegram_api_base{"https://api.telegram.org"};
   bool inject_sample_start{false};
   int telegram_long_poll_timeout_seconds{25};
   int telegram_request_timeout_seconds{35};
+  int telegram_connection_pool_size{4};
+  int telegram_max_in_flight_sends{32};
   int poll_max_attempts{5};
   int poll_initial_backoff_ms{250};
+  int poll_max_backoff_ms{30000};
+  // Retries allowed per 100 first attempts, bot-wide.
+  int retry_budget_percent{20};
+  int circuit_failure_threshold{5};
+  int circuit_open_ms{10000};
+  // Pause after an empty poll that returned without waiting.
   int loop_sleep_ms{50};
+  int poll_limit{100};
+  // Polled batches buffered ahead of the handling thread.
+  int poll_pipeline_depth{2};
+  int dispatch_workers{0};
+  // Outbound pacing; a rate of 0 sends without a scheduler.
+  int outbound_messages_per_second{30};
+  int outbound_chat_interval_ms{1000};
+  int outbound_group_interval_ms{3000};
   int rate_limit_capacity{5};
   int rate_limit_refill_tokens{5};
   int rate_limit_refill_seconds{10};
+  int rate_limit_max_chats{65536};
   int http_port{8080};
+  // getUpdates offset checkpoint; none when the path is empty. Sync is
+  // "never", "interval" (every offset_checkpoint_sync_ms) or "commit".
+  std::string offset_checkpoint_path;
+  std::string offset_checkpoint_sync{"interval"};
+  int offset_checkpoint_sync_ms{1000};
+  // Logging happens on a background writer unless log_async is off; a full
+  // queue drops lines unless log_block_on_overflow is set.
+  // "debug", "info", "warn" or "error".
+  std::string log_level{"info"};
+  bool log_async{true};
+  int log_queue_capacity{8192};
+  bool log_block_on_overflow{false};
+  // Webhook mode is on when webhook_port > 0; webhook_url is registered with
+  // Telegram at startup when set.
+  int webhook_port{0};
+  int webhook_threads{2};
+  std::string webhook_path{"/telegram/webhook"};
+  std::string webhook_url;
+  std::string webhook_secret;
+  // Sharded deployment, off when shard_role is empty. A "front" polls Telegram
+  // and routes updates by chat to shard_count "worker" processes over the
+  // shard_socket Unix socket; a worker handles shard shard_index. Worker
+  // replies go out through the front, or with the worker's own token when
+  // shard_replies is "direct".
+  std::string shard_role;
+  std::string shard_socket{"/tmp/vertel-shards.sock"};
+  int shard_count{1};
+  int shard_index{0};
+  std::string shard_replies{"front"};
   std::unordered_set<std::int64_t> admin_chat_ids;
 
   static Config FromEnv();
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <optional>
+#include <queue>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "vertel/runtime/task.hpp"
+
+namespace vertel::runtime {
+
+// Runs coroutines on one dedicated thread.
+//
+// A coroutine that awaits Sleep() or Completion() is parked without holding
+// the thread, so one executor keeps any number of slow conversations in
+// flight and only runs whichever of them has something to do. Completions
+// may fire on any thread: they post the coroutine back and it resumes on the
+// executor thread.
+//
+// Destroying the executor destroys the coroutines still suspended in it. I/O
+// they started must not complete afterwards; drain with WaitIdle() first.
+class Executor {
+public:
+  using Clock = std::chrono::steady_clock;
+
+  Executor();
+  ~Executor();
+
+  Executor(const Executor &) = delete;
+  Executor &operator=(const Executor &) = delete;
+
+  // Starts `task` on the executor thread and forgets it; exceptions escaping
+  // it are discarded. Safe to call from any thread.
+  void Spawn(Task<> task);
+
+  // Resumes `handle` on the executor thread. Safe to call from any thread.
+  void Post(std::coroutine_handle<> handle);
+
+  // Spawned tasks that have not finished.
+  std::size_t Pending() const;
+  // Blocks until every spawned task has finished.
+  void WaitIdle();
+
+  // co_await executor.Sleep(d) resumes after `d` without blocking the thread.
+  auto Sleep(Clock::duration delay) {
+    struct Awaiter {
+      Executor &executor;
+      Clock::time_point at;
+      bool await_ready() const { return at <= Clock::now(); }
+      void await_suspend(std::coroutine_handle<> handle) { executor.ResumeAt(at, handle); }
+      void await_resume() const {}
+    };
+    return Awaiter{*this, Clock::now() + delay};
+  }
+
+  // Adapts a callback-based operation: `start` receives a `resume(T)` callable
+  // and must arrange for it to be called exactly once, from any thread. The
+  // awaiting coroutine resumes on the executor thread with that value.
+  //
+  //   SendResult sent = co_await executor.Completion<SendResult>([&](auto resume) {
+  //     gateway.SendMessageAsync(message, [resume](auto &, const SendResult &r) { resume(r); });
+  //   });
+  template <typename T, typename Start> auto Completion(Start start) {
+    struct Awaiter {
+      Executor &executor;
+      Start start;
+      std::optional<T> result;
+      bool await_ready() const { return false; }
+      void await_suspend(std::coroutine_handle<> handle) {
+        start([this, handle](T value) {
+          result.emplace(std::move(value));
+          executor.Post(handle);
+        });
+      }
+      T await_resume() { return std::move(*result); }
+    };
+    return Awaiter{*this, std::move(start), std::nullopt};
+  }
+
+private:
+  // Root frame of a spawned task; it frees itself once the task is done.
+  struct Detached {
+    struct promise_type {
+      promise_type(Executor &executor, Task<> &) : executor(executor) {}
+      ~promise_type();
+
+      Detached get_return_object() {
+        return Detached{std::coroutine_handle<promise_type>::from_promise(*this)};
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() {}
+      void unhandled_exception() noexcept {}
+
+      Executor &executor;
+    };
+    std::coroutine_handle<promise_type> handle;
+  };
+
+  struct Timer {
+    Clock::time_point at;
+    std::uint64_t sequence;
+    std::coroutine_handle<> handle;
+
+    bool operator>(const Timer &other) const {
+      return at != other.at ? at > other.at : sequence > other.sequence;
+    }
+  };
+
+  static Detached RunDetached(Executor &executor, Task<> task);
+  void ResumeAt(Clock::time_point at, std::coroutine_handle<> handle);
+  void Forget(void *frame);
+  void Run();
+
+  mutable std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable idle_;
+  std::vector<std::coroutine_handle<>> ready_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+  std::uint64_t sequence_{0};
+  // Frames of spawned tasks that have not finished.
+  std::unordered_set<void *> roots_;
+  bool stopping_{false};
+  std::thread thread_;
+};
+
+} // namespace vertel::runtime
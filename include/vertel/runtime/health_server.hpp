@@ -1,7 +1,9 @@
 #pragma once
 
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <thread>
 
 #ifdef _WIN32
@@ -9,12 +11,19 @@
 #include <ws2tcpip.h>
 #endif
 
+#include "vertel/runtime/http_server.hpp"
 #include "vertel/runtime/metrics.hpp"
 
 namespace vertel::runtime {
 
+// Serves /healthz and /metrics. On Linux it runs on the epoll HttpServer and
+// handles concurrent scrapers with keep-alive; elsewhere it falls back to a
+// select() loop serving one connection at a time. Scrapers that send
+// `Accept: application/openmetrics-text` get OpenMetrics.
 class HealthServer {
 public:
+  // A negative port disables the server. Port 0 picks an ephemeral port on
+  // Linux, which port() reports once Start() has bound it.
   HealthServer(MetricsRegistry &metrics, int port);
   ~HealthServer();
 
@@ -28,7 +37,8 @@ public:
 
 private:
   void Run();
-  static std::string BuildMetricsBody(const MetricsSnapshot &snapshot);
+  // `open_metrics` selects OpenMetrics over the Prometheus text format.
+  HttpResponse Respond(std::string_view path, bool open_metrics) const;
 
   MetricsRegistry &metrics_;
   int port_;
@@ -40,6 +50,7 @@ private:
 #endif
   std::thread thread_;
   std::mutex mutex_;
+  std::unique_ptr<HttpServer> server_;
 };
 
 } // namespace vertel::runtime
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace vertel::runtime {
+
+inline constexpr std::size_t kMetricShards = 16;
+
+namespace detail {
+
+// Cell index of the calling thread. Threads are numbered on first use, so
+// up to kMetricShards threads each write their own cache line.
+std::size_t MetricShard();
+
+} // namespace detail
+
+struct HistogramSnapshot {
+  std::vector<std::uint64_t> buckets;
+  std::uint64_t count{0};
+  std::uint64_t sum_ns{0};
+
+  // Upper bound (in ns) of the bucket holding the q-th quantile, 0 <= q <= 1;
+  // 0 when empty.
+  std::uint64_t ValueAtQuantile(double q) const;
+};
+
+// Fixed-memory log-linear latency histogram in the HDR style: every power of
+// two of nanoseconds is split into kSubBuckets linear buckets, so a recorded
+// value is known to within 1/kSubBuckets (12.5%) from 1 ns up to 2^41 ns
+// (~36 minutes); larger values land in the last bucket.
+//
+// Record() is two relaxed atomic adds into the calling thread's shard, like
+// Counter, so it takes no locks and threads recording at once do not share
+// cache lines. A shard (about 2.5 KiB) is allocated the first time a thread
+// slot records, so a series only a few threads touch stays small. Snapshots
+// sum the shards and may be off by the records in flight, which monitoring
+// tolerates.
+class LatencyHistogram {
+public:
+  static constexpr unsigned kSubBucketBits = 3;
+  static constexpr std::size_t kSubBuckets = std::size_t{1} << kSubBucketBits;
+  static constexpr unsigned kMaxExponent = 40;
+  static constexpr std::size_t kBuckets = kSubBuckets * (kMaxExponent - kSubBucketBits + 2);
+
+  LatencyHistogram() = default;
+  ~LatencyHistogram();
+
+  LatencyHistogram(const LatencyHistogram &) = delete;
+  LatencyHistogram &operator=(const LatencyHistogram &) = delete;
+
+  void Record(std::chrono::nanoseconds value) {
+    const auto ns = static_cast<std::uint64_t>(std::max<std::int64_t>(0, value.count()));
+    const std::size_t index = detail::MetricShard();
+    Shard *shard = shards_[index].load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      shard = AddShard(index);
+    }
+    shard->buckets[BucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    shard->sum_ns.fetch_add(ns, std::memory_order_relaxed);
+  }
+
+  HistogramSnapshot Snapshot() const;
+
+  // Appends the histogram in the Prometheus text format, in seconds, with
+  // cumulative buckets at fixed bounds from 100 us to 60 s. A log-linear
+  // bucket that straddles a bound is counted towards the next bound up.
+  // `labels` is a rendered label list without braces, possibly empty.
+  void AppendPrometheus(std::string &out, std::string_view name, std::string_view labels) const;
+
+  static constexpr std::size_t BucketIndex(std::uint64_t ns) {
+    if (ns < kSubBuckets) {
+      return static_cast<std::size_t>(ns);
+    }
+    const auto exponent = static_cast<unsigned>(std::bit_width(ns)) - 1;
+    if (exponent > kMaxExponent) {
+      return kBuckets - 1;
+    }
+    const unsigned shift = exponent - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + static_cast<std::size_t>((ns >> shift) - kSubBuckets);
+  }
+
+  // Exclusive upper bound of a bucket, in nanoseconds.
+  static constexpr std::uint64_t BucketUpperBound(std::size_t index) {
+    if (index < kSubBuckets) {
+      return index + 1;
+    }
+    const unsigned shift = static_cast<unsigned>(index / kSubBuckets) - 1;
+    const std::uint64_t lower = (kSubBuckets + index % kSubBuckets) << shift;
+    return lower + (std::uint64_t{1} << shift);
+  }
+
+private:
+  struct alignas(64) Shard {
+    std::array<std::atomic<std::uint64_t>, kBuckets> buckets{};
+    std::atomic<std::uint64_t> sum_ns{0};
+  };
+
+  // Installs a shard in an empty slot; returns the winner if threads race.
+  Shard *AddShard(std::size_t index);
+
+  std::array<std::atomic<Shard *>, kMetricShards> shards_{};
+};
+
+} // namespace vertel::runtime
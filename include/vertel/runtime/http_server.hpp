@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace vertel::runtime {
+
+struct HttpRequest {
+  std::string_view method;
+  std::string_view path;
+  std::string_view body;
+  std::vector<std::pair<std::string_view, std::string_view>> headers;
+
+  // Case-insensitive lookup; returns an empty view when the header is absent.
+  std::string_view Header(std::string_view name) const;
+};
+
+struct HttpResponse {
+  int status_code{200};
+  std::string content_type{"text/plain; charset=utf-8"};
+  std::string body;
+};
+
+// Minimal HTTP/1.1 server on non-blocking sockets and epoll. Every listener
+// thread owns an SO_REUSEPORT socket and an epoll set, accepts as many
+// connections as the kernel hands it, handles partial reads, pipelined
+// requests and keep-alive, and wakes up for shutdown through an eventfd.
+// Requests with a Content-Length body are supported; chunked uploads are not.
+// Only available on Linux: elsewhere Start() returns false.
+class HttpServer {
+public:
+  struct Options {
+    int port{0}; // 0 picks an ephemeral port, see port()
+    std::size_t threads{1};
+    int backlog{512};
+    std::size_t max_request_bytes{1 << 20};
+    std::chrono::seconds idle_timeout{60};
+  };
+
+  // Called on a listener thread; must not block for long.
+  using Handler = std::function<void(const HttpRequest &, HttpResponse &)>;
+
+  HttpServer(Options options, Handler handler);
+  ~HttpServer();
+
+  HttpServer(const HttpServer &) = delete;
+  HttpServer &operator=(const HttpServer &) = delete;
+
+  // Binds the listeners and starts the threads. Returns false if the port
+  // could not be bound or the platform lacks epoll.
+  bool Start();
+  void Stop();
+
+  // The bound port once Start() succeeded, otherwise the configured one.
+  int port() const;
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
+};
+
+} // namespace vertel::runtime
@@ -1,23 +1,170 @@
 #pragma once
 
+#include <atomic>
+#include <concepts>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
 #include <initializer_list>
 #include <iostream>
+#include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <thread>
+#include <type_traits>
+
+#include "vertel/runtime/metrics.hpp"
 
 namespace vertel::runtime {
 
-enum class LogLevel { kInfo, kWarn, kError };
+enum class LogLevel { kDebug, kInfo, kWarn, kError };
+
+// Parses "debug", "info", "warn" or "error"; anything else yields `fallback`.
+LogLevel ParseLogLevel(std::string_view name, LogLevel fallback = LogLevel::kInfo);
+
+// One key/value pair of a log line. Holds views and scalars only, so building
+// the fields of a call never allocates; strings must outlive the Log() call.
+// Numbers and booleans are written as JSON numbers and literals.
+class LogField {
+public:
+  LogField(std::string_view key, std::string_view value)
+      : key_(key), kind_(Kind::kString), string_(value) {}
+  LogField(std::string_view key, const char *value) : LogField(key, std::string_view(value)) {}
+  LogField(std::string_view key, const std::string &value)
+      : LogField(key, std::string_view(value)) {}
+  LogField(std::string_view key, bool value) : key_(key), kind_(Kind::kBool), bool_(value) {}
+  LogField(std::string_view key, double value) : key_(key), kind_(Kind::kDouble), double_(value) {}
+  template <std::integral T>
+    requires(!std::same_as<T, bool>)
+  LogField(std::string_view key, T value) : key_(key) {
+    if constexpr (std::is_signed_v<T>) {
+      kind_ = Kind::kInt;
+      int_ = value;
+    } else {
+      kind_ = Kind::kUint;
+      uint_ = value;
+    }
+  }
+
+private:
+  friend class Logger;
+  enum class Kind : std::uint8_t { kString, kInt, kUint, kDouble, kBool };
+
+  std::string_view key_;
+  Kind kind_{Kind::kString};
+  std::string_view string_;
+  union {
+    std::int64_t int_{0};
+    std::uint64_t uint_;
+    double double_;
+    bool bool_;
+  };
+};
+
+// What an async Logger does with a line when its queue is full.
+enum class LogOverflowPolicy {
+  kDrop,  // discard the line and count it in dropped()
+  kBlock, // wait for the writer thread to make room
+};
+
+struct LoggerOptions {
+  // Hand formatted lines to a background writer instead of writing them on
+  // the calling thread.
+  bool async{false};
+  // Lines the async queue holds, rounded up to a power of two.
+  std::size_t queue_capacity{8192};
+  LogOverflowPolicy overflow{LogOverflowPolicy::kDrop};
+  // Lines below this level are discarded before any formatting.
+  LogLevel min_level{LogLevel::kInfo};
+};
 
+// Writes one JSON object per line.
+//
+// Synchronous loggers write and flush each line under a mutex. Async loggers
+// push lines into a bounded lock-free MPSC ring and a writer thread drains it,
+// writing whatever has accumulated with a single write and flush; the caller
+// only formats and claims a slot. The destructor writes everything queued.
 class Logger {
 public:
-  explicit Logger(std::ostream &out = std::cout);
+  explicit Logger(std::ostream &out = std::cout, LoggerOptions options = {},
+                  MetricsRegistry *metrics = nullptr);
+  ~Logger();
 
-  void Log(LogLevel level, std::string_view message,
-           std::initializer_list<std::pair<std::string, std::string>> fields = {});
+  Logger(const Logger &) = delete;
+  Logger &operator=(const Logger &) = delete;
+
+  // Formats straight into a reused per-thread buffer; returns immediately
+  // when `level` is disabled.
+  void Log(LogLevel level, std::string_view message, std::initializer_list<LogField> fields = {});
+
+  bool Enabled(LogLevel level) const {
+    return level >= min_level_.load(std::memory_order_relaxed);
+  }
+  void SetMinLevel(LogLevel level) { min_level_.store(level, std::memory_order_relaxed); }
+
+  // Returns once every line logged before the call has been written and the
+  // stream flushed.
+  void Flush();
+
+  // Lines discarded by LogOverflowPolicy::kDrop.
+  std::uint64_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
 
 private:
+  struct Slot {
+    // Vyukov sequence: equals the ticket when free for it, ticket + 1 once
+    // filled.
+    std::atomic<std::size_t> sequence{0};
+    std::string line;
+  };
+
+  void Enqueue(std::string &line);
+  void WakeWriter();
+  void WriterLoop();
+
   std::ostream &out_;
+  LoggerOptions options_;
+  std::atomic<LogLevel> min_level_;
+  Counter *dropped_counter_{nullptr};
+  std::atomic<std::uint64_t> dropped_{0};
+
+  std::mutex mutex_; // serialises synchronous writes; guards the wait state below
+  std::condition_variable wake_;
+  std::condition_variable written_cv_;
+  bool stopping_{false};
+  std::atomic<bool> writer_idle_{false};
+
+  std::unique_ptr<Slot[]> slots_;
+  std::size_t mask_{0};
+  alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<std::size_t> written_pos_{0};
+  std::thread writer_;
 };
 
 } // namespace vertel::runtime
+
+// Levels below VERTEL_LOG_MIN_LEVEL (0 = debug ... 3 = error) are compiled
+// out by the VERTEL_LOG_* macros: the call and its arguments generate no code.
+// Enabled levels are still checked against the logger's runtime level before
+// the arguments are evaluated.
+#ifndef VERTEL_LOG_MIN_LEVEL
+#define VERTEL_LOG_MIN_LEVEL 0
+#endif
+
+#define VERTEL_LOG(logger, level, ...)                                                             \
+  do {                                                                                             \
+    if constexpr (static_cast<int>(level) >= VERTEL_LOG_MIN_LEVEL) {                               \
+      if ((logger).Enabled(level)) {                                                               \
+        (logger).Log(level, __VA_ARGS__);                                                          \
+      }                                                                                            \
+    }                                                                                              \
+  } while (false)
+
+#define VERTEL_LOG_DEBUG(logger, ...)                                                              \
+  VERTEL_LOG(logger, ::vertel::runtime::LogLevel::kDebug, __VA_ARGS__)
+#define VERTEL_LOG_INFO(logger, ...)                                                               \
+  VERTEL_LOG(logger, ::vertel::runtime::LogLevel::kInfo, __VA_ARGS__)
+#define VERTEL_LOG_WARN(logger, ...)                                                               \
+  VERTEL_LOG(logger, ::vertel::runtime::LogLevel::kWarn, __VA_ARGS__)
+#define VERTEL_LOG_ERROR(logger, ...)                                                              \
+  VERTEL_LOG(logger, ::vertel::runtime::LogLevel::kError, __VA_ARGS__)
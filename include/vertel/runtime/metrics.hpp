@@ -1,39 +1,186 @@
 #pragma once
 
+#include <array>
 #include <atomic>
+#include <chrono>
+#include <cstddef>
 #include <cstdint>
+#include <memory>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "vertel/runtime/histogram.hpp"
 
 namespace vertel::runtime {
 
+// Pipeline stages that each get a latency histogram.
+enum class LatencyStage : std::uint8_t {
+  kPoll,     // getUpdates round-trip
+  kParse,    // decoding a getUpdates body
+  kHandle,   // one handler-chain invocation
+  kSend,     // sendMessage round-trip
+  kEndToEnd, // Telegram's message.date to the reply being delivered
+};
+inline constexpr std::size_t kLatencyStages = 5;
+
+// Label name/value pairs of one series, e.g. {{"command", "start"}}.
+using MetricLabels = std::vector<std::pair<std::string, std::string>>;
+
+namespace detail {
+
+struct alignas(64) MetricCell {
+  std::atomic<std::int64_t> value{0};
+};
+
+} // namespace detail
+
+// Monotonic counter spread over cache-line-padded per-thread cells, so
+// increments from different threads never contend; Value() sums the cells
+// and is meant for scrapes, not hot paths.
+class Counter {
+public:
+  void Increment(std::uint64_t delta = 1) {
+    cells_[detail::MetricShard()].value.fetch_add(static_cast<std::int64_t>(delta),
+                                                  std::memory_order_relaxed);
+  }
+  std::uint64_t Value() const;
+
+private:
+  std::array<detail::MetricCell, kMetricShards> cells_{};
+};
+
+// Gauge with the same per-thread cells as Counter.
+class Gauge {
+public:
+  void Add(std::int64_t delta) {
+    cells_[detail::MetricShard()].value.fetch_add(delta, std::memory_order_relaxed);
+  }
+  // Not atomic with respect to concurrent Add() calls.
+  void Set(std::int64_t value) { Add(value - Value()); }
+  std::int64_t Value() const;
+
+private:
+  std::array<detail::MetricCell, kMetricShards> cells_{};
+};
+
 struct MetricsSnapshot {
   std::uint64_t updates_processed{0};
   std::uint64_t messages_sent{0};
   std::uint64_t handler_failures{0};
   std::uint64_t rate_limit_rejections{0};
+  std::uint64_t send_failures{0};
+  std::int64_t dispatch_queue_depth{0};
+  std::int64_t rate_limiter_tracked_chats{0};
+  std::int64_t outbound_queue_depth{0};
+  std::uint64_t outbound_throttled{0};
+  std::uint64_t retries{0};
+  std::uint64_t retry_budget_exhausted{0};
+  std::uint64_t circuit_opened{0};
+  // Busy time per dispatch worker, indexed by worker id.
+  std::vector<std::uint64_t> worker_busy_ns;
+  std::array<HistogramSnapshot, kLatencyStages> latency;
+
+  const HistogramSnapshot &Latency(LatencyStage stage) const {
+    return latency[static_cast<std::size_t>(stage)];
+  }
 };
 
+// Registry of labeled counters, gauges and histograms, rendered in the
+// Prometheus text format or OpenMetrics.
+//
+// Series are created on first lookup and live as long as the registry, so
+// references can be looked up once and kept: a lookup takes a shared lock and
+// a hash probe, an update through the reference touches only the caller's
+// cell. The built-in series below are registered by the constructor and have
+// named accessors.
 class MetricsRegistry {
 public:
-  void IncrementUpdatesProcessed() { updates_processed_.fetch_add(1, std::memory_order_relaxed); }
-  void IncrementMessagesSent() { messages_sent_.fetch_add(1, std::memory_order_relaxed); }
-  void IncrementHandlerFailures() { handler_failures_.fetch_add(1, std::memory_order_relaxed); }
-  void IncrementRateLimitRejections() {
-    rate_limit_rejections_.fetch_add(1, std::memory_order_relaxed);
-  }
+  static constexpr std::size_t kMaxTrackedWorkers = 64;
+
+  MetricsRegistry();
+  // A view of `parent` for one component, e.g. one bot of a MultiBotHost: its
+  // series, built-in ones included, are created in `parent` with `labels`
+  // ahead of their own, and WriteExposition() renders the whole parent.
+  // `parent` must outlive it.
+  MetricsRegistry(MetricsRegistry &parent, MetricLabels labels);
+  ~MetricsRegistry();
+
+  MetricsRegistry(const MetricsRegistry &) = delete;
+  MetricsRegistry &operator=(const MetricsRegistry &) = delete;
+
+  // Throw std::invalid_argument when `name` already names another metric type.
+  // A counter's rendered value is its count times `scale`, which lets integer
+  // cells hold e.g. nanoseconds for a _seconds metric.
+  Counter &GetCounter(std::string_view name, std::string_view help,
+                      const MetricLabels &labels = {}, double scale = 1.0);
+  Gauge &GetGauge(std::string_view name, std::string_view help, const MetricLabels &labels = {});
+  // Recorded in nanoseconds, rendered in seconds.
+  LatencyHistogram &GetHistogram(std::string_view name, std::string_view help,
+                                 const MetricLabels &labels = {});
 
-  MetricsSnapshot Snapshot() const {
-    return MetricsSnapshot{.updates_processed = updates_processed_.load(std::memory_order_relaxed),
-                           .messages_sent = messages_sent_.load(std::memory_order_relaxed),
-                           .handler_failures = handler_failures_.load(std::memory_order_relaxed),
-                           .rate_limit_rejections =
-                               rate_limit_rejections_.load(std::memory_order_relaxed)};
+  // Replaces the contents of `out` with every family in registration order,
+  // keeping its capacity so a scraper can reuse one buffer.
+  void WriteExposition(std::string &out, bool open_metrics = false) const;
+
+  void IncrementUpdatesProcessed() { updates_processed_.Increment(); }
+  void IncrementMessagesSent() { messages_sent_.Increment(); }
+  void IncrementHandlerFailures() { handler_failures_.Increment(); }
+  void IncrementRateLimitRejections() { rate_limit_rejections_.Increment(); }
+  void IncrementSendFailures() { send_failures_.Increment(); }
+  void AddDispatchQueueDepth(std::int64_t delta) { dispatch_queue_depth_.Add(delta); }
+  void AddRateLimiterTrackedChats(std::int64_t delta) { rate_limiter_tracked_chats_.Add(delta); }
+  void AddOutboundQueueDepth(std::int64_t delta) { outbound_queue_depth_.Add(delta); }
+  void IncrementOutboundThrottled() { outbound_throttled_.Increment(); }
+  void IncrementRetries() { retries_.Increment(); }
+  void IncrementRetryBudgetExhausted() { retry_budget_exhausted_.Increment(); }
+  void IncrementCircuitOpened() { circuit_opened_.Increment(); }
+
+  void ObserveLatency(LatencyStage stage, std::chrono::nanoseconds value) {
+    latency_[static_cast<std::size_t>(stage)]->Record(value);
   }
 
+  // Workers beyond kMaxTrackedWorkers are not broken out individually.
+  void AddWorkerBusyTime(std::size_t worker, std::chrono::nanoseconds busy);
+
+  MetricsSnapshot Snapshot() const;
+
 private:
-  std::atomic<std::uint64_t> updates_processed_{0};
-  std::atomic<std::uint64_t> messages_sent_{0};
-  std::atomic<std::uint64_t> handler_failures_{0};
-  std::atomic<std::uint64_t> rate_limit_rejections_{0};
+  enum class Type : std::uint8_t { kCounter, kGauge, kHistogram };
+  struct Series;
+  struct Family;
+
+  MetricsRegistry(MetricsRegistry *parent, MetricLabels labels);
+
+  Series &GetSeries(std::string_view name, std::string_view help, Type type,
+                    const MetricLabels &labels, double scale);
+
+  // Set for a scoped registry; declared first so the built-in series below
+  // are already created in the parent.
+  MetricsRegistry *parent_;
+  MetricLabels scope_;
+  mutable std::shared_mutex mutex_;
+  std::vector<std::unique_ptr<Family>> families_;
+  std::unordered_map<std::string, Family *> by_name_;
+
+  Counter &updates_processed_;
+  Counter &messages_sent_;
+  Counter &handler_failures_;
+  Counter &rate_limit_rejections_;
+  Counter &send_failures_;
+  Gauge &dispatch_queue_depth_;
+  Gauge &rate_limiter_tracked_chats_;
+  Gauge &outbound_queue_depth_;
+  Counter &outbound_throttled_;
+  Counter &retries_;
+  Counter &retry_budget_exhausted_;
+  Counter &circuit_opened_;
+  std::array<LatencyHistogram *, kLatencyStages> latency_{};
+  std::array<std::atomic<Counter *>, kMaxTrackedWorkers> worker_busy_{};
+  std::atomic<std::size_t> workers_seen_{0};
 };
 
 } // namespace vertel::runtime
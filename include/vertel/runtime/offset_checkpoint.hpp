@@ -0,0 +1,80 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace vertel::runtime {
+
+// When a committed offset is forced to disk. Every mode survives a process
+// crash, since the mapping lives in the page cache; the policy only matters
+// for power loss or a kernel crash.
+enum class CheckpointSync {
+  kNever,       // leave write-back to the OS
+  kInterval,    // at most once per `sync_interval`, and on destruction
+  kEveryCommit, // before Commit() returns
+};
+
+// Parses "never", "interval" or "commit"; anything else yields `fallback`.
+CheckpointSync ParseCheckpointSync(std::string_view name,
+                                   CheckpointSync fallback = CheckpointSync::kInterval);
+
+struct OffsetCheckpointOptions {
+  CheckpointSync sync{CheckpointSync::kInterval};
+  std::chrono::milliseconds sync_interval{1000};
+};
+
+// Durable getUpdates offset in a small memory-mapped file.
+//
+// The file holds two checksummed slots written alternately, so a write torn
+// by a crash leaves the previous offset readable. Commit() is a couple of
+// stores into the mapping plus the configured sync. Not thread-safe.
+class OffsetCheckpoint {
+public:
+  // Creates the file when missing. Throws std::runtime_error when it cannot be
+  // opened or mapped.
+  explicit OffsetCheckpoint(std::string path, OffsetCheckpointOptions options = {});
+  ~OffsetCheckpoint();
+
+  OffsetCheckpoint(const OffsetCheckpoint &) = delete;
+  OffsetCheckpoint &operator=(const OffsetCheckpoint &) = delete;
+
+  // The last committed offset, or 0 when nothing valid has been committed.
+  std::int64_t Load() const;
+
+  // Records that every update below `next_offset` has been handled. Offsets
+  // never move backwards; smaller values are ignored.
+  void Commit(std::int64_t next_offset);
+
+  // Forces the mapping to disk now.
+  void Sync();
+
+  const std::string &path() const { return path_; }
+
+private:
+  struct Slot {
+    std::int64_t offset;
+    std::uint64_t checksum;
+  };
+  struct Layout {
+    std::uint64_t magic;
+    Slot slots[2];
+  };
+
+  std::string path_;
+  OffsetCheckpointOptions options_;
+  Layout *layout_{nullptr};
+  std::int64_t committed_{0};
+  unsigned next_slot_{0};
+  bool dirty_{false};
+  std::chrono::steady_clock::time_point last_sync_{};
+#ifdef _WIN32
+  void *file_{nullptr};
+  void *mapping_{nullptr};
+#else
+  int fd_{-1};
+#endif
+};
+
+} // namespace vertel::runtime
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "vertel/runtime/metrics.hpp"
+
+namespace vertel::runtime {
+
+// Result of one attempt of a retried operation.
+struct RetryOutcome {
+  bool ok{false};
+  // False for errors another attempt cannot fix (bad request, revoked token).
+  bool retryable{true};
+  // Wait the server asked for (Telegram's parameters.retry_after); zero if none.
+  std::chrono::milliseconds retry_after{0};
+  std::string error;
+};
+
+struct RetryDecision {
+  bool retry{false};
+  std::chrono::milliseconds delay{0};
+};
+
+struct RetryEngineOptions {
+  int max_attempts{5};
+  std::chrono::milliseconds initial_backoff{100};
+  std::chrono::milliseconds max_backoff{30000};
+  // Retry budget: every first attempt earns `retry_budget_ratio` retry tokens,
+  // up to `retry_budget_burst`, and every retry spends one. Under a sustained
+  // outage retries stay a fixed fraction of traffic instead of multiplying it.
+  double retry_budget_ratio{0.2};
+  double retry_budget_burst{20.0};
+  // Consecutive retryable failures that open an endpoint's circuit, and how
+  // long it stays open before a single probe request is let through.
+  int circuit_failure_threshold{5};
+  std::chrono::milliseconds circuit_open_duration{10000};
+};
+
+// Decides when failed requests are retried, per endpoint.
+//
+// Backoff uses equal jitter (half the exponential step plus a random half) so
+// replicas that failed together do not retry together; a server-provided
+// retry_after replaces the exponential step and gets up to one initial_backoff
+// of jitter on top. Retries are refused once the budget is spent, and an
+// endpoint whose circuit is open is not called at all until it may be probed.
+//
+// Execute() drives an operation end to end without blocking the caller past
+// the first attempt: later attempts run on the engine's timer thread. Loops
+// that must stay on their own thread, like long polling, use Admit() and
+// Record() directly and wait on their own terms.
+class RetryEngine {
+public:
+  using Clock = std::chrono::steady_clock;
+  using Operation = std::function<RetryOutcome()>;
+  // Called exactly once with the last attempt's outcome.
+  using Completion = std::function<void(const RetryOutcome &outcome, int attempts)>;
+
+  explicit RetryEngine(RetryEngineOptions options = {}, MetricsRegistry *metrics = nullptr);
+  // Operations waiting for a retry complete with an error.
+  ~RetryEngine();
+
+  RetryEngine(const RetryEngine &) = delete;
+  RetryEngine &operator=(const RetryEngine &) = delete;
+
+  // Runs the first attempt on the calling thread and schedules any retries on
+  // the timer thread, so operations must be safe to call from there.
+  void Execute(std::string endpoint, Operation operation, Completion done);
+
+  // Zero when a request to `endpoint` may go out now; otherwise how long until
+  // its circuit lets a probe through.
+  Clock::duration Admit(std::string_view endpoint);
+
+  // Records the outcome of attempt number `attempt` (1-based) and says whether
+  // to retry and after how long.
+  RetryDecision Record(std::string_view endpoint, int attempt, const RetryOutcome &outcome);
+
+  // Retries that are waiting for their timer.
+  std::size_t PendingRetries() const;
+
+private:
+  struct Circuit {
+    int consecutive_failures{0};
+    Clock::time_point open_until{};
+    bool probing{false};
+  };
+
+  struct Job {
+    std::string endpoint;
+    Operation operation;
+    Completion done;
+    int attempts{0};
+  };
+
+  struct Timer {
+    Clock::time_point at;
+    std::uint64_t sequence;
+    std::shared_ptr<Job> job;
+
+    bool operator>(const Timer &other) const {
+      return at != other.at ? at > other.at : sequence > other.sequence;
+    }
+  };
+
+  struct EndpointHash {
+    using is_transparent = void;
+    std::size_t operator()(std::string_view name) const {
+      return std::hash<std::string_view>{}(name);
+    }
+  };
+
+  Circuit &CircuitFor(std::string_view endpoint);
+  std::chrono::milliseconds Backoff(int attempt, std::chrono::milliseconds retry_after);
+  // Runs attempts of `job` until it completes or has to wait for a retry.
+  void Step(std::shared_ptr<Job> job);
+  void RunTimers();
+
+  RetryEngineOptions options_;
+  MetricsRegistry *metrics_;
+
+  mutable std::mutex mutex_;
+  std::condition_variable timer_cv_;
+  std::unordered_map<std::string, Circuit, EndpointHash, std::equal_to<>> circuits_;
+  std::priority_queue<Timer, std::vector<Timer>, std::greater<>> timers_;
+  std::uint64_t sequence_{0};
+  double budget_;
+  std::minstd_rand random_;
+  bool stopping_{false};
+  std::thread timer_thread_;
+};
+
+} // namespace vertel::runtime
@@ -0,0 +1,118 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+
+namespace vertel::runtime {
+
+// Bounded single-producer/single-consumer ring of reusable T slots.
+//
+// The producer fills a slot in place (BeginPush() ... CommitPush()) and the
+// consumer reads it in place (Front() ... Pop()), so slot objects such as
+// arenas keep their memory across laps. The hand-off itself is two atomic
+// indices; the mutex is only taken when a side has to sleep, mirroring
+// Logger's writer wakeups.
+template <typename T> class SpscRing {
+public:
+  // `capacity` is rounded up to a power of two, at least 2.
+  explicit SpscRing(std::size_t capacity)
+      : mask_(std::bit_ceil(std::max<std::size_t>(2, capacity)) - 1),
+        slots_(std::make_unique<T[]>(mask_ + 1)) {}
+
+  SpscRing(const SpscRing &) = delete;
+  SpscRing &operator=(const SpscRing &) = delete;
+
+  // Producer: the slot to fill next, or null while the ring is full. Calling
+  // it again before CommitPush() returns the same slot.
+  T *BeginPush() {
+    const std::size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_seq_cst) > mask_) {
+      return nullptr;
+    }
+    return &slots_[tail & mask_];
+  }
+  // Waits for a free slot; null once the ring is closed.
+  T *WaitBeginPush() {
+    if (T *slot = BeginPush(); slot != nullptr) {
+      return slot;
+    }
+    std::unique_lock lock(mutex_);
+    T *slot = nullptr;
+    Sleep(lock, producer_waiting_, [&] { return closed_ || (slot = BeginPush()) != nullptr; });
+    return closed_ ? nullptr : slot;
+  }
+  void CommitPush() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    Wake(consumer_waiting_);
+  }
+
+  // Consumer: the oldest committed slot, or null while the ring is empty.
+  T *Front() {
+    const std::size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_seq_cst)) {
+      return nullptr;
+    }
+    return &slots_[head & mask_];
+  }
+  // Waits for a committed slot; null once the ring is closed and drained.
+  T *WaitFront() {
+    if (T *slot = Front(); slot != nullptr) {
+      return slot;
+    }
+    std::unique_lock lock(mutex_);
+    T *slot = nullptr;
+    Sleep(lock, consumer_waiting_, [&] { return (slot = Front()) != nullptr || closed_; });
+    return slot;
+  }
+  void Pop() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    Wake(producer_waiting_);
+  }
+
+  // Wakes both sides for good: WaitBeginPush() returns null at once and
+  // WaitFront() once the committed slots are consumed. Safe from any thread.
+  void Close() {
+    {
+      std::lock_guard lock(mutex_);
+      closed_ = true;
+    }
+    cv_.notify_all();
+  }
+
+private:
+  // `ready` is re-checked under the mutex after the waiting flag is
+  // published, so a Wake() racing with a failed check cannot be missed.
+  template <typename Ready>
+  void Sleep(std::unique_lock<std::mutex> &lock, std::atomic<bool> &waiting, Ready ready) {
+    waiting.store(true, std::memory_order_seq_cst);
+    cv_.wait(lock, ready);
+    waiting.store(false, std::memory_order_relaxed);
+  }
+
+  void Wake(std::atomic<bool> &waiting) {
+    // Pairs with Sleep() publishing the flag before re-checking the indices.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed)) {
+      std::lock_guard lock(mutex_);
+      cv_.notify_all();
+    }
+  }
+
+  std::size_t mask_;
+  std::unique_ptr<T[]> slots_;
+  alignas(64) std::atomic<std::size_t> head_{0};
+  alignas(64) std::atomic<std::size_t> tail_{0};
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::atomic<bool> producer_waiting_{false};
+  std::atomic<bool> consumer_waiting_{false};
+  bool closed_{false};
+};
+
+} // namespace vertel::runtime
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vertel/runtime/metrics.hpp"
+
+namespace vertel::runtime {
+
+// Fixed set of worker threads, each with its own FIFO queue. Tasks submitted
+// with the same shard key always land on the same worker, so they run in
+// submission order while different keys proceed in parallel.
+class ShardedWorkerPool {
+public:
+  explicit ShardedWorkerPool(std::size_t workers, MetricsRegistry *metrics = nullptr);
+  // Runs every queued task before joining the workers.
+  ~ShardedWorkerPool();
+
+  ShardedWorkerPool(const ShardedWorkerPool &) = delete;
+  ShardedWorkerPool &operator=(const ShardedWorkerPool &) = delete;
+
+  void Submit(std::uint64_t shard_key, std::function<void()> task);
+
+  // Blocks until every task submitted so far has finished.
+  void WaitIdle();
+
+  std::size_t size() const { return workers_.size(); }
+
+private:
+  struct Worker {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<std::function<void()>> tasks;
+    bool stopping{false};
+    std::thread thread;
+  };
+
+  void Run(std::size_t index);
+  void TaskFinished();
+
+  MetricsRegistry *metrics_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::mutex idle_mutex_;
+  std::condition_variable idle_cv_;
+  std::size_t pending_{0};
+};
+
+} // namespace vertel::runtime
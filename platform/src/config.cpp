@@ -1,5 +1,6 @@
 #include "vertel/platform/config.hpp"
 
+#include <algorithm>
 #include <cstdlib>
 #include <sstream>
 #include <string>
@@ -47,6 +48,12 @@ Config Config::FromEnv() {
   if (const char *token = std::getenv("TELEGRAM_BOT_TOKEN"); token != nullptr) {
     c.bot_token = token;
   }
+  if (const char *username = std::getenv("TELEGRAM_BOT_USERNAME"); username != nullptr) {
+    c.bot_username = username;
+  }
+  if (const char *api_base = std::getenv("VERTEL_TELEGRAM_API_BASE"); api_base != nullptr) {
+    c.telegram_api_base = api_base;
+  }
   if (const char *inject = std::getenv("VERTEL_INJECT_SAMPLE_START"); inject != nullptr) {
     c.inject_sample_start = std::string(inject) != "0";
   }
@@ -54,16 +61,77 @@ Config Config::FromEnv() {
       ReadIntEnv("VERTEL_TELEGRAM_LONG_POLL_TIMEOUT_SECONDS", c.telegram_long_poll_timeout_seconds);
   c.telegram_request_timeout_seconds =
       ReadIntEnv("VERTEL_TELEGRAM_REQUEST_TIMEOUT_SECONDS", c.telegram_request_timeout_seconds);
+  c.telegram_connection_pool_size = ReadIntEnv("VERTEL_TELEGRAM_CONNECTION_POOL_SIZE",
+                                                c.telegram_connection_pool_size);
+  c.telegram_max_in_flight_sends =
+      ReadIntEnv("VERTEL_TELEGRAM_MAX_IN_FLIGHT_SENDS", c.telegram_max_in_flight_sends);
   c.poll_max_attempts = ReadIntEnv("VERTEL_POLL_MAX_ATTEMPTS", c.poll_max_attempts);
   c.poll_initial_backoff_ms =
       ReadIntEnv("VERTEL_POLL_INITIAL_BACKOFF_MS", c.poll_initial_backoff_ms);
+  c.poll_max_backoff_ms = ReadIntEnv("VERTEL_POLL_MAX_BACKOFF_MS", c.poll_max_backoff_ms);
+  c.retry_budget_percent = ReadIntEnv("VERTEL_RETRY_BUDGET_PERCENT", c.retry_budget_percent);
+  c.circuit_failure_threshold =
+      ReadIntEnv("VERTEL_CIRCUIT_FAILURE_THRESHOLD", c.circuit_failure_threshold);
+  c.circuit_open_ms = ReadIntEnv("VERTEL_CIRCUIT_OPEN_MS", c.circuit_open_ms);
   c.loop_sleep_ms = ReadIntEnv("VERTEL_LOOP_SLEEP_MS", c.loop_sleep_ms);
+  c.poll_limit = ReadIntEnv("VERTEL_POLL_LIMIT", c.poll_limit);
+  c.poll_pipeline_depth = ReadIntEnv("VERTEL_POLL_PIPELINE_DEPTH", c.poll_pipeline_depth);
+  c.dispatch_workers = ReadIntEnv("VERTEL_DISPATCH_WORKERS", c.dispatch_workers);
+  c.outbound_messages_per_second =
+      ReadIntEnv("VERTEL_OUTBOUND_MESSAGES_PER_SECOND", c.outbound_messages_per_second);
+  c.outbound_chat_interval_ms =
+      ReadIntEnv("VERTEL_OUTBOUND_CHAT_INTERVAL_MS", c.outbound_chat_interval_ms);
+  c.outbound_group_interval_ms =
+      ReadIntEnv("VERTEL_OUTBOUND_GROUP_INTERVAL_MS", c.outbound_group_interval_ms);
   c.rate_limit_capacity = ReadIntEnv("VERTEL_RATE_LIMIT_CAPACITY", c.rate_limit_capacity);
   c.rate_limit_refill_tokens =
       ReadIntEnv("VERTEL_RATE_LIMIT_REFILL_TOKENS", c.rate_limit_refill_tokens);
   c.rate_limit_refill_seconds =
       ReadIntEnv("VERTEL_RATE_LIMIT_REFILL_SECONDS", c.rate_limit_refill_seconds);
+  c.rate_limit_max_chats =
+      std::max(1, ReadIntEnv("VERTEL_RATE_LIMIT_MAX_CHATS", c.rate_limit_max_chats));
   c.http_port = ReadIntEnv("VERTEL_HTTP_PORT", c.http_port);
+  if (const char *path = std::getenv("VERTEL_OFFSET_CHECKPOINT_PATH"); path != nullptr) {
+    c.offset_checkpoint_path = path;
+  }
+  if (const char *sync = std::getenv("VERTEL_OFFSET_CHECKPOINT_SYNC"); sync != nullptr) {
+    c.offset_checkpoint_sync = sync;
+  }
+  c.offset_checkpoint_sync_ms =
+      ReadIntEnv("VERTEL_OFFSET_CHECKPOINT_SYNC_MS", c.offset_checkpoint_sync_ms);
+  if (const char *level = std::getenv("VERTEL_LOG_LEVEL"); level != nullptr) {
+    c.log_level = level;
+  }
+  if (const char *async = std::getenv("VERTEL_LOG_ASYNC"); async != nullptr) {
+    c.log_async = std::string(async) != "0";
+  }
+  c.log_queue_capacity =
+      std::max(1, ReadIntEnv("VERTEL_LOG_QUEUE_CAPACITY", c.log_queue_capacity));
+  if (const char *overflow = std::getenv("VERTEL_LOG_OVERFLOW"); overflow != nullptr) {
+    c.log_block_on_overflow = std::string(overflow) == "block";
+  }
+  c.webhook_port = ReadIntEnv("VERTEL_WEBHOOK_PORT", c.webhook_port);
+  c.webhook_threads = ReadIntEnv("VERTEL_WEBHOOK_THREADS", c.webhook_threads);
+  if (const char *path = std::getenv("VERTEL_WEBHOOK_PATH"); path != nullptr) {
+    c.webhook_path = path;
+  }
+  if (const char *url = std::getenv("VERTEL_WEBHOOK_URL"); url != nullptr) {
+    c.webhook_url = url;
+  }
+  if (const char *secret = std::getenv("VERTEL_WEBHOOK_SECRET"); secret != nullptr) {
+    c.webhook_secret = secret;
+  }
+  if (const char *role = std::getenv("VERTEL_SHARD_ROLE"); role != nullptr) {
+    c.shard_role = role;
+  }
+  if (const char *socket = std::getenv("VERTEL_SHARD_SOCKET"); socket != nullptr) {
+    c.shard_socket = socket;
+  }
+  c.shard_count = std::max(1, ReadIntEnv("VERTEL_SHARD_COUNT", c.shard_count));
+  c.shard_index = ReadIntEnv("VERTEL_SHARD_INDEX", c.shard_index);
+  if (const char *replies = std::getenv("VERTEL_SHARD_REPLIES"); replies != nullptr) {
+    c.shard_replies = replies;
+  }
   c.admin_chat_ids = ReadAdminChatIds("ADMIN_CHAT_IDS");
   return c;
 }
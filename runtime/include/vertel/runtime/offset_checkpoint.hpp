@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../include/vertel/runtime/offset_checkpoint.hpp"
@@ -0,0 +1,3 @@
+#pragma once
+
+#include "../../../../include/vertel/runtime/worker_pool.hpp"
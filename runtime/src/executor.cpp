@@ -0,0 +1,109 @@
+#include "vertel/runtime/executor.hpp"
+
+namespace vertel::runtime {
+
+Executor::Detached::promise_type::~promise_type() {
+  executor.Forget(std::coroutine_handle<promise_type>::from_promise(*this).address());
+}
+
+Executor::Executor() : thread_(&Executor::Run, this) {}
+
+Executor::~Executor() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  thread_.join();
+
+  std::unordered_set<void *> roots;
+  {
+    std::lock_guard lock(mutex_);
+    roots.swap(roots_);
+  }
+  // Destroying a root frame destroys the task it awaits and, through it,
+  // every nested frame of that chain.
+  for (void *frame : roots) {
+    std::coroutine_handle<>::from_address(frame).destroy();
+  }
+}
+
+Executor::Detached Executor::RunDetached(Executor &executor, Task<> task) {
+  (void)executor;
+  try {
+    co_await task;
+  } catch (...) {
+  }
+}
+
+void Executor::Spawn(Task<> task) {
+  const Detached root = RunDetached(*this, std::move(task));
+  {
+    std::lock_guard lock(mutex_);
+    roots_.insert(root.handle.address());
+    ready_.push_back(root.handle);
+  }
+  wake_.notify_one();
+}
+
+void Executor::Post(std::coroutine_handle<> handle) {
+  {
+    std::lock_guard lock(mutex_);
+    ready_.push_back(handle);
+  }
+  wake_.notify_one();
+}
+
+void Executor::ResumeAt(Clock::time_point at, std::coroutine_handle<> handle) {
+  {
+    std::lock_guard lock(mutex_);
+    timers_.push(Timer{.at = at, .sequence = ++sequence_, .handle = handle});
+  }
+  wake_.notify_one();
+}
+
+std::size_t Executor::Pending() const {
+  std::lock_guard lock(mutex_);
+  return roots_.size();
+}
+
+void Executor::WaitIdle() {
+  std::unique_lock lock(mutex_);
+  idle_.wait(lock, [this] { return roots_.empty(); });
+}
+
+void Executor::Forget(void *frame) {
+  std::lock_guard lock(mutex_);
+  if (roots_.erase(frame) > 0 && roots_.empty()) {
+    idle_.notify_all();
+  }
+}
+
+void Executor::Run() {
+  std::vector<std::coroutine_handle<>> runnable;
+  std::unique_lock lock(mutex_);
+  while (!stopping_) {
+    const auto now = Clock::now();
+    while (!timers_.empty() && timers_.top().at <= now) {
+      ready_.push_back(timers_.top().handle);
+      timers_.pop();
+    }
+    if (ready_.empty()) {
+      if (timers_.empty()) {
+        wake_.wait(lock);
+      } else {
+        wake_.wait_until(lock, timers_.top().at);
+      }
+      continue;
+    }
+    runnable.swap(ready_);
+    lock.unlock();
+    for (const auto handle : runnable) {
+      handle.resume();
+    }
+    runnable.clear();
+    lock.lock();
+  }
+}
+
+} // namespace vertel::runtime
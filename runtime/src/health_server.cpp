@@ -23,10 +23,16 @@ inline void shutdown_socket(socket_t s) { shutdown(s, SHUT_RDWR); }
 #endif
 
 #include <sstream>
+#include <string>
+#include <string_view>
 
 namespace vertel::runtime {
 namespace {
 
+constexpr const char *kPrometheusContentType = "text/plain; version=0.0.4; charset=utf-8";
+constexpr const char *kOpenMetricsContentType =
+    "application/openmetrics-text; version=1.0.0; charset=utf-8";
+
 #ifdef _WIN32
 struct WinsockInit {
   WinsockInit() {
@@ -38,6 +44,7 @@ struct WinsockInit {
 static WinsockInit winsock_init_;
 #endif
 
+#ifndef __linux__
 std::string BuildHttpResponse(int status_code, const char *status_text, const std::string &body) {
   std::ostringstream response;
   response << "HTTP/1.1 " << status_code << ' ' << status_text << "\r\n";
@@ -61,6 +68,7 @@ std::string ExtractPath(const std::string &request) {
   }
   return line.substr(first_space + 1, second_space - first_space - 1);
 }
+#endif
 
 } // namespace
 
@@ -68,8 +76,64 @@ HealthServer::HealthServer(MetricsRegistry &metrics, int port) : metrics_(metric
 
 HealthServer::~HealthServer() { Stop(); }
 
+HttpResponse HealthServer::Respond(std::string_view path, bool open_metrics) const {
+  path = path.substr(0, path.find('?'));
+  if (path == "/healthz") {
+    return HttpResponse{.status_code = 200, .body = "ok\n"};
+  }
+  if (path == "/metrics") {
+    // Per listener thread, so it keeps its capacity from one scrape to the next.
+    thread_local std::string exposition;
+    metrics_.WriteExposition(exposition, open_metrics);
+    return HttpResponse{.status_code = 200,
+                        .content_type = open_metrics ? kOpenMetricsContentType
+                                                     : kPrometheusContentType,
+                        .body = exposition};
+  }
+  return HttpResponse{.status_code = 404, .body = "not found\n"};
+}
+
+#ifdef __linux__
+
+void HealthServer::Start() {
+  if (port_ < 0) {
+    return;
+  }
+
+  std::scoped_lock lock(mutex_);
+  if (running_) {
+    return;
+  }
+
+  server_ = std::make_unique<HttpServer>(
+      HttpServer::Options{.port = port_},
+      [this](const HttpRequest &request, HttpResponse &response) {
+        response = Respond(request.path, request.Header("Accept").find(
+                                             "application/openmetrics-text") !=
+                                             std::string_view::npos);
+      });
+  running_ = server_->Start();
+  if (running_) {
+    port_ = server_->port();
+  } else {
+    server_.reset();
+  }
+}
+
+void HealthServer::Stop() {
+  std::scoped_lock lock(mutex_);
+  if (!running_) {
+    return;
+  }
+  running_ = false;
+  server_->Stop();
+  server_.reset();
+}
+
+#else
+
 void HealthServer::Start() {
-  if (port_ <= 0) {
+  if (port_ < 0) {
     return;
   }
 
@@ -166,16 +230,10 @@ void HealthServer::Run() {
       request.assign(buffer, static_cast<std::size_t>(bytes_read));
     }
 
-    const std::string path = ExtractPath(request);
-
-    std::string response;
-    if (path == "/healthz") {
-      response = BuildHttpResponse(200, "OK", "ok\n");
-    } else if (path == "/metrics") {
-      response = BuildHttpResponse(200, "OK", BuildMetricsBody(metrics_.Snapshot()));
-    } else {
-      response = BuildHttpResponse(404, "Not Found", "not found\n");
-    }
+    const HttpResponse routed = Respond(ExtractPath(request), /*open_metrics=*/false);
+    const std::string response =
+        BuildHttpResponse(routed.status_code, routed.status_code == 200 ? "OK" : "Not Found",
+                          routed.body);
 
     (void)send(client_fd, response.data(), static_cast<int>(response.size()), 0);
     close_socket(client_fd);
@@ -185,13 +243,6 @@ void HealthServer::Run() {
   listen_fd_ = kInvalidSocket;
 }
 
-std::string HealthServer::BuildMetricsBody(const MetricsSnapshot &snapshot) {
-  std::ostringstream out;
-  out << "vertel_updates_processed_total " << snapshot.updates_processed << "\n";
-  out << "vertel_messages_sent_total " << snapshot.messages_sent << "\n";
-  out << "vertel_handler_failures_total " << snapshot.handler_failures << "\n";
-  out << "vertel_rate_limit_rejections_total " << snapshot.rate_limit_rejections << "\n";
-  return out.str();
-}
+#endif
 
 } // namespace vertel::runtime
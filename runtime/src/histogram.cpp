@@ -0,0 +1,139 @@
+#include "vertel/runtime/histogram.hpp"
+
+#include <charconv>
+#include <cmath>
+
+namespace vertel::runtime {
+namespace detail {
+
+std::size_t MetricShard() {
+  static std::atomic<std::size_t> next_thread{0};
+  thread_local const std::size_t shard =
+      next_thread.fetch_add(1, std::memory_order_relaxed) % kMetricShards;
+  return shard;
+}
+
+} // namespace detail
+
+namespace {
+
+constexpr std::array<std::string_view, 18> kPrometheusBounds{
+    "0.0001", "0.00025", "0.0005", "0.001", "0.0025", "0.005", "0.01", "0.025", "0.05",
+    "0.1",    "0.25",    "0.5",    "1",     "2.5",    "5",     "10",   "30",    "60"};
+constexpr std::array<std::uint64_t, 18> kPrometheusBoundsNs{
+    100'000,     250'000,     500'000,       1'000'000,     2'500'000,     5'000'000,
+    10'000'000,  25'000'000,  50'000'000,    100'000'000,   250'000'000,   500'000'000,
+    1'000'000'000, 2'500'000'000, 5'000'000'000, 10'000'000'000, 30'000'000'000, 60'000'000'000};
+
+template <typename T> void AppendNumber(std::string &out, T value) {
+  char buffer[32];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
+}
+
+void AppendSeriesName(std::string &out, std::string_view name, std::string_view suffix,
+                      std::string_view labels, std::string_view le) {
+  out.append(name).append(suffix);
+  if (labels.empty() && le.empty()) {
+    return;
+  }
+  out.push_back('{');
+  out.append(labels);
+  if (!le.empty()) {
+    if (!labels.empty()) {
+      out.push_back(',');
+    }
+    out.append("le=\"").append(le).append("\"");
+  }
+  out.push_back('}');
+}
+
+} // namespace
+
+std::uint64_t HistogramSnapshot::ValueAtQuantile(double q) const {
+  if (count == 0) {
+    return 0;
+  }
+  const auto rank = static_cast<std::uint64_t>(
+      std::ceil(std::clamp(q, 0.0, 1.0) * static_cast<double>(count)));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= std::max<std::uint64_t>(rank, 1)) {
+      return LatencyHistogram::BucketUpperBound(i);
+    }
+  }
+  return LatencyHistogram::BucketUpperBound(buckets.size() - 1);
+}
+
+LatencyHistogram::~LatencyHistogram() {
+  for (auto &slot : shards_) {
+    delete slot.load(std::memory_order_relaxed);
+  }
+}
+
+LatencyHistogram::Shard *LatencyHistogram::AddShard(std::size_t index) {
+  auto *shard = new Shard;
+  Shard *expected = nullptr;
+  if (!shards_[index].compare_exchange_strong(expected, shard, std::memory_order_acq_rel,
+                                              std::memory_order_acquire)) {
+    delete shard;
+    return expected;
+  }
+  return shard;
+}
+
+HistogramSnapshot LatencyHistogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.buckets.resize(kBuckets);
+  for (const auto &slot : shards_) {
+    const Shard *shard = slot.load(std::memory_order_acquire);
+    if (shard == nullptr) {
+      continue;
+    }
+    for (std::size_t i = 0; i < kBuckets; ++i) {
+      snapshot.buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+    }
+    snapshot.sum_ns += shard->sum_ns.load(std::memory_order_relaxed);
+  }
+  // Bucket counts are the source of truth so _count matches the +Inf bucket.
+  for (const std::uint64_t count : snapshot.buckets) {
+    snapshot.count += count;
+  }
+  return snapshot;
+}
+
+void LatencyHistogram::AppendPrometheus(std::string &out, std::string_view name,
+                                        std::string_view labels) const {
+  const HistogramSnapshot snapshot = Snapshot();
+  std::size_t bucket = 0;
+  std::uint64_t cumulative = 0;
+  for (std::size_t b = 0; b < kPrometheusBounds.size(); ++b) {
+    // A bucket holds [lower, upper); it is at or below the bound only if its
+    // largest value is.
+    while (bucket < kBuckets && BucketUpperBound(bucket) - 1 <= kPrometheusBoundsNs[b]) {
+      cumulative += snapshot.buckets[bucket++];
+    }
+    AppendSeriesName(out, name, "_bucket", labels, kPrometheusBounds[b]);
+    out.push_back(' ');
+    AppendNumber(out, cumulative);
+    out.push_back('\n');
+  }
+  while (bucket < kBuckets) {
+    cumulative += snapshot.buckets[bucket++];
+  }
+  AppendSeriesName(out, name, "_bucket", labels, "+Inf");
+  out.push_back(' ');
+  AppendNumber(out, cumulative);
+  out.push_back('\n');
+  AppendSeriesName(out, name, "_sum", labels, {});
+  out.push_back(' ');
+  AppendNumber(out, static_cast<double>(snapshot.sum_ns) / 1e9);
+  out.push_back('\n');
+  AppendSeriesName(out, name, "_count", labels, {});
+  out.push_back(' ');
+  AppendNumber(out, cumulative);
+  out.push_back('\n');
+}
+
+} // namespace vertel::runtime
@@ -0,0 +1,569 @@
+#include "vertel/runtime/http_server.hpp"
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+namespace vertel::runtime {
+namespace {
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+           const auto lower = [](char c) {
+             return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+           };
+           return lower(x) == lower(y);
+         });
+}
+
+std::string_view Trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+const char *StatusText(int status_code) {
+  switch (status_code) {
+  case 200:
+    return "OK";
+  case 204:
+    return "No Content";
+  case 400:
+    return "Bad Request";
+  case 403:
+    return "Forbidden";
+  case 404:
+    return "Not Found";
+  case 405:
+    return "Method Not Allowed";
+  case 413:
+    return "Payload Too Large";
+  case 429:
+    return "Too Many Requests";
+  case 500:
+    return "Internal Server Error";
+  case 501:
+    return "Not Implemented";
+  case 503:
+    return "Service Unavailable";
+  default:
+    return "Unknown";
+  }
+}
+
+void AppendResponse(std::string &out, const HttpResponse &response, bool keep_alive) {
+  out.append("HTTP/1.1 ");
+  out.append(std::to_string(response.status_code));
+  out.push_back(' ');
+  out.append(StatusText(response.status_code));
+  out.append("\r\nContent-Type: ");
+  out.append(response.content_type);
+  out.append("\r\nContent-Length: ");
+  out.append(std::to_string(response.body.size()));
+  out.append(keep_alive ? "\r\nConnection: keep-alive\r\n\r\n" : "\r\nConnection: close\r\n\r\n");
+  out.append(response.body);
+}
+
+enum class ParseStatus { kIncomplete, kComplete, kInvalid, kTooLarge, kUnsupported };
+
+struct ParsedRequest {
+  HttpRequest request;
+  std::size_t consumed{0};
+  bool keep_alive{true};
+};
+
+// Parses one request from the front of `buffer`. Views in `out` point into it.
+ParseStatus ParseRequest(std::string_view buffer, std::size_t max_bytes, ParsedRequest &out) {
+  const auto header_end = buffer.find("\r\n\r\n");
+  if (header_end == std::string_view::npos) {
+    return buffer.size() > max_bytes ? ParseStatus::kTooLarge : ParseStatus::kIncomplete;
+  }
+
+  std::string_view head = buffer.substr(0, header_end);
+  const auto line_end = head.find("\r\n");
+  const std::string_view request_line = head.substr(0, line_end);
+  head = line_end == std::string_view::npos ? std::string_view{} : head.substr(line_end + 2);
+
+  const auto first_space = request_line.find(' ');
+  const auto second_space = request_line.find(' ', first_space + 1);
+  if (first_space == std::string_view::npos || second_space == std::string_view::npos) {
+    return ParseStatus::kInvalid;
+  }
+  out.request.method = request_line.substr(0, first_space);
+  out.request.path = request_line.substr(first_space + 1, second_space - first_space - 1);
+  const std::string_view version = request_line.substr(second_space + 1);
+  out.keep_alive = version != "HTTP/1.0";
+
+  out.request.headers.clear();
+  std::size_t content_length = 0;
+  while (!head.empty()) {
+    const auto end = head.find("\r\n");
+    const std::string_view line = head.substr(0, end);
+    head = end == std::string_view::npos ? std::string_view{} : head.substr(end + 2);
+    const auto colon = line.find(':');
+    if (colon == std::string_view::npos) {
+      return ParseStatus::kInvalid;
+    }
+    const std::string_view name = Trim(line.substr(0, colon));
+    const std::string_view value = Trim(line.substr(colon + 1));
+    out.request.headers.emplace_back(name, value);
+
+    if (EqualsIgnoreCase(name, "content-length")) {
+      const auto [ptr, ec] =
+          std::from_chars(value.data(), value.data() + value.size(), content_length);
+      if (ec != std::errc{} || ptr != value.data() + value.size()) {
+        return ParseStatus::kInvalid;
+      }
+    } else if (EqualsIgnoreCase(name, "transfer-encoding")) {
+      return ParseStatus::kUnsupported;
+    } else if (EqualsIgnoreCase(name, "connection")) {
+      if (EqualsIgnoreCase(value, "close")) {
+        out.keep_alive = false;
+      } else if (EqualsIgnoreCase(value, "keep-alive")) {
+        out.keep_alive = true;
+      }
+    }
+  }
+
+  const std::size_t body_start = header_end + 4;
+  if (body_start + content_length > max_bytes) {
+    return ParseStatus::kTooLarge;
+  }
+  if (buffer.size() < body_start + content_length) {
+    return ParseStatus::kIncomplete;
+  }
+  out.request.body = buffer.substr(body_start, content_length);
+  out.consumed = body_start + content_length;
+  return ParseStatus::kComplete;
+}
+
+} // namespace
+
+std::string_view HttpRequest::Header(std::string_view name) const {
+  for (const auto &[key, value] : headers) {
+    if (EqualsIgnoreCase(key, name)) {
+      return value;
+    }
+  }
+  return {};
+}
+
+#ifdef __linux__
+
+struct HttpServer::Impl {
+  struct Connection {
+    std::string in;
+    std::string out;
+    std::size_t out_offset{0};
+    bool close_after_write{false};
+    bool want_write{false};
+    std::chrono::steady_clock::time_point last_active;
+  };
+
+  struct Listener {
+    int listen_fd{-1};
+    int epoll_fd{-1};
+    int wake_fd{-1};
+    int timer_fd{-1};
+    std::thread thread;
+    std::unordered_map<int, Connection> connections;
+  };
+
+  Options options;
+  Handler handler;
+  std::atomic<int> bound_port{0};
+  std::mutex mutex;
+  bool running{false};
+  std::vector<std::unique_ptr<Listener>> listeners;
+
+  int OpenListenSocket(int port) const;
+  void Run(Listener &listener);
+  void Accept(Listener &listener);
+  void OnReadable(Listener &listener, int fd);
+  void Flush(Listener &listener, int fd);
+  void Close(Listener &listener, int fd);
+  void SweepIdle(Listener &listener);
+  void Process(Listener &listener, int fd);
+};
+
+int HttpServer::Impl::OpenListenSocket(int port) const {
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return -1;
+  }
+  constexpr int kEnable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &kEnable, sizeof(kEnable));
+  // Each listener thread binds its own socket; the kernel balances accepts.
+  setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &kEnable, sizeof(kEnable));
+
+  sockaddr_in addr{};
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  addr.sin_port = htons(static_cast<uint16_t>(port));
+  if (bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0 ||
+      listen(fd, options.backlog) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+void HttpServer::Impl::Run(Listener &listener) {
+  constexpr int kMaxEvents = 64;
+  epoll_event events[kMaxEvents];
+
+  while (true) {
+    const int ready = epoll_wait(listener.epoll_fd, events, kMaxEvents, -1);
+    if (ready < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    for (int i = 0; i < ready; ++i) {
+      const int fd = events[i].data.fd;
+      if (fd == listener.wake_fd) {
+        return;
+      }
+      if (fd == listener.listen_fd) {
+        Accept(listener);
+      } else if (fd == listener.timer_fd) {
+        std::uint64_t expirations = 0;
+        (void)read(listener.timer_fd, &expirations, sizeof(expirations));
+        SweepIdle(listener);
+      } else if (!listener.connections.contains(fd)) {
+        continue; // closed earlier in this batch
+      } else if ((events[i].events & (EPOLLERR | EPOLLHUP)) != 0) {
+        Close(listener, fd);
+      } else {
+        if ((events[i].events & EPOLLOUT) != 0) {
+          Flush(listener, fd);
+        }
+        if ((events[i].events & (EPOLLIN | EPOLLRDHUP)) != 0 &&
+            listener.connections.contains(fd)) {
+          OnReadable(listener, fd);
+        }
+      }
+    }
+  }
+}
+
+void HttpServer::Impl::Accept(Listener &listener) {
+  while (true) {
+    const int fd = accept4(listener.listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd < 0) {
+      return; // EAGAIN: backlog drained. Other errors: retry on next readiness.
+    }
+    constexpr int kEnable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &kEnable, sizeof(kEnable));
+
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    if (epoll_ctl(listener.epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0) {
+      close(fd);
+      continue;
+    }
+    listener.connections[fd].last_active = std::chrono::steady_clock::now();
+  }
+}
+
+void HttpServer::Impl::OnReadable(Listener &listener, int fd) {
+  char buffer[16 * 1024];
+  bool peer_closed = false;
+  // Edge-triggered: read until the socket is drained, but hold at most one
+  // request's worth at a time. Past max_request_bytes, Process() either
+  // consumes complete requests, so reading resumes, or answers 413 and closes.
+  for (bool capped = true; capped;) {
+    auto &conn = listener.connections[fd];
+    if (conn.close_after_write) {
+      return;
+    }
+    capped = false;
+    while (true) {
+      if (conn.in.size() > options.max_request_bytes) {
+        capped = true;
+        break;
+      }
+      const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+      if (n > 0) {
+        conn.in.append(buffer, static_cast<std::size_t>(n));
+        continue;
+      }
+      if (n == 0) {
+        peer_closed = true;
+      } else if (errno == EINTR) {
+        continue;
+      } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        peer_closed = true;
+      }
+      break;
+    }
+    conn.last_active = std::chrono::steady_clock::now();
+
+    Process(listener, fd);
+    if (!listener.connections.contains(fd)) {
+      return;
+    }
+  }
+
+  if (peer_closed) {
+    auto &still_open = listener.connections[fd];
+    if (still_open.out.size() == still_open.out_offset) {
+      Close(listener, fd);
+    } else {
+      still_open.close_after_write = true;
+    }
+  }
+}
+
+void HttpServer::Impl::Process(Listener &listener, int fd) {
+  auto &conn = listener.connections[fd];
+  std::size_t offset = 0;
+  ParsedRequest parsed;
+  while (!conn.close_after_write) {
+    const std::string_view pending = std::string_view(conn.in).substr(offset);
+    const ParseStatus status = ParseRequest(pending, options.max_request_bytes, parsed);
+    if (status == ParseStatus::kIncomplete) {
+      break;
+    }
+
+    HttpResponse response;
+    bool keep_alive = parsed.keep_alive;
+    if (status == ParseStatus::kComplete) {
+      try {
+        handler(parsed.request, response);
+      } catch (...) {
+        response = HttpResponse{.status_code = 500, .body = "internal error\n"};
+      }
+      offset += parsed.consumed;
+    } else {
+      response.status_code = status == ParseStatus::kTooLarge     ? 413
+                             : status == ParseStatus::kUnsupported ? 501
+                                                                   : 400;
+      response.body = std::string(StatusText(response.status_code)) + "\n";
+      keep_alive = false;
+    }
+
+    AppendResponse(conn.out, response, keep_alive);
+    if (!keep_alive) {
+      conn.close_after_write = true;
+    }
+  }
+  conn.in.erase(0, offset);
+  Flush(listener, fd);
+}
+
+void HttpServer::Impl::Flush(Listener &listener, int fd) {
+  auto it = listener.connections.find(fd);
+  if (it == listener.connections.end()) {
+    return;
+  }
+  auto &conn = it->second;
+  while (conn.out_offset < conn.out.size()) {
+    const ssize_t n = send(fd, conn.out.data() + conn.out_offset, conn.out.size() - conn.out_offset,
+                           MSG_NOSIGNAL);
+    if (n > 0) {
+      conn.out_offset += static_cast<std::size_t>(n);
+      continue;
+    }
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      if (!conn.want_write) {
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        epoll_ctl(listener.epoll_fd, EPOLL_CTL_MOD, fd, &event);
+        conn.want_write = true;
+      }
+      return;
+    }
+    Close(listener, fd);
+    return;
+  }
+
+  conn.out.clear();
+  conn.out_offset = 0;
+  if (conn.close_after_write) {
+    Close(listener, fd);
+    return;
+  }
+  if (conn.want_write) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLET;
+    event.data.fd = fd;
+    epoll_ctl(listener.epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    conn.want_write = false;
+  }
+}
+
+void HttpServer::Impl::Close(Listener &listener, int fd) {
+  epoll_ctl(listener.epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+  close(fd);
+  listener.connections.erase(fd);
+}
+
+void HttpServer::Impl::SweepIdle(Listener &listener) {
+  const auto deadline = std::chrono::steady_clock::now() - options.idle_timeout;
+  std::vector<int> idle;
+  for (const auto &[fd, conn] : listener.connections) {
+    if (conn.last_active < deadline) {
+      idle.push_back(fd);
+    }
+  }
+  for (const int fd : idle) {
+    Close(listener, fd);
+  }
+}
+
+HttpServer::HttpServer(Options options, Handler handler) : impl_(std::make_unique<Impl>()) {
+  impl_->options = options;
+  impl_->options.threads = std::max<std::size_t>(1, options.threads);
+  impl_->handler = std::move(handler);
+  impl_->bound_port = options.port;
+}
+
+HttpServer::~HttpServer() { Stop(); }
+
+bool HttpServer::Start() {
+  std::scoped_lock lock(impl_->mutex);
+  if (impl_->running) {
+    return true;
+  }
+
+  int port = impl_->options.port;
+  std::vector<std::unique_ptr<Impl::Listener>> listeners;
+  const auto cleanup = [&listeners] {
+    for (auto &listener : listeners) {
+      for (const int fd :
+           {listener->listen_fd, listener->epoll_fd, listener->wake_fd, listener->timer_fd}) {
+        if (fd >= 0) {
+          close(fd);
+        }
+      }
+    }
+  };
+
+  for (std::size_t i = 0; i < impl_->options.threads; ++i) {
+    auto listener = std::make_unique<Impl::Listener>();
+    listener->listen_fd = impl_->OpenListenSocket(port);
+    listener->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    listener->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    listener->timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    const bool ok = listener->listen_fd >= 0 && listener->epoll_fd >= 0 &&
+                    listener->wake_fd >= 0 && listener->timer_fd >= 0;
+    listeners.push_back(std::move(listener));
+    if (!ok) {
+      cleanup();
+      return false;
+    }
+
+    auto &current = *listeners.back();
+    if (port == 0) {
+      // Remaining listeners join the ephemeral port the first one received.
+      sockaddr_in addr{};
+      socklen_t len = sizeof(addr);
+      getsockname(current.listen_fd, reinterpret_cast<sockaddr *>(&addr), &len);
+      port = ntohs(addr.sin_port);
+    }
+
+    const auto sweep = std::max<std::chrono::seconds>(
+        std::chrono::seconds(1), impl_->options.idle_timeout / 2);
+    itimerspec interval{};
+    interval.it_interval.tv_sec = static_cast<time_t>(sweep.count());
+    interval.it_value.tv_sec = static_cast<time_t>(sweep.count());
+    timerfd_settime(current.timer_fd, 0, &interval, nullptr);
+
+    for (const int fd : {current.listen_fd, current.wake_fd, current.timer_fd}) {
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.fd = fd;
+      epoll_ctl(current.epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    }
+  }
+
+  impl_->bound_port = port;
+  impl_->listeners = std::move(listeners);
+  for (auto &listener : impl_->listeners) {
+    listener->thread = std::thread(&Impl::Run, impl_.get(), std::ref(*listener));
+  }
+  impl_->running = true;
+  return true;
+}
+
+void HttpServer::Stop() {
+  std::scoped_lock lock(impl_->mutex);
+  if (!impl_->running) {
+    return;
+  }
+  impl_->running = false;
+
+  for (auto &listener : impl_->listeners) {
+    const std::uint64_t one = 1;
+    (void)write(listener->wake_fd, &one, sizeof(one));
+  }
+  for (auto &listener : impl_->listeners) {
+    if (listener->thread.joinable()) {
+      listener->thread.join();
+    }
+    for (const auto &[fd, conn] : listener->connections) {
+      close(fd);
+    }
+    listener->connections.clear();
+    for (const int fd :
+         {listener->listen_fd, listener->epoll_fd, listener->wake_fd, listener->timer_fd}) {
+      close(fd);
+    }
+  }
+  impl_->listeners.clear();
+}
+
+#else
+
+struct HttpServer::Impl {
+  Options options;
+};
+
+HttpServer::HttpServer(Options options, Handler) : impl_(std::make_unique<Impl>()) {
+  impl_->options = options;
+}
+
+HttpServer::~HttpServer() = default;
+
+bool HttpServer::Start() { return false; }
+
+void HttpServer::Stop() {}
+
+#endif
+
+int HttpServer::port() const {
+#ifdef __linux__
+  return impl_->bound_port.load();
+#else
+  return impl_->options.port;
+#endif
+}
+
+} // namespace vertel::runtime
@@ -1,14 +1,23 @@
 #include "vertel/runtime/logger.hpp"
 
+#include <algorithm>
+#include <bit>
+#include <charconv>
 #include <chrono>
-#include <iomanip>
-#include <sstream>
+#include <cmath>
+#include <ctime>
 
 namespace vertel::runtime {
 namespace {
 
-std::string LevelToString(LogLevel level) {
+// Upper bound on one write by the async writer; a storm is written in
+// several chunks instead of one ever-growing buffer.
+constexpr std::size_t kMaxBatchBytes = 64 * 1024;
+
+std::string_view LevelToString(LogLevel level) {
   switch (level) {
+  case LogLevel::kDebug:
+    return "DEBUG";
   case LogLevel::kInfo:
     return "INFO";
   case LogLevel::kWarn:
@@ -19,43 +28,261 @@ std::string LevelToString(LogLevel level) {
   return "UNKNOWN";
 }
 
-std::string UtcTimestamp() {
-  const auto now = std::chrono::system_clock::now();
-  const auto tt = std::chrono::system_clock::to_time_t(now);
-  std::tm tm{};
+// The formatted second is cached per thread and only rebuilt when it changes.
+void AppendUtcTimestamp(std::string &out) {
+  thread_local std::time_t cached_second = -1;
+  thread_local char cached[32];
+  thread_local std::size_t cached_size = 0;
+
+  const auto tt = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+  if (tt != cached_second) {
+    std::tm tm{};
 #if defined(_WIN32)
-  gmtime_s(&tm, &tt);
+    gmtime_s(&tm, &tt);
 #else
-  gmtime_r(&tt, &tm);
+    gmtime_r(&tt, &tm);
 #endif
-  std::ostringstream oss;
-  oss << std::put_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
-  return oss.str();
+    cached_size = std::strftime(cached, sizeof(cached), "%Y-%m-%dT%H:%M:%SZ", &tm);
+    cached_second = tt;
+  }
+  out.append(cached, cached_size);
 }
 
-std::string Escape(std::string_view in) {
-  std::string out;
-  out.reserve(in.size());
-  for (char c : in) {
-    if (c == '"' || c == '\\')
-      out.push_back('\\');
-    out.push_back(c);
+// JSON string escaping, appended directly to `out`. Runs of plain characters
+// are copied in one append.
+void AppendEscaped(std::string &out, std::string_view in) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::size_t plain = 0;
+  for (std::size_t i = 0; i < in.size(); ++i) {
+    const auto c = static_cast<unsigned char>(in[i]);
+    if (c >= 0x20 && c != '"' && c != '\\') {
+      continue;
+    }
+    out.append(in.data() + plain, i - plain);
+    plain = i + 1;
+    switch (c) {
+    case '"':
+      out.append("\\\"");
+      break;
+    case '\\':
+      out.append("\\\\");
+      break;
+    case '\n':
+      out.append("\\n");
+      break;
+    case '\r':
+      out.append("\\r");
+      break;
+    case '\t':
+      out.append("\\t");
+      break;
+    default:
+      out.append("\\u00");
+      out.push_back(kHex[c >> 4]);
+      out.push_back(kHex[c & 0xf]);
+      break;
+    }
   }
-  return out;
+  out.append(in.data() + plain, in.size() - plain);
+}
+
+template <typename T> void AppendNumber(std::string &out, T value) {
+  char buffer[32];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
 }
 
 } // namespace
 
-Logger::Logger(std::ostream &out) : out_(out) {}
+LogLevel ParseLogLevel(std::string_view name, LogLevel fallback) {
+  if (name == "debug") {
+    return LogLevel::kDebug;
+  }
+  if (name == "info") {
+    return LogLevel::kInfo;
+  }
+  if (name == "warn") {
+    return LogLevel::kWarn;
+  }
+  if (name == "error") {
+    return LogLevel::kError;
+  }
+  return fallback;
+}
+
+Logger::Logger(std::ostream &out, LoggerOptions options, MetricsRegistry *metrics)
+    : out_(out), options_(options), min_level_(options.min_level) {
+  if (metrics != nullptr) {
+    dropped_counter_ =
+        &metrics->GetCounter("vertel_log_dropped_total", "Log lines dropped on a full log queue");
+  }
+  if (!options_.async) {
+    return;
+  }
+  const std::size_t capacity = std::bit_ceil(std::max<std::size_t>(2, options_.queue_capacity));
+  slots_ = std::make_unique<Slot[]>(capacity);
+  mask_ = capacity - 1;
+  for (std::size_t i = 0; i < capacity; ++i) {
+    slots_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  writer_ = std::thread([this] { WriterLoop(); });
+}
+
+Logger::~Logger() {
+  if (!writer_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_one();
+  writer_.join();
+}
 
 void Logger::Log(LogLevel level, std::string_view message,
-                 std::initializer_list<std::pair<std::string, std::string>> fields) {
-  out_ << "{\"ts\":\"" << UtcTimestamp() << "\",\"level\":\"" << LevelToString(level)
-       << "\",\"msg\":\"" << Escape(message) << "\"";
-  for (const auto &[k, v] : fields) {
-    out_ << ",\"" << Escape(k) << "\":\"" << Escape(v) << "\"";
+                 std::initializer_list<LogField> fields) {
+  if (!Enabled(level)) {
+    return;
+  }
+  // Reused per thread; an async Enqueue() swaps in the buffer of the slot it
+  // fills, so steady-state logging does not allocate.
+  thread_local std::string line;
+  line.clear();
+  line.append("{\"ts\":\"");
+  AppendUtcTimestamp(line);
+  line.append("\",\"level\":\"").append(LevelToString(level)).append("\",\"msg\":\"");
+  AppendEscaped(line, message);
+  line.push_back('"');
+  for (const LogField &field : fields) {
+    line.append(",\"");
+    AppendEscaped(line, field.key_);
+    line.append("\":");
+    switch (field.kind_) {
+    case LogField::Kind::kString:
+      line.push_back('"');
+      AppendEscaped(line, field.string_);
+      line.push_back('"');
+      break;
+    case LogField::Kind::kInt:
+      AppendNumber(line, field.int_);
+      break;
+    case LogField::Kind::kUint:
+      AppendNumber(line, field.uint_);
+      break;
+    case LogField::Kind::kDouble:
+      // JSON has no NaN or infinity.
+      if (std::isfinite(field.double_)) {
+        AppendNumber(line, field.double_);
+      } else {
+        line.append("null");
+      }
+      break;
+    case LogField::Kind::kBool:
+      line.append(field.bool_ ? "true" : "false");
+      break;
+    }
+  }
+  line.append("}\n");
+
+  if (!options_.async) {
+    std::lock_guard lock(mutex_);
+    out_.write(line.data(), static_cast<std::streamsize>(line.size()));
+    out_.flush();
+    return;
+  }
+  Enqueue(line);
+}
+
+void Logger::Enqueue(std::string &line) {
+  std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+  Slot *slot = nullptr;
+  for (;;) {
+    slot = &slots_[pos & mask_];
+    const std::size_t sequence = slot->sequence.load(std::memory_order_acquire);
+    const auto diff = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // The slot still holds a line from the previous lap: the queue is full.
+      if (options_.overflow == LogOverflowPolicy::kDrop) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        if (dropped_counter_ != nullptr) {
+          dropped_counter_->Increment();
+        }
+        return;
+      }
+      WakeWriter();
+      std::this_thread::yield();
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    } else {
+      pos = enqueue_pos_.load(std::memory_order_relaxed);
+    }
+  }
+  slot->line.swap(line);
+  slot->sequence.store(pos + 1, std::memory_order_release);
+  WakeWriter();
+}
+
+void Logger::WakeWriter() {
+  // Pairs with the writer publishing writer_idle_ before re-checking the
+  // queue: either it sees our slot or we see it idle.
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (writer_idle_.load(std::memory_order_relaxed)) {
+    std::lock_guard lock(mutex_);
+    wake_.notify_one();
+  }
+}
+
+void Logger::Flush() {
+  if (!options_.async) {
+    std::lock_guard lock(mutex_);
+    out_.flush();
+    return;
+  }
+  const std::size_t target = enqueue_pos_.load(std::memory_order_acquire);
+  std::unique_lock lock(mutex_);
+  written_cv_.wait(lock, [&] { return written_pos_.load(std::memory_order_acquire) >= target; });
+}
+
+void Logger::WriterLoop() {
+  std::string batch;
+  std::size_t pos = 0;
+  const auto ready = [&] {
+    return slots_[pos & mask_].sequence.load(std::memory_order_seq_cst) == pos + 1;
+  };
+  for (;;) {
+    batch.clear();
+    while (batch.size() < kMaxBatchBytes && ready()) {
+      Slot &slot = slots_[pos & mask_];
+      batch.append(slot.line);
+      slot.line.clear();
+      slot.sequence.store(pos + mask_ + 1, std::memory_order_release);
+      ++pos;
+    }
+    if (!batch.empty()) {
+      out_.write(batch.data(), static_cast<std::streamsize>(batch.size()));
+      out_.flush();
+      {
+        std::lock_guard lock(mutex_);
+        written_pos_.store(pos, std::memory_order_release);
+      }
+      written_cv_.notify_all();
+      continue;
+    }
+
+    std::unique_lock lock(mutex_);
+    // A producer may have claimed a slot without filling it yet; keep going
+    // until everything claimed before the stop has been written.
+    if (stopping_ && enqueue_pos_.load(std::memory_order_acquire) == pos) {
+      return;
+    }
+    writer_idle_.store(true, std::memory_order_seq_cst);
+    wake_.wait(lock, [&] { return stopping_ || ready(); });
+    writer_idle_.store(false, std::memory_order_relaxed);
   }
-  out_ << "}" << std::endl;
 }
 
 } // namespace vertel::runtime
@@ -0,0 +1,301 @@
+#include "vertel/runtime/metrics.hpp"
+
+#include <charconv>
+#include <mutex>
+#include <stdexcept>
+#include <variant>
+
+namespace vertel::runtime {
+namespace {
+
+void AppendEscaped(std::string &out, std::string_view text, bool escape_quotes) {
+  for (const char c : text) {
+    if (c == '\\') {
+      out.append("\\\\");
+    } else if (c == '\n') {
+      out.append("\\n");
+    } else if (c == '"' && escape_quotes) {
+      out.append("\\\"");
+    } else {
+      out.push_back(c);
+    }
+  }
+}
+
+// `a="x",b="y"`: the form stored per series and spliced into sample lines.
+std::string RenderLabels(const MetricLabels &labels) {
+  std::string rendered;
+  for (const auto &[name, value] : labels) {
+    if (!rendered.empty()) {
+      rendered.push_back(',');
+    }
+    rendered.append(name).append("=\"");
+    AppendEscaped(rendered, value, /*escape_quotes=*/true);
+    rendered.push_back('"');
+  }
+  return rendered;
+}
+
+template <typename T> void AppendNumber(std::string &out, T value) {
+  char buffer[32];
+  const auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  out.append(buffer, end);
+}
+
+} // namespace
+
+std::uint64_t Counter::Value() const {
+  std::int64_t total = 0;
+  for (const auto &cell : cells_) {
+    total += cell.value.load(std::memory_order_relaxed);
+  }
+  return static_cast<std::uint64_t>(total);
+}
+
+std::int64_t Gauge::Value() const {
+  std::int64_t total = 0;
+  for (const auto &cell : cells_) {
+    total += cell.value.load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+struct MetricsRegistry::Series {
+  std::string labels;
+  std::variant<Counter, Gauge, LatencyHistogram> value;
+
+  template <typename T>
+  explicit Series(std::string rendered_labels, std::in_place_type_t<T> type)
+      : labels(std::move(rendered_labels)), value(type) {}
+};
+
+struct MetricsRegistry::Family {
+  std::string name;
+  std::string help;
+  Type type;
+  double scale;
+  std::vector<std::unique_ptr<Series>> series;
+  std::unordered_map<std::string, Series *> by_labels;
+};
+
+MetricsRegistry::MetricsRegistry() : MetricsRegistry(nullptr, {}) {}
+
+MetricsRegistry::MetricsRegistry(MetricsRegistry &parent, MetricLabels labels)
+    : MetricsRegistry(&parent, std::move(labels)) {}
+
+MetricsRegistry::MetricsRegistry(MetricsRegistry *parent, MetricLabels labels)
+    : parent_(parent), scope_(std::move(labels)),
+      updates_processed_(GetCounter("vertel_updates_processed_total", "Total updates polled")),
+      messages_sent_(GetCounter("vertel_messages_sent_total", "Total messages sent")),
+      handler_failures_(
+          GetCounter("vertel_handler_failures_total", "Handler processing errors")),
+      rate_limit_rejections_(
+          GetCounter("vertel_rate_limit_rejections_total", "Rate-limited requests")),
+      send_failures_(GetCounter("vertel_send_failures_total", "Replies that failed to send")),
+      dispatch_queue_depth_(
+          GetGauge("vertel_dispatch_queue_depth", "Updates queued for dispatch workers")),
+      rate_limiter_tracked_chats_(GetGauge("vertel_rate_limiter_tracked_chats",
+                                           "Chats currently holding rate-limit state")),
+      outbound_queue_depth_(
+          GetGauge("vertel_outbound_queue_depth", "Messages waiting for their send slot")),
+      outbound_throttled_(GetCounter("vertel_outbound_throttled_total",
+                                     "HTTP 429 responses seen by the outbound scheduler")),
+      retries_(GetCounter("vertel_retries_total", "Retries scheduled by the retry engine")),
+      retry_budget_exhausted_(
+          GetCounter("vertel_retry_budget_exhausted_total",
+                     "Retries refused because the retry budget was spent")),
+      circuit_opened_(
+          GetCounter("vertel_circuit_open_total", "Times an endpoint's circuit breaker opened")) {
+  static constexpr std::array<std::pair<std::string_view, std::string_view>, kLatencyStages>
+      kStages{{
+          {"vertel_poll_duration_seconds", "getUpdates round-trip"},
+          {"vertel_parse_duration_seconds", "Time spent decoding each getUpdates body"},
+          {"vertel_handle_duration_seconds", "Handler-chain time per update"},
+          {"vertel_send_duration_seconds", "sendMessage round-trip"},
+          {"vertel_end_to_end_latency_seconds",
+           "Telegram's message.date to reply delivered (1 s resolution)"},
+      }};
+  for (std::size_t i = 0; i < kLatencyStages; ++i) {
+    latency_[i] = &GetHistogram(kStages[i].first, kStages[i].second);
+  }
+}
+
+MetricsRegistry::~MetricsRegistry() = default;
+
+MetricsRegistry::Series &MetricsRegistry::GetSeries(std::string_view name, std::string_view help,
+                                                    Type type, const MetricLabels &labels,
+                                                    double scale) {
+  if (parent_ != nullptr) {
+    MetricLabels scoped = scope_;
+    scoped.insert(scoped.end(), labels.begin(), labels.end());
+    return parent_->GetSeries(name, help, type, scoped, scale);
+  }
+  std::string rendered = RenderLabels(labels);
+  {
+    std::shared_lock lock(mutex_);
+    if (const auto family = by_name_.find(std::string(name)); family != by_name_.end()) {
+      if (family->second->type != type) {
+        throw std::invalid_argument("metric registered with another type: " + std::string(name));
+      }
+      if (const auto it = family->second->by_labels.find(rendered);
+          it != family->second->by_labels.end()) {
+        return *it->second;
+      }
+    }
+  }
+
+  std::unique_lock lock(mutex_);
+  auto [entry, inserted] = by_name_.try_emplace(std::string(name), nullptr);
+  if (inserted) {
+    families_.push_back(std::make_unique<Family>(Family{.name = std::string(name),
+                                                        .help = std::string(help),
+                                                        .type = type,
+                                                        .scale = scale,
+                                                        .series = {},
+                                                        .by_labels = {}}));
+    entry->second = families_.back().get();
+  }
+  Family &family = *entry->second;
+  if (family.type != type) {
+    throw std::invalid_argument("metric registered with another type: " + std::string(name));
+  }
+  if (const auto it = family.by_labels.find(rendered); it != family.by_labels.end()) {
+    return *it->second; // created by another thread between the two locks
+  }
+  std::unique_ptr<Series> series;
+  switch (type) {
+  case Type::kCounter:
+    series = std::make_unique<Series>(rendered, std::in_place_type<Counter>);
+    break;
+  case Type::kGauge:
+    series = std::make_unique<Series>(rendered, std::in_place_type<Gauge>);
+    break;
+  case Type::kHistogram:
+    series = std::make_unique<Series>(rendered, std::in_place_type<LatencyHistogram>);
+    break;
+  }
+  Series &created = *series;
+  family.series.push_back(std::move(series));
+  family.by_labels.emplace(std::move(rendered), &created);
+  return created;
+}
+
+Counter &MetricsRegistry::GetCounter(std::string_view name, std::string_view help,
+                                     const MetricLabels &labels, double scale) {
+  return std::get<Counter>(GetSeries(name, help, Type::kCounter, labels, scale).value);
+}
+
+Gauge &MetricsRegistry::GetGauge(std::string_view name, std::string_view help,
+                                 const MetricLabels &labels) {
+  return std::get<Gauge>(GetSeries(name, help, Type::kGauge, labels, 1.0).value);
+}
+
+LatencyHistogram &MetricsRegistry::GetHistogram(std::string_view name, std::string_view help,
+                                                const MetricLabels &labels) {
+  return std::get<LatencyHistogram>(GetSeries(name, help, Type::kHistogram, labels, 1.0).value);
+}
+
+void MetricsRegistry::AddWorkerBusyTime(std::size_t worker, std::chrono::nanoseconds busy) {
+  if (worker >= kMaxTrackedWorkers) {
+    return;
+  }
+  Counter *counter = worker_busy_[worker].load(std::memory_order_acquire);
+  if (counter == nullptr) {
+    counter = &GetCounter("vertel_dispatch_worker_busy_seconds_total",
+                          "Time each dispatch worker spent handling updates",
+                          {{"worker", std::to_string(worker)}}, 1e-9);
+    worker_busy_[worker].store(counter, std::memory_order_release);
+  }
+  counter->Increment(static_cast<std::uint64_t>(busy.count()));
+  auto seen = workers_seen_.load(std::memory_order_relaxed);
+  while (seen <= worker &&
+         !workers_seen_.compare_exchange_weak(seen, worker + 1, std::memory_order_relaxed)) {
+  }
+}
+
+void MetricsRegistry::WriteExposition(std::string &out, bool open_metrics) const {
+  if (parent_ != nullptr) {
+    parent_->WriteExposition(out, open_metrics);
+    return;
+  }
+  out.clear();
+  std::shared_lock lock(mutex_);
+  for (const auto &family : families_) {
+    if (family->series.empty()) {
+      continue;
+    }
+    // OpenMetrics names a counter family without the _total its samples carry.
+    std::string_view family_name = family->name;
+    if (open_metrics && family->type == Type::kCounter && family_name.ends_with("_total")) {
+      family_name.remove_suffix(6);
+    }
+    out.append("# HELP ").append(family_name).push_back(' ');
+    AppendEscaped(out, family->help, /*escape_quotes=*/false);
+    out.append("\n# TYPE ").append(family_name);
+    switch (family->type) {
+    case Type::kCounter:
+      out.append(" counter\n");
+      break;
+    case Type::kGauge:
+      out.append(" gauge\n");
+      break;
+    case Type::kHistogram:
+      out.append(" histogram\n");
+      break;
+    }
+
+    for (const auto &series : family->series) {
+      if (family->type == Type::kHistogram) {
+        std::get<LatencyHistogram>(series->value).AppendPrometheus(out, family->name,
+                                                                   series->labels);
+        continue;
+      }
+      out.append(family->name);
+      if (!series->labels.empty()) {
+        out.append("{").append(series->labels).append("}");
+      }
+      out.push_back(' ');
+      if (family->type == Type::kGauge) {
+        AppendNumber(out, std::get<Gauge>(series->value).Value());
+      } else if (family->scale == 1.0) {
+        AppendNumber(out, std::get<Counter>(series->value).Value());
+      } else {
+        AppendNumber(out,
+                     static_cast<double>(std::get<Counter>(series->value).Value()) * family->scale);
+      }
+      out.push_back('\n');
+    }
+  }
+  if (open_metrics) {
+    out.append("# EOF\n");
+  }
+}
+
+MetricsSnapshot MetricsRegistry::Snapshot() const {
+  MetricsSnapshot snapshot{.updates_processed = updates_processed_.Value(),
+                           .messages_sent = messages_sent_.Value(),
+                           .handler_failures = handler_failures_.Value(),
+                           .rate_limit_rejections = rate_limit_rejections_.Value(),
+                           .send_failures = send_failures_.Value(),
+                           .dispatch_queue_depth = dispatch_queue_depth_.Value(),
+                           .rate_limiter_tracked_chats = rate_limiter_tracked_chats_.Value(),
+                           .outbound_queue_depth = outbound_queue_depth_.Value(),
+                           .outbound_throttled = outbound_throttled_.Value(),
+                           .retries = retries_.Value(),
+                           .retry_budget_exhausted = retry_budget_exhausted_.Value(),
+                           .circuit_opened = circuit_opened_.Value(),
+                           .worker_busy_ns = {},
+                           .latency = {}};
+  const auto workers = workers_seen_.load(std::memory_order_relaxed);
+  snapshot.worker_busy_ns.reserve(workers);
+  for (std::size_t i = 0; i < workers; ++i) {
+    const Counter *counter = worker_busy_[i].load(std::memory_order_acquire);
+    snapshot.worker_busy_ns.push_back(counter != nullptr ? counter->Value() : 0);
+  }
+  for (std::size_t i = 0; i < kLatencyStages; ++i) {
+    snapshot.latency[i] = latency_[i]->Snapshot();
+  }
+  return snapshot;
+}
+
+} // namespace vertel::runtime
@@ -0,0 +1,159 @@
+#include "vertel/runtime/offset_checkpoint.hpp"
+
+#include <stdexcept>
+#include <utility>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#endif
+
+namespace vertel::runtime {
+namespace {
+
+constexpr std::uint64_t kMagic = 0x31544b4f4c455456ULL; // "VTELOKT1"
+
+// splitmix64 finaliser: an all-zero slot, as in a fresh file, never validates.
+std::uint64_t Checksum(std::int64_t offset) {
+  std::uint64_t x = static_cast<std::uint64_t>(offset) ^ kMagic;
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+} // namespace
+
+CheckpointSync ParseCheckpointSync(std::string_view name, CheckpointSync fallback) {
+  if (name == "never") {
+    return CheckpointSync::kNever;
+  }
+  if (name == "interval") {
+    return CheckpointSync::kInterval;
+  }
+  if (name == "commit") {
+    return CheckpointSync::kEveryCommit;
+  }
+  return fallback;
+}
+
+OffsetCheckpoint::OffsetCheckpoint(std::string path, OffsetCheckpointOptions options)
+    : path_(std::move(path)), options_(options), last_sync_(std::chrono::steady_clock::now()) {
+  constexpr auto kSize = sizeof(Layout);
+#ifdef _WIN32
+  file_ = CreateFileA(path_.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr,
+                      OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file_ == INVALID_HANDLE_VALUE) {
+    file_ = nullptr;
+    throw std::runtime_error("cannot open offset checkpoint " + path_);
+  }
+  mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READWRITE, 0, static_cast<DWORD>(kSize),
+                                nullptr);
+  void *view = mapping_ != nullptr
+                   ? MapViewOfFile(mapping_, FILE_MAP_ALL_ACCESS, 0, 0, kSize)
+                   : nullptr;
+  if (view == nullptr) {
+    if (mapping_ != nullptr) {
+      CloseHandle(mapping_);
+    }
+    CloseHandle(file_);
+    throw std::runtime_error("cannot map offset checkpoint " + path_);
+  }
+#else
+  fd_ = ::open(path_.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+  if (fd_ < 0) {
+    throw std::runtime_error("cannot open offset checkpoint " + path_ + ": " +
+                             std::strerror(errno));
+  }
+  struct stat st {};
+  void *view = MAP_FAILED;
+  if (::fstat(fd_, &st) == 0 &&
+      (static_cast<std::size_t>(st.st_size) >= kSize ||
+       ::ftruncate(fd_, static_cast<off_t>(kSize)) == 0)) {
+    view = ::mmap(nullptr, kSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  }
+  if (view == MAP_FAILED) {
+    const int error = errno;
+    ::close(fd_);
+    throw std::runtime_error("cannot map offset checkpoint " + path_ + ": " +
+                             std::strerror(error));
+  }
+#endif
+  layout_ = static_cast<Layout *>(view);
+
+  if (layout_->magic != kMagic) {
+    // New or foreign file: start from nothing committed.
+    layout_->slots[0] = Slot{0, 0};
+    layout_->slots[1] = Slot{0, 0};
+    layout_->magic = kMagic;
+    return;
+  }
+  for (unsigned i = 0; i < 2; ++i) {
+    const Slot &slot = layout_->slots[i];
+    if (slot.checksum == Checksum(slot.offset) && slot.offset > committed_) {
+      committed_ = slot.offset;
+      next_slot_ = i ^ 1U;
+    }
+  }
+}
+
+OffsetCheckpoint::~OffsetCheckpoint() {
+  if (dirty_ && options_.sync != CheckpointSync::kNever) {
+    Sync();
+  }
+#ifdef _WIN32
+  UnmapViewOfFile(layout_);
+  CloseHandle(mapping_);
+  CloseHandle(file_);
+#else
+  ::munmap(layout_, sizeof(Layout));
+  ::close(fd_);
+#endif
+}
+
+std::int64_t OffsetCheckpoint::Load() const { return committed_; }
+
+void OffsetCheckpoint::Commit(std::int64_t next_offset) {
+  if (next_offset <= committed_) {
+    return;
+  }
+  // The other slot still holds the previous offset if this write is torn.
+  Slot &slot = layout_->slots[next_slot_];
+  slot.offset = next_offset;
+  slot.checksum = Checksum(next_offset);
+  next_slot_ ^= 1U;
+  committed_ = next_offset;
+  dirty_ = true;
+
+  switch (options_.sync) {
+  case CheckpointSync::kNever:
+    break;
+  case CheckpointSync::kInterval:
+    if (std::chrono::steady_clock::now() - last_sync_ >= options_.sync_interval) {
+      Sync();
+    }
+    break;
+  case CheckpointSync::kEveryCommit:
+    Sync();
+    break;
+  }
+}
+
+void OffsetCheckpoint::Sync() {
+#ifdef _WIN32
+  FlushViewOfFile(layout_, sizeof(Layout));
+  FlushFileBuffers(file_);
+#else
+  ::msync(layout_, sizeof(Layout), MS_SYNC);
+#endif
+  dirty_ = false;
+  last_sync_ = std::chrono::steady_clock::now();
+}
+
+} // namespace vertel::runtime
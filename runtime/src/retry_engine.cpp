@@ -0,0 +1,197 @@
+#include "vertel/runtime/retry_engine.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <utility>
+
+namespace vertel::runtime {
+
+RetryEngine::RetryEngine(RetryEngineOptions options, MetricsRegistry *metrics)
+    : options_(options), metrics_(metrics), budget_(options.retry_budget_burst),
+      random_(std::random_device{}()) {
+  timer_thread_ = std::thread(&RetryEngine::RunTimers, this);
+}
+
+RetryEngine::~RetryEngine() {
+  {
+    std::scoped_lock lock(mutex_);
+    stopping_ = true;
+  }
+  timer_cv_.notify_all();
+  timer_thread_.join();
+
+  std::vector<std::shared_ptr<Job>> abandoned;
+  {
+    std::scoped_lock lock(mutex_);
+    while (!timers_.empty()) {
+      abandoned.push_back(timers_.top().job);
+      timers_.pop();
+    }
+  }
+  const RetryOutcome stopped{.ok = false, .error = "retry engine stopped"};
+  for (const auto &job : abandoned) {
+    if (job->done) {
+      job->done(stopped, job->attempts);
+    }
+  }
+}
+
+void RetryEngine::Execute(std::string endpoint, Operation operation, Completion done) {
+  Step(std::make_shared<Job>(Job{.endpoint = std::move(endpoint),
+                                 .operation = std::move(operation),
+                                 .done = std::move(done)}));
+}
+
+RetryEngine::Circuit &RetryEngine::CircuitFor(std::string_view endpoint) {
+  if (const auto it = circuits_.find(endpoint); it != circuits_.end()) {
+    return it->second;
+  }
+  return circuits_.emplace(std::string(endpoint), Circuit{}).first->second;
+}
+
+RetryEngine::Clock::duration RetryEngine::Admit(std::string_view endpoint) {
+  std::scoped_lock lock(mutex_);
+  Circuit &circuit = CircuitFor(endpoint);
+  if (circuit.open_until == Clock::time_point{}) {
+    return Clock::duration::zero();
+  }
+  const auto now = Clock::now();
+  if (now < circuit.open_until) {
+    return circuit.open_until - now;
+  }
+  // Half-open: one probe decides whether the circuit closes again.
+  if (circuit.probing) {
+    return std::max<Clock::duration>(options_.initial_backoff, std::chrono::milliseconds(1));
+  }
+  circuit.probing = true;
+  return Clock::duration::zero();
+}
+
+RetryDecision RetryEngine::Record(std::string_view endpoint, int attempt,
+                                  const RetryOutcome &outcome) {
+  std::scoped_lock lock(mutex_);
+  if (attempt <= 1) {
+    budget_ = std::min(options_.retry_budget_burst, budget_ + options_.retry_budget_ratio);
+  }
+
+  Circuit &circuit = CircuitFor(endpoint);
+  const auto now = Clock::now();
+  if (outcome.ok || !outcome.retryable) {
+    // Any answer that is not a transient failure shows the endpoint is up.
+    circuit = Circuit{};
+  } else if (circuit.probing ||
+             ++circuit.consecutive_failures >= options_.circuit_failure_threshold) {
+    circuit.open_until =
+        now + std::max<Clock::duration>(options_.circuit_open_duration, outcome.retry_after);
+    circuit.probing = false;
+    if (metrics_ != nullptr) {
+      metrics_->IncrementCircuitOpened();
+    }
+  }
+
+  if (outcome.ok || !outcome.retryable || attempt >= options_.max_attempts) {
+    return {};
+  }
+  if (budget_ < 1.0) {
+    if (metrics_ != nullptr) {
+      metrics_->IncrementRetryBudgetExhausted();
+    }
+    return {};
+  }
+  budget_ -= 1.0;
+
+  auto delay = Backoff(attempt, outcome.retry_after);
+  if (circuit.open_until > now) {
+    delay = std::max(delay, std::chrono::ceil<std::chrono::milliseconds>(circuit.open_until - now));
+  }
+  if (metrics_ != nullptr) {
+    metrics_->IncrementRetries();
+  }
+  return RetryDecision{.retry = true, .delay = delay};
+}
+
+std::chrono::milliseconds RetryEngine::Backoff(int attempt, std::chrono::milliseconds retry_after) {
+  using std::chrono::milliseconds;
+  if (retry_after > milliseconds::zero()) {
+    std::uniform_int_distribution<milliseconds::rep> jitter(0, options_.initial_backoff.count());
+    return retry_after + milliseconds(jitter(random_));
+  }
+  auto step = options_.initial_backoff;
+  for (int i = 1; i < attempt && step < options_.max_backoff; ++i) {
+    step *= 2;
+  }
+  step = std::min(step, options_.max_backoff);
+  const auto half = step / 2;
+  std::uniform_int_distribution<milliseconds::rep> jitter(0, (step - half).count());
+  return half + milliseconds(jitter(random_));
+}
+
+std::size_t RetryEngine::PendingRetries() const {
+  std::scoped_lock lock(mutex_);
+  return timers_.size();
+}
+
+void RetryEngine::Step(std::shared_ptr<Job> job) {
+  for (;;) {
+    if (Admit(job->endpoint) > Clock::duration::zero()) {
+      const RetryOutcome open{.ok = false, .error = "circuit open for " + job->endpoint};
+      if (job->done) {
+        job->done(open, job->attempts);
+      }
+      return;
+    }
+
+    RetryOutcome outcome;
+    try {
+      outcome = job->operation();
+    } catch (const std::exception &ex) {
+      outcome = RetryOutcome{.ok = false, .error = ex.what()};
+    }
+    ++job->attempts;
+    const RetryDecision decision = Record(job->endpoint, job->attempts, outcome);
+    if (!decision.retry) {
+      if (job->done) {
+        job->done(outcome, job->attempts);
+      }
+      return;
+    }
+    if (decision.delay <= std::chrono::milliseconds::zero()) {
+      continue;
+    }
+
+    {
+      std::scoped_lock lock(mutex_);
+      if (!stopping_) {
+        timers_.push(
+            Timer{.at = Clock::now() + decision.delay, .sequence = ++sequence_, .job = job});
+        timer_cv_.notify_one();
+        return;
+      }
+    }
+    if (job->done) {
+      job->done(RetryOutcome{.ok = false, .error = "retry engine stopped"}, job->attempts);
+    }
+    return;
+  }
+}
+
+void RetryEngine::RunTimers() {
+  std::unique_lock lock(mutex_);
+  while (!stopping_) {
+    if (timers_.empty()) {
+      timer_cv_.wait(lock);
+      continue;
+    }
+    if (const auto at = timers_.top().at; Clock::now() < at) {
+      timer_cv_.wait_until(lock, at);
+      continue;
+    }
+    auto job = timers_.top().job;
+    timers_.pop();
+    lock.unlock();
+    Step(std::move(job));
+    lock.lock();
+  }
+}
+
+} // namespace vertel::runtime
@@ -0,0 +1,106 @@
+#include "vertel/runtime/worker_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+
+namespace vertel::runtime {
+namespace {
+
+// Spreads sequential ids (chat ids, tenant ids) evenly across workers.
+std::uint64_t MixKey(std::uint64_t key) {
+  key ^= key >> 33;
+  key *= 0xff51afd7ed558ccdULL;
+  key ^= key >> 33;
+  return key;
+}
+
+} // namespace
+
+ShardedWorkerPool::ShardedWorkerPool(std::size_t workers, MetricsRegistry *metrics)
+    : metrics_(metrics) {
+  workers = std::max<std::size_t>(1, workers);
+  workers_.reserve(workers);
+  for (std::size_t i = 0; i < workers; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (std::size_t i = 0; i < workers; ++i) {
+    workers_[i]->thread = std::thread(&ShardedWorkerPool::Run, this, i);
+  }
+}
+
+ShardedWorkerPool::~ShardedWorkerPool() {
+  for (auto &worker : workers_) {
+    {
+      std::scoped_lock lock(worker->mutex);
+      worker->stopping = true;
+    }
+    worker->cv.notify_one();
+  }
+  for (auto &worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+void ShardedWorkerPool::Submit(std::uint64_t shard_key, std::function<void()> task) {
+  {
+    std::scoped_lock lock(idle_mutex_);
+    ++pending_;
+  }
+  if (metrics_ != nullptr) {
+    metrics_->AddDispatchQueueDepth(1);
+  }
+
+  Worker &worker = *workers_[MixKey(shard_key) % workers_.size()];
+  {
+    std::scoped_lock lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+  }
+  worker.cv.notify_one();
+}
+
+void ShardedWorkerPool::WaitIdle() {
+  std::unique_lock lock(idle_mutex_);
+  idle_cv_.wait(lock, [this] { return pending_ == 0; });
+}
+
+void ShardedWorkerPool::Run(std::size_t index) {
+  Worker &worker = *workers_[index];
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(worker.mutex);
+      worker.cv.wait(lock, [&worker] { return worker.stopping || !worker.tasks.empty(); });
+      if (worker.tasks.empty()) {
+        return;
+      }
+      task = std::move(worker.tasks.front());
+      worker.tasks.pop_front();
+    }
+    if (metrics_ != nullptr) {
+      metrics_->AddDispatchQueueDepth(-1);
+    }
+
+    const auto started = std::chrono::steady_clock::now();
+    try {
+      task();
+    } catch (...) {
+      // Tasks report their own failures; a stray exception must not kill the worker.
+    }
+    if (metrics_ != nullptr) {
+      metrics_->AddWorkerBusyTime(index, std::chrono::steady_clock::now() - started);
+    }
+    TaskFinished();
+  }
+}
+
+void ShardedWorkerPool::TaskFinished() {
+  std::scoped_lock lock(idle_mutex_);
+  if (--pending_ == 0) {
+    idle_cv_.notify_all();
+  }
+}
+
+} // namespace vertel::runtime
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+
+#include "vertel/runtime/histogram.hpp"
+#include "vertel/runtime/http_server.hpp"
+
+namespace vertel::testing {
+
+// Local stand-in for the Bot API, for load tests and integration tests of the
+// real HTTP path: point TelegramClient::SetApiBase() at base_url().
+//
+// Updates queued with Enqueue() are served by getUpdates with Telegram's
+// offset/limit/timeout semantics; sendMessage is acknowledged and matched to
+// the oldest unanswered update of its chat, which times the reply. Updates
+// queued for a token form that bot's own mailbox; the rest go to a shared
+// one, served to any token without a mailbox of its own. Every
+// response can be delayed, and a share of sendMessage calls can be refused
+// with 429 and retry_after, and a revoked token gets 401 for everything.
+// Otherwise getMe, setWebhook and deleteWebhook succeed.
+//
+// Every connection gets its own thread, unlike runtime::HttpServer, so a
+// getUpdates long poll never holds up the sendMessage calls that land next to
+// it. Not available on Windows, where Start() returns false.
+class MockBotApi {
+public:
+  struct Options {
+    int port{0}; // 0 picks an ephemeral port
+    // Added to every response.
+    std::chrono::microseconds latency{0};
+    // Share of sendMessage calls answered with 429, in [0, 1].
+    double throttle_ratio{0.0};
+    std::chrono::seconds retry_after{1};
+    // Requests with this token are answered with 401, as for a revoked token.
+    std::string revoked_token{};
+    // Unanswered updates older than this are counted as lost.
+    std::chrono::milliseconds reply_timeout{10000};
+    std::uint64_t seed{0x5eed};
+  };
+
+  struct Stats {
+    std::uint64_t updates_queued{0};
+    // Updates served by getUpdates at least once.
+    std::uint64_t updates_delivered{0};
+    std::uint64_t get_updates_calls{0};
+    // sendMessage calls matched to an update, and those refused with 429.
+    std::uint64_t replies{0};
+    std::uint64_t throttled{0};
+    // sendMessage calls to a chat with no unanswered update.
+    std::uint64_t unmatched_replies{0};
+    std::uint64_t lost{0};
+    // Updates Telegram would still hold: queued and not yet confirmed.
+    std::size_t backlog{0};
+    // From Enqueue() to the matching sendMessage, in nanoseconds.
+    runtime::HistogramSnapshot reply_latency;
+  };
+
+  explicit MockBotApi(Options options);
+  ~MockBotApi();
+
+  MockBotApi(const MockBotApi &) = delete;
+  MockBotApi &operator=(const MockBotApi &) = delete;
+
+  bool Start();
+  // Releases waiting getUpdates calls and closes every connection.
+  void Stop();
+  int port() const { return port_; }
+  // "http://127.0.0.1:<port>"
+  std::string base_url() const;
+
+  // Queues a text message from `chat_id` for the bot with `token`, or for the
+  // shared mailbox, and returns its update_id. Safe from any thread.
+  std::int64_t Enqueue(std::int64_t chat_id, std::string text, std::string token = {});
+
+  // Counts unanswered updates older than reply_timeout as lost first.
+  Stats Snapshot();
+
+private:
+  struct QueuedUpdate {
+    std::int64_t update_id;
+    std::int64_t chat_id;
+    std::string text;
+    std::int64_t date; // unix seconds
+  };
+
+  struct Mailbox {
+    // Unconfirmed updates in id order; the front is dropped once a getUpdates
+    // offset passes it.
+    std::deque<QueuedUpdate> queue;
+    std::int64_t delivered_up_to{0};
+    // Enqueue times of the unanswered updates of each chat, oldest first.
+    std::unordered_map<std::int64_t, std::deque<std::chrono::steady_clock::time_point>> unanswered;
+  };
+
+  struct Connection {
+    int fd;
+    std::thread thread;
+    bool finished{false};
+  };
+
+  void AcceptLoop();
+  void Serve(Connection &connection);
+  // Joins and closes finished connections, or all of them with `all`.
+  void ReapConnections(bool all);
+  void HandleRequest(const runtime::HttpRequest &request, runtime::HttpResponse &response);
+  void GetUpdates(std::string_view token, std::string_view params,
+                  runtime::HttpResponse &response);
+  void SendMessage(std::string_view token, std::string_view params,
+                   runtime::HttpResponse &response);
+  // The mailbox `token` is served from.
+  Mailbox &MailboxLocked(std::string_view token);
+  void ExpireLocked(std::chrono::steady_clock::time_point now);
+
+  Options options_;
+  std::mutex mutex_;
+  std::condition_variable updates_cv_;
+  bool stopping_{false};
+  std::int64_t next_update_id_{1};
+  // By token; "" is the shared mailbox. Update ids are unique across them.
+  std::unordered_map<std::string, Mailbox> mailboxes_;
+  std::uint64_t next_message_id_{1};
+  std::mt19937_64 random_;
+  Stats stats_;
+  runtime::LatencyHistogram reply_latency_;
+
+  int listen_fd_{-1};
+  int port_{0};
+  std::thread accept_thread_;
+  std::mutex connections_mutex_;
+  std::list<Connection> connections_;
+};
+
+} // namespace vertel::testing
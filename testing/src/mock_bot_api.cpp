@@ -0,0 +1,543 @@
+#include "vertel/testing/mock_bot_api.hpp"
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <charconv>
+#include <optional>
+#include <utility>
+
+namespace vertel::testing {
+namespace {
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  return -1;
+}
+
+// Value of `key` in an application/x-www-form-urlencoded string.
+std::optional<std::string> FormValue(std::string_view params, std::string_view key) {
+  while (!params.empty()) {
+    const auto end = params.find('&');
+    const std::string_view pair = params.substr(0, end);
+    params = end == std::string_view::npos ? std::string_view{} : params.substr(end + 1);
+    const auto equals = pair.find('=');
+    if (pair.substr(0, equals) != key) {
+      continue;
+    }
+    const std::string_view raw =
+        equals == std::string_view::npos ? std::string_view{} : pair.substr(equals + 1);
+    std::string value;
+    value.reserve(raw.size());
+    for (std::size_t i = 0; i < raw.size(); ++i) {
+      if (raw[i] == '+') {
+        value.push_back(' ');
+      } else if (raw[i] == '%' && i + 2 < raw.size() && HexValue(raw[i + 1]) >= 0 &&
+                 HexValue(raw[i + 2]) >= 0) {
+        value.push_back(static_cast<char>(HexValue(raw[i + 1]) * 16 + HexValue(raw[i + 2])));
+        i += 2;
+      } else {
+        value.push_back(raw[i]);
+      }
+    }
+    return value;
+  }
+  return std::nullopt;
+}
+
+std::int64_t IntParam(std::string_view params, std::string_view key, std::int64_t fallback) {
+  const auto value = FormValue(params, key);
+  std::int64_t parsed = fallback;
+  if (value.has_value()) {
+    std::from_chars(value->data(), value->data() + value->size(), parsed);
+  }
+  return parsed;
+}
+
+void AppendJsonString(std::string &out, std::string_view in) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  out.push_back('"');
+  for (const char c : in) {
+    const auto byte = static_cast<unsigned char>(c);
+    if (c == '"' || c == '\\') {
+      out.push_back('\\');
+      out.push_back(c);
+    } else if (byte < 0x20) {
+      out.append("\\u00");
+      out.push_back(kHex[byte >> 4]);
+      out.push_back(kHex[byte & 0xf]);
+    } else {
+      out.push_back(c);
+    }
+  }
+  out.push_back('"');
+}
+
+runtime::HttpResponse JsonResponse(int status_code, std::string body) {
+  return runtime::HttpResponse{
+      .status_code = status_code, .content_type = "application/json", .body = std::move(body)};
+}
+
+runtime::HttpResponse ApiError(int status_code, std::string_view description) {
+  std::string body = "{\"ok\":false,\"error_code\":" + std::to_string(status_code) +
+                     ",\"description\":";
+  AppendJsonString(body, description);
+  body.push_back('}');
+  return JsonResponse(status_code, std::move(body));
+}
+
+bool EqualsIgnoreCase(std::string_view a, std::string_view b) {
+  return std::equal(a.begin(), a.end(), b.begin(), b.end(), [](unsigned char x, unsigned char y) {
+    return std::tolower(x) == std::tolower(y);
+  });
+}
+
+std::string_view Trim(std::string_view value) {
+  while (!value.empty() && (value.front() == ' ' || value.front() == '\t')) {
+    value.remove_prefix(1);
+  }
+  while (!value.empty() && (value.back() == ' ' || value.back() == '\t')) {
+    value.remove_suffix(1);
+  }
+  return value;
+}
+
+std::string_view StatusText(int status_code) {
+  switch (status_code) {
+  case 200:
+    return "OK";
+  case 400:
+    return "Bad Request";
+  case 401:
+    return "Unauthorized";
+  case 404:
+    return "Not Found";
+  case 429:
+    return "Too Many Requests";
+  default:
+    return "Unknown";
+  }
+}
+
+std::int64_t UnixNow() {
+  return std::chrono::duration_cast<std::chrono::seconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+MockBotApi::MockBotApi(Options options) : options_(options), random_(options.seed) {}
+
+MockBotApi::~MockBotApi() { Stop(); }
+
+#ifdef _WIN32
+
+bool MockBotApi::Start() { return false; }
+
+void MockBotApi::Stop() {}
+
+#else
+
+bool MockBotApi::Start() {
+  if (listen_fd_ >= 0) {
+    return true;
+  }
+  const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0) {
+    return false;
+  }
+  const int enable = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = htons(static_cast<std::uint16_t>(options_.port));
+  socklen_t length = sizeof(address);
+  if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 ||
+      listen(fd, SOMAXCONN) != 0 ||
+      getsockname(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0) {
+    close(fd);
+    return false;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = false;
+  }
+  listen_fd_ = fd;
+  port_ = ntohs(address.sin_port);
+  accept_thread_ = std::thread([this] { AcceptLoop(); });
+  return true;
+}
+
+void MockBotApi::Stop() {
+  if (listen_fd_ < 0) {
+    return;
+  }
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  updates_cv_.notify_all();
+  // Unblocks accept() and every connection's recv().
+  shutdown(listen_fd_, SHUT_RDWR);
+  accept_thread_.join();
+  close(listen_fd_);
+  listen_fd_ = -1;
+  {
+    std::lock_guard lock(connections_mutex_);
+    for (auto &connection : connections_) {
+      shutdown(connection.fd, SHUT_RDWR);
+    }
+  }
+  ReapConnections(true);
+}
+
+void MockBotApi::AcceptLoop() {
+  for (;;) {
+    const int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) {
+      if (errno == EINTR || errno == ECONNABORTED) {
+        continue;
+      }
+      return;
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    ReapConnections(false);
+    std::lock_guard lock(connections_mutex_);
+    auto &connection =
+        connections_.emplace_back(Connection{.fd = fd, .thread = {}, .finished = false});
+    connection.thread = std::thread([this, &connection] { Serve(connection); });
+  }
+}
+
+void MockBotApi::ReapConnections(bool all) {
+  std::list<Connection> done;
+  {
+    std::lock_guard lock(connections_mutex_);
+    for (auto it = connections_.begin(); it != connections_.end();) {
+      const auto next = std::next(it);
+      if (all || it->finished) {
+        done.splice(done.end(), connections_, it);
+      }
+      it = next;
+    }
+  }
+  for (auto &connection : done) {
+    connection.thread.join();
+    close(connection.fd);
+  }
+}
+
+void MockBotApi::Serve(Connection &connection) {
+  constexpr std::size_t kMaxRequestBytes = 1 << 20;
+  std::string buffer;
+  char chunk[16384];
+  bool open = true;
+  while (open) {
+    // Head first, then the Content-Length body.
+    std::size_t head_end;
+    while ((head_end = buffer.find("\r\n\r\n")) == std::string::npos) {
+      const ssize_t received = recv(connection.fd, chunk, sizeof(chunk), 0);
+      if (received <= 0 || buffer.size() > kMaxRequestBytes) {
+        open = false;
+        break;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(received));
+    }
+    if (!open) {
+      break;
+    }
+
+    // Copied out, as reading the body may move `buffer`.
+    const std::string head(buffer, 0, head_end);
+    runtime::HttpRequest request;
+    const auto line_end = head.find("\r\n");
+    const std::string_view line = std::string_view(head).substr(0, line_end);
+    const auto first_space = line.find(' ');
+    const auto second_space = line.find(' ', first_space + 1);
+    if (first_space == std::string_view::npos || second_space == std::string_view::npos) {
+      break;
+    }
+    request.method = line.substr(0, first_space);
+    request.path = line.substr(first_space + 1, second_space - first_space - 1);
+    bool keep_alive = line.substr(second_space + 1) != "HTTP/1.0";
+    std::size_t content_length = 0;
+    bool expect_continue = false;
+    std::string_view rest = line_end == std::string::npos
+                                ? std::string_view{}
+                                : std::string_view(head).substr(line_end + 2);
+    while (!rest.empty()) {
+      const auto end = rest.find("\r\n");
+      const std::string_view header = rest.substr(0, end);
+      rest = end == std::string_view::npos ? std::string_view{} : rest.substr(end + 2);
+      const auto colon = header.find(':');
+      if (colon == std::string_view::npos) {
+        continue;
+      }
+      const std::string_view name = Trim(header.substr(0, colon));
+      const std::string_view value = Trim(header.substr(colon + 1));
+      request.headers.emplace_back(name, value);
+      if (EqualsIgnoreCase(name, "Content-Length")) {
+        std::from_chars(value.data(), value.data() + value.size(), content_length);
+      } else if (EqualsIgnoreCase(name, "Connection")) {
+        keep_alive = !EqualsIgnoreCase(value, "close");
+      } else if (EqualsIgnoreCase(name, "Expect")) {
+        expect_continue = EqualsIgnoreCase(value, "100-continue");
+      }
+    }
+    if (content_length > kMaxRequestBytes) {
+      break;
+    }
+
+    const std::size_t body_start = head_end + 4;
+    if (expect_continue && buffer.size() < body_start + content_length) {
+      constexpr std::string_view kContinue = "HTTP/1.1 100 Continue\r\n\r\n";
+      send(connection.fd, kContinue.data(), kContinue.size(), MSG_NOSIGNAL);
+    }
+    while (buffer.size() < body_start + content_length) {
+      const ssize_t received = recv(connection.fd, chunk, sizeof(chunk), 0);
+      if (received <= 0) {
+        open = false;
+        break;
+      }
+      buffer.append(chunk, static_cast<std::size_t>(received));
+    }
+    if (!open) {
+      break;
+    }
+    request.body = std::string_view(buffer).substr(body_start, content_length);
+
+    runtime::HttpResponse response;
+    HandleRequest(request, response);
+    std::string out = "HTTP/1.1 " + std::to_string(response.status_code) + " ";
+    out.append(StatusText(response.status_code));
+    out.append("\r\nContent-Type: " + response.content_type);
+    out.append("\r\nContent-Length: " + std::to_string(response.body.size()));
+    out.append(keep_alive ? "\r\nConnection: keep-alive\r\n\r\n"
+                          : "\r\nConnection: close\r\n\r\n");
+    out.append(response.body);
+    for (std::size_t sent = 0; sent < out.size();) {
+      const ssize_t written =
+          send(connection.fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+      if (written <= 0) {
+        open = false;
+        break;
+      }
+      sent += static_cast<std::size_t>(written);
+    }
+    buffer.erase(0, body_start + content_length);
+    open = open && keep_alive;
+  }
+  std::lock_guard lock(connections_mutex_);
+  connection.finished = true;
+}
+
+#endif
+
+std::string MockBotApi::base_url() const {
+  return "http://127.0.0.1:" + std::to_string(port());
+}
+
+std::int64_t MockBotApi::Enqueue(std::int64_t chat_id, std::string text, std::string token) {
+  std::int64_t update_id = 0;
+  {
+    std::lock_guard lock(mutex_);
+    update_id = next_update_id_++;
+    Mailbox &mailbox = mailboxes_[std::move(token)];
+    mailbox.queue.push_back(QueuedUpdate{
+        .update_id = update_id, .chat_id = chat_id, .text = std::move(text), .date = UnixNow()});
+    mailbox.unanswered[chat_id].push_back(std::chrono::steady_clock::now());
+    ++stats_.updates_queued;
+  }
+  updates_cv_.notify_all();
+  return update_id;
+}
+
+MockBotApi::Stats MockBotApi::Snapshot() {
+  std::lock_guard lock(mutex_);
+  ExpireLocked(std::chrono::steady_clock::now());
+  Stats stats = stats_;
+  for (const auto &[token, mailbox] : mailboxes_) {
+    stats.backlog += mailbox.queue.size();
+  }
+  stats.reply_latency = reply_latency_.Snapshot();
+  return stats;
+}
+
+MockBotApi::Mailbox &MockBotApi::MailboxLocked(std::string_view token) {
+  if (const auto it = mailboxes_.find(std::string(token)); it != mailboxes_.end()) {
+    return it->second;
+  }
+  return mailboxes_[std::string()];
+}
+
+void MockBotApi::ExpireLocked(std::chrono::steady_clock::time_point now) {
+  for (auto &[token, mailbox] : mailboxes_) {
+    auto &unanswered = mailbox.unanswered;
+    for (auto it = unanswered.begin(); it != unanswered.end();) {
+      auto &pending = it->second;
+      while (!pending.empty() && now - pending.front() > options_.reply_timeout) {
+        pending.pop_front();
+        ++stats_.lost;
+      }
+      it = pending.empty() ? unanswered.erase(it) : std::next(it);
+    }
+  }
+}
+
+void MockBotApi::HandleRequest(const runtime::HttpRequest &request,
+                               runtime::HttpResponse &response) {
+  // "/bot<token>/<method>", with the parameters in the body or the query.
+  std::string_view path = request.path;
+  std::string_view query;
+  if (const auto question = path.find('?'); question != std::string_view::npos) {
+    query = path.substr(question + 1);
+    path = path.substr(0, question);
+  }
+  const auto slash = path.rfind('/');
+  if (path.substr(0, 4) != "/bot" || slash == std::string_view::npos || slash < 4) {
+    response = ApiError(404, "Not Found");
+    return;
+  }
+  const std::string_view token = path.substr(4, slash - 4);
+  const std::string_view method = path.substr(slash + 1);
+  const std::string_view params = request.body.empty() ? query : request.body;
+
+  if (!options_.revoked_token.empty() && token == options_.revoked_token) {
+    if (method == "getUpdates") {
+      std::lock_guard lock(mutex_);
+      ++stats_.get_updates_calls;
+    }
+    response = ApiError(401, "Unauthorized");
+  } else if (method == "getUpdates") {
+    GetUpdates(token, params, response);
+  } else if (method == "sendMessage") {
+    SendMessage(token, params, response);
+  } else if (method == "getMe") {
+    response = JsonResponse(200, R"({"ok":true,"result":{"id":1,"is_bot":true,"first_name":"Mock",)"
+                                 R"("username":"mock_bot"}})");
+  } else if (method == "setWebhook" || method == "deleteWebhook") {
+    response = JsonResponse(200, R"({"ok":true,"result":true})");
+  } else {
+    response = ApiError(404, "Not Found: method not found");
+  }
+
+  if (options_.latency > std::chrono::microseconds::zero()) {
+    std::this_thread::sleep_for(options_.latency);
+  }
+}
+
+void MockBotApi::GetUpdates(std::string_view token, std::string_view params,
+                            runtime::HttpResponse &response) {
+  const std::int64_t offset = IntParam(params, "offset", 0);
+  const auto limit = static_cast<std::size_t>(std::clamp<std::int64_t>(
+      IntParam(params, "limit", 100), 1, 100));
+  const std::chrono::seconds timeout(std::clamp<std::int64_t>(IntParam(params, "timeout", 0), 0,
+                                                              50));
+
+  std::string body = R"({"ok":true,"result":[)";
+  std::unique_lock lock(mutex_);
+  ++stats_.get_updates_calls;
+  Mailbox *mailbox = &MailboxLocked(token);
+  // An offset confirms every update below it.
+  auto &queue = mailbox->queue;
+  while (!queue.empty() && queue.front().update_id < offset) {
+    queue.pop_front();
+  }
+  updates_cv_.wait_for(lock, timeout, [&] {
+    // An Enqueue() may have opened the token's own mailbox meanwhile.
+    mailbox = &MailboxLocked(token);
+    return stopping_ || !mailbox->queue.empty();
+  });
+
+  const std::size_t count = std::min(limit, mailbox->queue.size());
+  for (std::size_t i = 0; i < count; ++i) {
+    const QueuedUpdate &update = mailbox->queue[i];
+    if (update.update_id > mailbox->delivered_up_to) {
+      mailbox->delivered_up_to = update.update_id;
+      ++stats_.updates_delivered;
+    }
+    const std::string chat = std::to_string(update.chat_id);
+    body += i == 0 ? "" : ",";
+    body += "{\"update_id\":" + std::to_string(update.update_id) +
+            ",\"message\":{\"message_id\":" + std::to_string(update.update_id) +
+            ",\"from\":{\"id\":" + chat + R"(,"is_bot":false,"first_name":"Load"},"chat":{"id":)" +
+            chat + R"(,"type":"private"},"date":)" + std::to_string(update.date) + ",\"text\":";
+    AppendJsonString(body, update.text);
+    body += "}}";
+  }
+  lock.unlock();
+  body += "]}";
+  response = JsonResponse(200, std::move(body));
+}
+
+void MockBotApi::SendMessage(std::string_view token, std::string_view params,
+                             runtime::HttpResponse &response) {
+  const auto chat = FormValue(params, "chat_id");
+  std::int64_t chat_id = 0;
+  if (!chat.has_value() ||
+      std::from_chars(chat->data(), chat->data() + chat->size(), chat_id).ec != std::errc{}) {
+    response = ApiError(400, "Bad Request: chat_id is empty");
+    return;
+  }
+
+  const auto now = std::chrono::steady_clock::now();
+  std::uint64_t message_id = 0;
+  bool throttled = false;
+  {
+    std::lock_guard lock(mutex_);
+    throttled = options_.throttle_ratio > 0 &&
+                std::uniform_real_distribution<double>(0.0, 1.0)(random_) <
+                    options_.throttle_ratio;
+    auto &unanswered = MailboxLocked(token).unanswered;
+    const auto it = unanswered.find(chat_id);
+    if (it == unanswered.end()) {
+      ++(throttled ? stats_.throttled : stats_.unmatched_replies);
+    } else {
+      // A refused reply still settles its update: vertel does not resend it.
+      if (throttled) {
+        ++stats_.throttled;
+      } else {
+        reply_latency_.Record(now - it->second.front());
+        ++stats_.replies;
+      }
+      it->second.pop_front();
+      if (it->second.empty()) {
+        unanswered.erase(it);
+      }
+    }
+    message_id = next_message_id_++;
+  }
+
+  if (throttled) {
+    const auto seconds = std::to_string(options_.retry_after.count());
+    response = ApiError(429, "Too Many Requests: retry after " + seconds);
+    response.body.insert(response.body.size() - 1, ",\"parameters\":{\"retry_after\":" + seconds +
+                                                        "}");
+    return;
+  }
+  response = JsonResponse(200, "{\"ok\":true,\"result\":{\"message_id\":" +
+                                   std::to_string(message_id) + ",\"chat\":{\"id\":" +
+                                   std::to_string(chat_id) + ",\"type\":\"private\"},\"date\":" +
+                                   std::to_string(UnixNow()) + "}}");
+}
+
+} // namespace vertel::testing
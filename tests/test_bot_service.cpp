@@ -1,14 +1,55 @@
+#if VERTEL_HAS_LIBCURL
+#include <curl/curl.h>
+#endif
+
+#ifdef __linux__
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <future>
+#include <limits>
+#include <mutex>
 #include <optional>
+#include <span>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
 #include <unordered_set>
 #include <utility>
 #include <vector>
 
+#include "vertel/adapters/shard/shard_front.hpp"
+#include "vertel/adapters/shard/shard_protocol.hpp"
+#include "vertel/adapters/shard/shard_worker_gateway.hpp"
+#include "vertel/adapters/telegram/async_sender.hpp"
+#include "vertel/adapters/telegram/multi_bot_host.hpp"
 #include "vertel/adapters/telegram/telegram_client.hpp"
+#include "vertel/adapters/telegram/update_decoder.hpp"
+#include "vertel/adapters/telegram/webhook_gateway.hpp"
 #include "vertel/core/bot_service.hpp"
+#include "vertel/core/outbound_scheduler.hpp"
+#include "vertel/core/static_command_router.hpp"
+#include "vertel/runtime/executor.hpp"
+#include "vertel/runtime/health_server.hpp"
+#include "vertel/runtime/logger.hpp"
 #include "vertel/runtime/metrics.hpp"
+#include "vertel/runtime/offset_checkpoint.hpp"
+#include "vertel/runtime/retry_engine.hpp"
+#include "vertel/testing/mock_bot_api.hpp"
 
 namespace {
 
@@ -16,21 +57,21 @@ class FakeGateway final : public vertel::core::TelegramGateway {
 public:
   explicit FakeGateway(std::vector<vertel::core::Update> updates) : updates_(std::move(updates)) {}
 
-  std::vector<vertel::core::Update> PollUpdates() override {
-    auto out = updates_;
-    updates_.clear();
-    return out;
-  }
+  std::vector<vertel::core::Update> PollUpdates() override { return std::exchange(updates_, {}); }
 
   void SendMessage(const vertel::core::OutgoingMessage &message) override {
     sent_.push_back(message);
   }
 
+  void CommitUpdates(std::int64_t next_offset) override { committed_ = next_offset; }
+
   const std::vector<vertel::core::OutgoingMessage> &Sent() const { return sent_; }
+  std::int64_t Committed() const { return committed_; }
 
 private:
   std::vector<vertel::core::Update> updates_;
   std::vector<vertel::core::OutgoingMessage> sent_;
+  std::int64_t committed_{0};
 };
 
 class ThrowingHandler final : public vertel::core::CommandHandler {
@@ -151,6 +192,1675 @@ void TestHandlerFailuresAreCountedAndProcessingContinues() {
   assert(snapshot.messages_sent == 1);
 }
 
+void TestConnectionPoolReusesIdleHandles() {
+#if VERTEL_HAS_LIBCURL
+  vertel::adapters::telegram::HttpConnectionPool pool(
+      vertel::adapters::telegram::HttpConnectionPool::Options{.max_idle_handles = 1});
+  {
+    auto first = pool.Acquire();
+    auto second = pool.Acquire();
+    assert(first && second);
+    assert(first.handle() != second.handle());
+  }
+  // Only one handle fits in the idle list; the other one was cleaned up.
+  assert(pool.IdleHandles() == 1);
+
+  auto reused = pool.Acquire();
+  assert(reused);
+  assert(pool.IdleHandles() == 0);
+#endif
+}
+
+void TestAsyncSenderReportsEveryCompletion() {
+#if VERTEL_HAS_LIBCURL
+  vertel::adapters::telegram::AsyncSender sender(
+      nullptr, vertel::adapters::telegram::AsyncSender::Options{.max_in_flight = 2});
+  std::atomic<int> failures{0};
+  for (int i = 0; i < 5; ++i) {
+    // Nothing listens on port 1, so every transfer fails fast.
+    sender.Submit("http://127.0.0.1:1/sendMessage", "chat_id=1&text=hi",
+                  [&failures](vertel::adapters::telegram::AsyncSender::Response response) {
+                    if (!response.error.empty()) {
+                      failures.fetch_add(1);
+                    }
+                  });
+  }
+  sender.Flush();
+  assert(failures.load() == 5);
+  assert(sender.Outstanding() == 0);
+#endif
+}
+
+void TestSendFailuresAreCounted() {
+  class FailingGateway final : public vertel::core::TelegramGateway {
+  public:
+    std::vector<vertel::core::Update> PollUpdates() override {
+      return {{.update_id = 1, .chat_id = 5, .text = "/ping"}};
+    }
+    void SendMessage(const vertel::core::OutgoingMessage &) override {
+      throw std::runtime_error("telegram http status 500");
+    }
+  };
+
+  FailingGateway gateway;
+  vertel::runtime::MetricsRegistry metrics;
+  vertel::core::PingCommandHandler ping_handler;
+  vertel::core::BotService bot(gateway, ping_handler, &metrics);
+
+  bot.ProcessOnce();
+
+  const auto snapshot = metrics.Snapshot();
+  assert(snapshot.messages_sent == 0);
+  assert(snapshot.send_failures == 1);
+}
+
+void TestParallelDispatchKeepsPerChatOrder() {
+  class LockedGateway final : public vertel::core::TelegramGateway {
+  public:
+    explicit LockedGateway(std::vector<vertel::core::Update> updates)
+        : updates_(std::move(updates)) {}
+    std::vector<vertel::core::Update> PollUpdates() override { return std::move(updates_); }
+    void SendMessage(const vertel::core::OutgoingMessage &message) override {
+      std::scoped_lock lock(mutex_);
+      sent_.push_back(message);
+    }
+    std::vector<vertel::core::OutgoingMessage> Sent() {
+      std::scoped_lock lock(mutex_);
+      return sent_;
+    }
+
+  private:
+    std::mutex mutex_;
+    std::vector<vertel::core::Update> updates_;
+    std::vector<vertel::core::OutgoingMessage> sent_;
+  };
+
+  class EchoHandler final : public vertel::core::CommandHandler {
+  public:
+    std::optional<vertel::core::OutgoingMessage>
+    Handle(const vertel::core::Update &update) override {
+      // Earlier updates take longer so a per-chat reordering would show up.
+      std::this_thread::sleep_for(std::chrono::microseconds(500 - update.update_id));
+      return vertel::core::OutgoingMessage{.chat_id = update.chat_id, .text = update.text};
+    }
+  };
+
+  std::vector<vertel::core::Update> updates;
+  for (std::int64_t i = 0; i < 90; ++i) {
+    updates.push_back({.update_id = i, .chat_id = i % 3, .text = std::to_string(i)});
+  }
+  LockedGateway gateway(std::move(updates));
+  EchoHandler handler;
+  vertel::runtime::MetricsRegistry metrics;
+  vertel::core::BotService bot(gateway, handler, &metrics,
+                               vertel::core::BotServiceOptions{.dispatch_workers = 4});
+
+  bot.ProcessOnce();
+
+  const auto sent = gateway.Sent();
+  assert(sent.size() == 90);
+  std::int64_t last_seen[3] = {-1, -1, -1};
+  for (const auto &message : sent) {
+    const auto id = std::stoll(message.text);
+    assert(id > last_seen[message.chat_id]);
+    last_seen[message.chat_id] = id;
+  }
+
+  const auto snapshot = metrics.Snapshot();
+  assert(snapshot.updates_processed == 90);
+  assert(snapshot.messages_sent == 90);
+  assert(snapshot.dispatch_queue_depth == 0);
+  assert(!snapshot.worker_busy_ns.empty());
+}
+
+#if VERTEL_HAS_LIBCURL && defined(__linux__)
+size_t DiscardBody(char *, size_t size, size_t nmemb, void *) { return size * nmemb; }
+
+long PostJson(CURL *curl, const std::string &url, const std::string &secret,
+              const std::string &body) {
+  const std::string secret_header = "X-Telegram-Bot-Api-Secret-Token: " + secret;
+  curl_slist *headers = curl_slist_append(nullptr, "Content-Type: application/json");
+  headers = curl_slist_append(headers, secret_header.c_str());
+  curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, body.c_str());
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, DiscardBody);
+  const CURLcode code = curl_easy_perform(curl);
+  curl_slist_free_all(headers);
+  assert(code == CURLE_OK);
+  (void)code;
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  return status;
+}
+#endif
+
+void TestWebhookGatewayQueuesPostedUpdates() {
+#if VERTEL_HAS_LIBCURL && defined(__linux__)
+  FakeGateway outbound({});
+  vertel::adapters::telegram::WebhookGateway webhook(
+      vertel::adapters::telegram::WebhookGateway::Options{
+          .port = 0, .secret_token = "s3cret", .poll_wait = std::chrono::milliseconds(10)},
+      outbound);
+  const bool started = webhook.Start();
+  assert(started);
+  (void)started;
+  const std::string url =
+      "http://127.0.0.1:" + std::to_string(webhook.port()) + "/telegram/webhook";
+
+  CURL *curl = curl_easy_init();
+  const long first = PostJson(curl, url, "s3cret",
+                              R"({"update_id":7,"message":{"chat":{"id":42},"text":"/ping"}})");
+  const long second = PostJson(curl, url, "s3cret",
+                               R"({"update_id":8,"message":{"chat":{"id":43},"text":"/ping"}})");
+  assert(first == 200 && second == 200);
+  long new_connections = -1;
+  curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &new_connections);
+  assert(new_connections == 0); // second request reused the kept-alive connection
+  const long bad_secret = PostJson(curl, url, "wrong", R"({"update_id":9})");
+  const long bad_body = PostJson(curl, url, "s3cret", "not json");
+  assert(bad_secret == 403);
+  assert(bad_body == 400);
+  (void)first;
+  (void)second;
+  (void)bad_secret;
+  (void)bad_body;
+  curl_easy_cleanup(curl);
+
+  vertel::core::PingCommandHandler ping_handler;
+  vertel::core::BotService bot(webhook, ping_handler);
+  bot.ProcessOnce();
+
+  const auto &sent = outbound.Sent();
+  assert(sent.size() == 2);
+  assert(sent[0].chat_id == 42);
+  assert(sent[1].chat_id == 43);
+  assert(webhook.QueuedUpdates() == 0);
+  webhook.Stop();
+#endif
+}
+
+void TestHealthServerServesSplitRequestsWithKeepAlive() {
+#ifdef __linux__
+  vertel::runtime::MetricsRegistry metrics;
+  metrics.IncrementUpdatesProcessed();
+  vertel::runtime::HealthServer server(metrics, 0);
+  server.Start();
+  const int port = server.port();
+  if (port <= 0) {
+    throw std::runtime_error("health server did not start");
+  }
+
+  const auto connect_client = [port] {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(static_cast<std::uint16_t>(port));
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+      throw std::runtime_error("health server connect failed");
+    }
+    return fd;
+  };
+  const auto send_all = [](int fd, std::string_view data) {
+    const ssize_t sent = send(fd, data.data(), data.size(), 0);
+    if (sent != static_cast<ssize_t>(data.size())) {
+      throw std::runtime_error("health server send failed");
+    }
+  };
+  const auto read_response = [](int fd) {
+    std::string response;
+    char buffer[4096];
+    const auto complete = [&response] {
+      const auto header_end = response.find("\r\n\r\n");
+      if (header_end == std::string::npos) {
+        return false;
+      }
+      const auto length_at = response.find("Content-Length: ") + 16;
+      return response.size() >= header_end + 4 + std::stoul(response.substr(length_at));
+    };
+    while (!complete()) {
+      const ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+      if (n <= 0) {
+        throw std::runtime_error("health server closed the connection");
+      }
+      response.append(buffer, static_cast<std::size_t>(n));
+    }
+    return response;
+  };
+
+  // Two clients at once; the first one's request arrives in pieces.
+  const int slow = connect_client();
+  const int fast = connect_client();
+  send_all(slow, "GET /heal");
+  send_all(fast, "GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+  const auto metrics_response = read_response(fast);
+  assert(metrics_response.find("vertel_updates_processed_total 1") != std::string::npos);
+  assert(metrics_response.find("Connection: keep-alive") != std::string::npos);
+
+  send_all(slow, "thz HTTP/1.1\r\nHost: x\r\n\r\n");
+  const auto health_response = read_response(slow);
+  assert(health_response.find("200 OK") != std::string::npos);
+  // Same connection again: it stayed open.
+  send_all(slow, "GET /nope HTTP/1.1\r\nHost: x\r\n\r\n");
+  const auto missing_response = read_response(slow);
+  assert(missing_response.find("404 Not Found") != std::string::npos);
+
+  close(slow);
+  close(fast);
+  server.Stop();
+#endif
+}
+
+void TestStreamDecoderHandlesArbitraryChunks() {
+  using vertel::adapters::telegram::UpdateCollector;
+  using vertel::adapters::telegram::UpdateStreamDecoder;
+
+  const std::string json =
+      R"({"ok":true,"result":[)"
+      R"({"update_id":7,"message":{"message_id":1,"chat":{"id":-100,"type":"group"},)"
+      R"("date":1700000000,"reply_to_message":{"text":"ignored","chat":{"id":5},"date":1},)"
+      R"("text":"caf\u00e9 \ud83d\ude00 \"q\"\n"}},)"
+      R"({"update_id":8,"edited_message":{"chat":{"id":1},"text":"skip"}},)"
+      R"({"update_id":9.5,"message":{"chat":{"id":1},"text":"skip"}},)"
+      R"({"update_id":10,"message":{"chat":{"id":2},"text":"/ping","entities":[1,2.5e3,null]}})"
+      R"(]})";
+
+  // Every split point must give the same result as a single feed.
+  for (std::size_t step = 1; step <= json.size(); step = step < 8 ? step + 1 : step * 2) {
+    std::vector<vertel::core::Update> updates;
+    UpdateCollector collector(updates);
+    UpdateStreamDecoder decoder(collector);
+    for (std::size_t offset = 0; offset < json.size(); offset += step) {
+      decoder.Feed(std::string_view(json).substr(offset, step));
+    }
+    decoder.Finish();
+
+    assert(updates.size() == 2);
+    assert(updates[0].update_id == 7);
+    assert(updates[0].chat_id == -100);
+    assert(updates[0].text == "caf\xC3\xA9 \xF0\x9F\x98\x80 \"q\"\n");
+    assert(updates[0].date == 1700000000);
+    assert(updates[1].update_id == 10);
+    assert(updates[1].chat_id == 2);
+    assert(updates[1].text == "/ping");
+    assert(updates[1].date == 0);
+  }
+
+  const auto expect_throw = [](std::string_view body) {
+    std::vector<vertel::core::Update> updates;
+    UpdateCollector collector(updates);
+    UpdateStreamDecoder decoder(collector);
+    try {
+      decoder.Feed(body);
+      decoder.Finish();
+    } catch (const std::runtime_error &) {
+      return;
+    }
+    assert(false);
+  };
+  expect_throw(R"({"ok":false,"result":[]})");
+  expect_throw(R"({"ok":true,"result":[{"update_id":1)");
+  expect_throw(R"({"ok":true,"result":[01]})");
+  expect_throw(R"({"ok":true,"result":["\ud83d"]})");
+  expect_throw("{\"ok\":true,\"result\":[\"a\x01\"]}");
+}
+
+void TestUpdateBatchViewsSurviveArenaGrowth() {
+  vertel::core::UpdateBatch batch;
+  const auto text_for = [](int i) {
+    return std::string(100 + i % 7, static_cast<char>('a' + i % 26));
+  };
+
+  for (int round = 0; round < 2; ++round) {
+    batch.Clear();
+    // Well past one arena block, so earlier views must survive new blocks.
+    for (int i = 0; i < 1000; ++i) {
+      batch.Add(i, -i, text_for(i));
+    }
+    batch.Add(1000, 1, "");
+    assert(batch.size() == 1001);
+    for (int i = 0; i < 1000; ++i) {
+      assert(batch[i].update_id == i);
+      assert(batch[i].chat_id == -i);
+      assert(batch[i].text == text_for(i));
+    }
+    assert(batch[1000].text.empty());
+  }
+
+  vertel::core::StartCommandHandler start;
+  vertel::core::CommandRouter router({start});
+  batch.Clear();
+  batch.Add(1, 42, "/start");
+  const auto response = router.HandleView(batch[0]);
+  assert(response.has_value());
+  assert(response->chat_id == 42);
+}
+
+class ArgsEchoHandler final : public vertel::core::CommandHandler {
+public:
+  std::optional<vertel::core::OutgoingMessage> Handle(const vertel::core::Update &) override {
+    return std::nullopt;
+  }
+
+  std::optional<vertel::core::OutgoingMessage>
+  HandleCommand(const vertel::core::UpdateView &update,
+                const vertel::core::CommandView &command) override {
+    return vertel::core::OutgoingMessage{.chat_id = update.chat_id,
+                                         .text = std::string(command.args)};
+  }
+};
+
+void TestRouterIndexesCommandsAndParsesArguments() {
+  using vertel::core::ParseCommand;
+
+  const auto command = ParseCommand("/ban@My_Bot   42 spam");
+  assert(command.has_value());
+  assert(command->name == "ban");
+  assert(command->bot_username == "My_Bot");
+  std::string_view args = command->args;
+  assert(vertel::core::NextArgument(args) == "42");
+  assert(vertel::core::NextArgument(args) == "spam");
+  assert(vertel::core::NextArgument(args).empty());
+  assert(!ParseCommand("hello /start").has_value());
+  assert(!ParseCommand("/").has_value());
+  assert(!ParseCommand("/@bot").has_value());
+
+  ArgsEchoHandler echo;
+  vertel::core::PingCommandHandler ping;
+  ThrowingHandler fallback; // answers any text with "ok"
+  vertel::core::CommandRouter router({fallback}, "my_bot");
+  std::vector<std::string> names;
+  for (int i = 0; i < 300; ++i) {
+    names.push_back("cmd" + std::to_string(i));
+  }
+  for (const auto &name : names) {
+    router.Register(name, echo);
+  }
+  router.Register("ping", ping);
+
+  const auto route = [&router](std::string_view text) {
+    return router.HandleView(vertel::core::UpdateView{.update_id = 1, .chat_id = 7, .text = text});
+  };
+  assert(route("/cmd299@MY_BOT a b")->text == "a b");
+  assert(route("/cmd0")->text.empty());
+  assert(route("/ping@my_bot")->text == "pong");
+  assert(!route("/ping@other_bot").has_value());
+  assert(route("/unknown")->text == "ok");
+  assert(route("free text")->text == "ok");
+
+  // On their own, built-ins accept arguments but not a "@bot" suffix they
+  // cannot check.
+  using vertel::core::UpdateView;
+  assert(ping.HandleView(UpdateView{.chat_id = 1, .text = "/ping now"}).has_value());
+  assert(!ping.HandleView(UpdateView{.chat_id = 1, .text = "/ping@x now"}).has_value());
+  assert(!ping.HandleView(UpdateView{.chat_id = 1, .text = "/pingx"}).has_value());
+}
+
+// The largest command set a StaticCommandRouter accepts: "c0" ... "c253".
+constexpr std::size_t kManyCommands = 254;
+constexpr auto kManyCommandStorage = [] {
+  std::array<std::array<char, 4>, kManyCommands> storage{};
+  for (std::size_t i = 0; i < kManyCommands; ++i) {
+    storage[i] = {'c', static_cast<char>('0' + i / 100 % 10), static_cast<char>('0' + i / 10 % 10),
+                  static_cast<char>('0' + i % 10)};
+  }
+  return storage;
+}();
+constexpr auto kManyCommandNames = [] {
+  std::array<std::string_view, kManyCommands> names{};
+  for (std::size_t i = 0; i < kManyCommands; ++i) {
+    names[i] = std::string_view(kManyCommandStorage[i].data(), 4);
+  }
+  return names;
+}();
+constexpr auto kManyCommandTable = vertel::core::detail::BuildPerfectHash(kManyCommandNames);
+static_assert(kManyCommandTable.found);
+static_assert([] {
+  for (std::size_t i = 0; i < kManyCommands; ++i) {
+    if (kManyCommandTable.slots[kManyCommandTable.Slot(kManyCommandNames[i])] != i) {
+      return false;
+    }
+  }
+  return true;
+}());
+static_assert(vertel::core::detail::HasUniqueNames(kManyCommandNames));
+
+void TestStaticCommandRouterDispatchesThroughPerfectHash() {
+  using vertel::core::Cmd;
+  using Router = vertel::core::StaticCommandRouter<
+      Cmd<"start", vertel::core::StartCommandHandler>,
+      Cmd<"help", vertel::core::HelpCommandHandler>, Cmd<"ping", vertel::core::PingCommandHandler>,
+      Cmd<"echo", ArgsEchoHandler &>>;
+  static_assert(Router::Find("ping") == 2);
+  static_assert(Router::Find("echo") == 3);
+  static_assert(Router::Find("pong") == 4);
+  static_assert(Router::Find("") == 4);
+
+  ArgsEchoHandler echo;
+  ThrowingHandler fallback;
+  Router router({.bot_username = "my_bot", .fallback = &fallback}, {}, {}, {}, echo);
+  assert(&router.handler<3>() == &echo);
+
+  const auto route = [&router](std::string_view text) {
+    return router.HandleView(vertel::core::UpdateView{.update_id = 1, .chat_id = 7, .text = text});
+  };
+  assert(route("/ping")->text == "pong");
+  assert(route("/echo@My_Bot hi there")->text == "hi there");
+  assert(!route("/start@other_bot").has_value());
+  assert(route("/unknown")->text == "ok");
+
+  // Plugs in anywhere a CommandHandler& is accepted.
+  FakeGateway gateway({vertel::core::Update{.update_id = 1, .chat_id = 3, .text = "/start"}});
+  vertel::core::BotService service(gateway, router);
+  service.ProcessOnce();
+  assert(gateway.Sent().size() == 1);
+  assert(gateway.Sent()[0].chat_id == 3);
+}
+
+void TestRateLimiterIsExactUnderContention() {
+  vertel::core::TokenBucketRateLimiter limiter(
+      /*capacity=*/100, /*refill_tokens=*/1, std::chrono::seconds(3600));
+  std::atomic<int> allowed{0};
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (int i = 0; i < 1000; ++i) {
+        if (limiter.Allow(-42)) {
+          allowed.fetch_add(1);
+        }
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  assert(allowed.load() == 100);
+
+  vertel::core::TokenBucketRateLimiter wide(
+      /*capacity=*/1, /*refill_tokens=*/1, std::chrono::seconds(3600));
+  for (std::int64_t chat = 0; chat < 20000; ++chat) {
+    const bool first = wide.Allow(chat);
+    assert(first);
+    (void)first;
+  }
+  for (std::int64_t chat = 0; chat < 20000; chat += 97) {
+    const bool again = wide.Allow(chat);
+    assert(!again);
+    (void)again;
+  }
+  assert(wide.TrackedChats() == 20000);
+}
+
+void TestRateLimiterEvictsIdleChatsWithinCap() {
+  vertel::runtime::MetricsRegistry metrics;
+  {
+    // Refills every 10 ms, so every chat is idle again after a short wait.
+    vertel::core::TokenBucketRateLimiter limiter(
+        /*capacity=*/1, /*refill_tokens=*/100, std::chrono::seconds(1),
+        /*max_tracked_chats=*/640, &metrics);
+    for (std::int64_t chat = 0; chat < 5000; ++chat) {
+      const bool allowed = limiter.Allow(chat);
+      assert(allowed);
+      (void)allowed;
+      assert(limiter.TrackedChats() <= 640);
+    }
+    // Chats still in their window stay limited unless the cap forced them out.
+    const bool recent = limiter.Allow(4999);
+    assert(!recent);
+    (void)recent;
+    std::this_thread::sleep_for(std::chrono::milliseconds(25));
+    for (std::int64_t chat = 5000; chat < 10000; ++chat) {
+      const bool allowed = limiter.Allow(chat);
+      assert(allowed);
+      (void)allowed;
+    }
+    assert(limiter.TrackedChats() <= 640);
+    assert(metrics.Snapshot().rate_limiter_tracked_chats ==
+           static_cast<std::int64_t>(limiter.TrackedChats()));
+  }
+  assert(metrics.Snapshot().rate_limiter_tracked_chats == 0);
+}
+
+class TimedGateway final : public vertel::core::TelegramGateway {
+public:
+  struct Sent {
+    std::int64_t chat_id;
+    std::chrono::steady_clock::time_point at;
+  };
+
+  std::vector<vertel::core::Update> PollUpdates() override { return {}; }
+
+  void SendMessage(const vertel::core::OutgoingMessage &message) override {
+    std::scoped_lock lock(mutex_);
+    sent_.push_back(Sent{.chat_id = message.chat_id, .at = std::chrono::steady_clock::now()});
+  }
+
+  void SendMessageAsync(const vertel::core::OutgoingMessage &message,
+                        vertel::core::SendCallback done) override {
+    SendMessage(message);
+    const bool throttle = throttle_next_.exchange(false);
+    done(message, vertel::core::SendResult{.ok = !throttle,
+                                           .status_code = throttle ? 429 : 200,
+                                           .error = throttle ? "Too Many Requests" : "",
+                                           .retry_after = {}});
+  }
+
+  void CommitUpdates(std::int64_t next_offset) override { committed_ = next_offset; }
+
+  void ThrottleNext() { throttle_next_ = true; }
+  std::vector<Sent> Log() {
+    std::scoped_lock lock(mutex_);
+    return sent_;
+  }
+  std::int64_t Committed() const { return committed_; }
+
+private:
+  std::mutex mutex_;
+  std::vector<Sent> sent_;
+  std::atomic<bool> throttle_next_{false};
+  std::atomic<std::int64_t> committed_{0};
+};
+
+void TestOutboundSchedulerPacesChatsAndPrioritisesInteractive() {
+  using namespace std::chrono_literals;
+  using vertel::core::MessagePriority;
+  using vertel::core::OutgoingMessage;
+
+  TimedGateway inner;
+  vertel::runtime::MetricsRegistry metrics;
+  vertel::core::OutboundScheduler scheduler(inner,
+                                            {.max_messages_per_second = 200.0,
+                                             .private_chat_interval = 40ms,
+                                             .group_chat_interval = 120ms},
+                                            &metrics);
+  std::atomic<int> completed{0};
+  std::atomic<int> delivered{0};
+  const auto count = [&](const OutgoingMessage &, const vertel::core::SendResult &result) {
+    completed.fetch_add(1);
+    delivered.fetch_add(result.ok ? 1 : 0);
+  };
+
+  inner.ThrottleNext();
+  scheduler.SendMessageAsync({.chat_id = 2, .text = "b", .priority = MessagePriority::kBulk},
+                             count);
+  for (int i = 0; i < 3; ++i) {
+    scheduler.SendMessageAsync({.chat_id = 1, .text = "i"}, count);
+  }
+  scheduler.SendMessageAsync({.chat_id = -5, .text = "g"}, count);
+  scheduler.SendMessageAsync({.chat_id = -5, .text = "g"}, count);
+  scheduler.SendMessageAsync({.chat_id = 2, .text = "b", .priority = MessagePriority::kBulk},
+                             count);
+  // The second group message waits 120 ms, so the commit is held back until
+  // the queue has drained.
+  scheduler.CommitUpdates(10);
+  assert(inner.Committed() == 0);
+  scheduler.Drain();
+  assert(inner.Committed() == 10);
+
+  // The message refused with 429 is queued again and delivered on the retry.
+  assert(completed.load() == 7 && delivered.load() == 7);
+  assert(scheduler.QueuedMessages() == 0);
+  const auto log = inner.Log();
+  assert(log.size() == 8);
+  // Arrival times trail the scheduler's release times by a varying delay.
+  constexpr auto kSlack = 2ms;
+  std::vector<std::chrono::steady_clock::time_point> chat_one;
+  std::vector<std::chrono::steady_clock::time_point> group;
+  for (std::size_t i = 0; i < log.size(); ++i) {
+    if (i > 0) {
+      assert(log[i].at - log[i - 1].at >= 5ms - kSlack); // 200 msg/s bot-wide
+    }
+    if (log[i].chat_id == 1) {
+      chat_one.push_back(log[i].at);
+    } else if (log[i].chat_id == -5) {
+      group.push_back(log[i].at);
+    }
+  }
+  for (std::size_t i = 1; i < chat_one.size(); ++i) {
+    assert(chat_one[i] - chat_one[i - 1] >= 40ms - kSlack);
+  }
+  assert(group.size() == 2 && group[1] - group[0] >= 120ms - kSlack);
+  // Unless the scheduler released it before the rest were queued, the bulk
+  // message waits for every interactive chat that was due.
+  const auto first_send = [&log](std::int64_t chat_id) {
+    return std::find_if(log.begin(), log.end(),
+                        [chat_id](const auto &sent) { return sent.chat_id == chat_id; }) -
+           log.begin();
+  };
+  const auto first_bulk = first_send(2);
+  assert(first_bulk == 0 || (first_send(1) < first_bulk && first_send(-5) < first_bulk));
+  assert(metrics.Snapshot().outbound_throttled == 1);
+  assert(metrics.Snapshot().outbound_queue_depth == 0);
+}
+
+void TestRetryEngineHonoursRetryAfterBudgetAndCircuit() {
+  using namespace std::chrono_literals;
+  using vertel::runtime::RetryOutcome;
+
+  const auto throttled = vertel::adapters::telegram::ParseApiError(
+      429, R"({"ok":false,"error_code":429,"description":"Too Many Requests: retry after 5",)"
+           R"("parameters":{"retry_after":5}})");
+  assert(throttled.retryable() && throttled.retry_after() == 5s);
+  assert(std::string(throttled.what()).find("Too Many Requests") != std::string::npos);
+  const auto outcome = vertel::adapters::telegram::RetryOutcomeFor(throttled);
+  assert(!outcome.ok && outcome.retryable && outcome.retry_after == 5000ms);
+  assert(!vertel::adapters::telegram::ParseApiError(400, "not json").retryable());
+  assert(vertel::adapters::telegram::RetryOutcomeFor(std::runtime_error("reset")).retryable);
+
+  const auto make_outcome = [](bool ok, bool retryable = true,
+                               std::chrono::milliseconds wait = {}) {
+    return RetryOutcome{.ok = ok, .retryable = retryable, .retry_after = wait, .error = {}};
+  };
+
+  vertel::runtime::MetricsRegistry metrics;
+  {
+    vertel::runtime::RetryEngine engine({.max_attempts = 4,
+                                         .initial_backoff = 2ms,
+                                         .retry_budget_burst = 3.0,
+                                         .circuit_failure_threshold = 3,
+                                         .circuit_open_duration = 40ms},
+                                        &metrics);
+
+    // Retries run on the timer thread; a server-provided wait is respected.
+    std::promise<int> finished;
+    std::vector<std::chrono::steady_clock::time_point> attempts;
+    const auto started = std::chrono::steady_clock::now();
+    engine.Execute(
+        "sendMessage",
+        [&attempts, make_outcome] {
+          attempts.push_back(std::chrono::steady_clock::now());
+          if (attempts.size() == 1) {
+            return make_outcome(false, true, 30ms);
+          }
+          return make_outcome(attempts.size() == 3);
+        },
+        [&finished](const RetryOutcome &result, int tries) {
+          assert(result.ok);
+          finished.set_value(tries);
+        });
+    assert(std::chrono::steady_clock::now() - started < 30ms);
+    const int tries = finished.get_future().get();
+    assert(tries == 3);
+    (void)tries;
+    assert(attempts[1] - attempts[0] >= 30ms);
+
+    // Errors a retry cannot fix are not retried.
+    const auto permanent = engine.Record("getMe", 1, make_outcome(false, false));
+    assert(!permanent.retry);
+    (void)permanent;
+
+    // Three transient failures in a row open the circuit; after the open
+    // period exactly one probe goes through, and its success closes it.
+    for (int i = 0; i < 3; ++i) {
+      (void)engine.Record("getUpdates", 4, make_outcome(false));
+    }
+    const auto while_open = engine.Admit("getUpdates");
+    assert(while_open > 0ms);
+    assert(metrics.Snapshot().circuit_opened == 1);
+    std::this_thread::sleep_for(45ms);
+    const auto probe = engine.Admit("getUpdates");
+    const auto during_probe = engine.Admit("getUpdates");
+    assert(probe == 0ms);
+    assert(during_probe > 0ms);
+    (void)engine.Record("getUpdates", 1, make_outcome(true));
+    const auto after_probe = engine.Admit("getUpdates");
+    assert(after_probe == 0ms);
+    (void)while_open;
+    (void)probe;
+    (void)during_probe;
+    (void)after_probe;
+
+    // The budget started at 3 tokens, the first call spent two of them and
+    // each first attempt since earned 0.2 back: one more retry, then none.
+    assert(metrics.Snapshot().retries == 2);
+    const auto last_retry = engine.Record("sendMessage", 1, make_outcome(false));
+    const auto no_budget = engine.Record("sendMessage", 2, make_outcome(false));
+    assert(last_retry.retry);
+    assert(!no_budget.retry);
+    (void)last_retry;
+    (void)no_budget;
+    assert(metrics.Snapshot().retry_budget_exhausted == 1);
+  }
+
+  // Retries still waiting on the timer complete when the engine goes away.
+  std::string error;
+  {
+    vertel::runtime::RetryEngine engine;
+    engine.Execute(
+        "sendMessage", [make_outcome] { return make_outcome(false, true, 10s); },
+        [&error](const RetryOutcome &result, int) { error = result.error; });
+    assert(engine.PendingRetries() == 1);
+  }
+  assert(error == "retry engine stopped");
+}
+
+void TestLatencyHistogramsRecordAndExport() {
+  using namespace std::chrono_literals;
+  using vertel::runtime::LatencyHistogram;
+  using vertel::runtime::LatencyStage;
+
+  // Every value lands in a bucket no wider than 1/8 of its lower bound.
+  for (std::uint64_t ns = 0; ns < (std::uint64_t{1} << 41); ns = ns * 5 / 4 + 1) {
+    const std::size_t index = LatencyHistogram::BucketIndex(ns);
+    const std::uint64_t upper = LatencyHistogram::BucketUpperBound(index);
+    assert(ns < upper);
+    assert(index == 0 || LatencyHistogram::BucketUpperBound(index - 1) <= ns);
+    assert(upper - ns <= std::max<std::uint64_t>(1, ns / 8 + 1));
+  }
+  assert(LatencyHistogram::BucketIndex(~std::uint64_t{0}) == LatencyHistogram::kBuckets - 1);
+
+  LatencyHistogram histogram;
+  for (int ms = 1; ms <= 100; ++ms) {
+    histogram.Record(std::chrono::milliseconds(ms));
+  }
+  const auto snapshot = histogram.Snapshot();
+  assert(snapshot.count == 100);
+  assert(snapshot.sum_ns == 5050ull * 1000000);
+  const auto median = snapshot.ValueAtQuantile(0.5);
+  assert(median >= 50'000'000 && median <= 50'000'000 * 9 / 8);
+
+  // BotService records handler time and, once the reply is delivered, the
+  // delay since Telegram stamped the message.
+  const auto now = std::chrono::duration_cast<std::chrono::seconds>(
+      std::chrono::system_clock::now().time_since_epoch());
+  FakeGateway gateway({vertel::core::Update{
+      .update_id = 1, .chat_id = 7, .text = "/ping", .date = (now - 2s).count()}});
+  vertel::core::PingCommandHandler ping;
+  vertel::runtime::MetricsRegistry metrics;
+  vertel::core::BotService bot(gateway, ping, &metrics);
+  bot.ProcessOnce();
+
+  const auto stats = metrics.Snapshot();
+  assert(stats.Latency(LatencyStage::kHandle).count == 1);
+  assert(stats.Latency(LatencyStage::kEndToEnd).count == 1);
+  assert(stats.Latency(LatencyStage::kEndToEnd).ValueAtQuantile(1.0) >= 1'000'000'000);
+  assert(stats.Latency(LatencyStage::kPoll).count == 0);
+
+  std::string body;
+  metrics.WriteExposition(body);
+  const auto has = [&body](std::string_view line) { return body.find(line) != std::string::npos; };
+  assert(has("# TYPE vertel_end_to_end_latency_seconds histogram\n"));
+  assert(has("vertel_end_to_end_latency_seconds_bucket{le=\"1\"} 0\n"));
+  assert(has("vertel_end_to_end_latency_seconds_bucket{le=\"5\"} 1\n"));
+  assert(has("vertel_end_to_end_latency_seconds_bucket{le=\"+Inf\"} 1\n"));
+  assert(has("vertel_end_to_end_latency_seconds_count 1\n"));
+}
+
+void TestLabeledMetricsRenderPrometheusAndOpenMetrics() {
+  vertel::runtime::MetricsRegistry metrics;
+
+  // Per-command series, labeled by the router.
+  vertel::core::PingCommandHandler ping;
+  vertel::core::HelpCommandHandler help;
+  vertel::core::CommandRouter router({}, {}, &metrics);
+  router.Register("ping", ping);
+  router.Register("help", help);
+  FakeGateway gateway({{.update_id = 1, .chat_id = 1, .text = "/ping"},
+                       {.update_id = 2, .chat_id = 1, .text = "/ping"},
+                       {.update_id = 3, .chat_id = 2, .text = "/help"}});
+  vertel::core::BotService bot(gateway, router, &metrics);
+  bot.ProcessOnce();
+
+  // Increments from many threads land in separate cells and all add up.
+  auto &requests = metrics.GetCounter("test_requests_total", "Requests \\ by \"status\"",
+                                      {{"endpoint", "getMe"}, {"status", "a\"b"}});
+  assert(&requests == &metrics.GetCounter("test_requests_total", "",
+                                          {{"endpoint", "getMe"}, {"status", "a\"b"}}));
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 8; ++t) {
+    threads.emplace_back([&requests] {
+      for (int i = 0; i < 10000; ++i) {
+        requests.Increment();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  assert(requests.Value() == 80000);
+  metrics.GetGauge("test_depth", "Depth").Set(-3);
+
+  bool mismatch_rejected = false;
+  try {
+    (void)metrics.GetGauge("test_requests_total", "");
+  } catch (const std::invalid_argument &) {
+    mismatch_rejected = true;
+  }
+  assert(mismatch_rejected);
+
+  std::string body = "stale";
+  metrics.WriteExposition(body);
+  const auto has = [&body](std::string_view text) { return body.find(text) != std::string::npos; };
+  assert(!has("stale"));
+  assert(has("# HELP vertel_updates_processed_total Total updates polled\n"
+             "# TYPE vertel_updates_processed_total counter\n"
+             "vertel_updates_processed_total 3\n"));
+  assert(has("vertel_commands_total{command=\"ping\"} 2\n"));
+  assert(has("vertel_commands_total{command=\"help\"} 1\n"));
+  assert(has("vertel_command_duration_seconds_count{command=\"ping\"} 2\n"));
+  assert(has("vertel_command_duration_seconds_bucket{command=\"help\",le=\"+Inf\"} 1\n"));
+  assert(has("test_requests_total{endpoint=\"getMe\",status=\"a\\\"b\"} 80000\n"));
+  assert(has("# TYPE test_depth gauge\ntest_depth -3\n"));
+  assert(!has("# EOF"));
+
+  metrics.WriteExposition(body, /*open_metrics=*/true);
+  assert(has("# TYPE vertel_updates_processed counter\nvertel_updates_processed_total 3\n"));
+  assert(body.ends_with("# EOF\n"));
+}
+
+// Stream whose first write blocks until Open(), so a test can hold the
+// async log writer while producers fill its queue.
+class GatedStreamBuf final : public std::streambuf {
+public:
+  void Open() {
+    std::lock_guard lock(mutex_);
+    open_ = true;
+    cv_.notify_all();
+  }
+  bool Entered() {
+    std::lock_guard lock(mutex_);
+    return entered_;
+  }
+  std::string Contents() {
+    std::lock_guard lock(mutex_);
+    return contents_;
+  }
+
+protected:
+  std::streamsize xsputn(const char *data, std::streamsize size) override {
+    std::unique_lock lock(mutex_);
+    entered_ = true;
+    cv_.wait(lock, [this] { return open_; });
+    contents_.append(data, static_cast<std::size_t>(size));
+    return size;
+  }
+  int_type overflow(int_type c) override {
+    if (c != traits_type::eof()) {
+      const char ch = traits_type::to_char_type(c);
+      xsputn(&ch, 1);
+    }
+    return traits_type::not_eof(c);
+  }
+
+private:
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool open_{false};
+  bool entered_{false};
+  std::string contents_;
+};
+
+void TestAsyncLoggerBatchesDropsAndFlushes() {
+  const auto count_lines = [](const std::string &text) {
+    return static_cast<int>(std::count(text.begin(), text.end(), '\n'));
+  };
+
+  // Many producers, nothing lost: every line arrives whole.
+  {
+    std::ostringstream out;
+    vertel::runtime::Logger logger(out, {.async = true, .queue_capacity = 64,
+                                         .overflow = vertel::runtime::LogOverflowPolicy::kBlock});
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; ++t) {
+      threads.emplace_back([&logger, t] {
+        for (int i = 0; i < 500; ++i) {
+          logger.Log(vertel::runtime::LogLevel::kWarn, "storm",
+                     {{"thread", std::to_string(t)}, {"i", std::to_string(i)}});
+        }
+      });
+    }
+    for (auto &thread : threads) {
+      thread.join();
+    }
+    logger.Flush();
+    const std::string text = out.str();
+    assert(count_lines(text) == 2000);
+    assert(logger.dropped() == 0);
+    assert(text.starts_with("{\"ts\":\""));
+    assert(text.find("\"level\":\"WARN\",\"msg\":\"storm\",\"thread\":\"3\",\"i\":\"499\"}\n") !=
+           std::string::npos);
+  }
+
+  // A stuck writer: the queue fills, further lines are dropped and counted,
+  // and the destructor still writes out what was queued.
+  GatedStreamBuf gate;
+  std::ostream gated(&gate);
+  vertel::runtime::MetricsRegistry metrics;
+  {
+    vertel::runtime::Logger logger(gated, {.async = true, .queue_capacity = 4}, &metrics);
+    logger.Log(vertel::runtime::LogLevel::kInfo, "first");
+    while (!gate.Entered()) {
+      std::this_thread::yield();
+    }
+    for (int i = 0; i < 10; ++i) {
+      logger.Log(vertel::runtime::LogLevel::kError, "queued_or_dropped");
+    }
+    assert(logger.dropped() == 6);
+    gate.Open();
+  }
+  assert(count_lines(gate.Contents()) == 5);
+  std::string body;
+  metrics.WriteExposition(body);
+  assert(body.find("vertel_log_dropped_total 6\n") != std::string::npos);
+
+  // The synchronous logger keeps writing on the caller's thread.
+  std::ostringstream sync_out;
+  vertel::runtime::Logger sync_logger(sync_out);
+  sync_logger.Log(vertel::runtime::LogLevel::kInfo, "quote\"d", {{"k", "v\\"}});
+  assert(sync_out.str().ends_with("\"level\":\"INFO\",\"msg\":\"quote\\\"d\",\"k\":\"v\\\\\"}\n"));
+}
+
+void TestTypedLogFieldsAndLevelFiltering() {
+  std::ostringstream out;
+  vertel::runtime::Logger logger(out, {.min_level = vertel::runtime::LogLevel::kWarn});
+  const std::string owned = "tab\there";
+  logger.Log(vertel::runtime::LogLevel::kWarn, "typed",
+             {{"s", std::string_view("a\"b")},
+              {"owned", owned},
+              {"i", -42},
+              {"u", std::uint64_t{18446744073709551615ULL}},
+              {"d", 0.5},
+              {"nan", std::numeric_limits<double>::quiet_NaN()},
+              {"b", true},
+              {"ctl", std::string_view("\x01", 1)}});
+  assert(out.str().ends_with("\"level\":\"WARN\",\"msg\":\"typed\",\"s\":\"a\\\"b\","
+                             "\"owned\":\"tab\\there\",\"i\":-42,\"u\":18446744073709551615,"
+                             "\"d\":0.5,\"nan\":null,\"b\":true,\"ctl\":\"\\u0001\"}\n"));
+
+  // Below the runtime level nothing is written, and through the macros the
+  // arguments are not even evaluated.
+  int evaluated = 0;
+  const auto expensive = [&evaluated] {
+    ++evaluated;
+    return 7;
+  };
+  const auto before = out.str().size();
+  logger.Log(vertel::runtime::LogLevel::kInfo, "filtered", {{"n", 1}});
+  VERTEL_LOG_INFO(logger, "filtered", {{"n", expensive()}});
+  assert(out.str().size() == before);
+  assert(evaluated == 0);
+
+  logger.SetMinLevel(vertel::runtime::LogLevel::kDebug);
+  VERTEL_LOG_DEBUG(logger, "enabled", {{"n", expensive()}});
+  assert(evaluated == 1);
+  assert(out.str().ends_with("\"level\":\"DEBUG\",\"msg\":\"enabled\",\"n\":7}\n"));
+
+  assert(vertel::runtime::ParseLogLevel("error") == vertel::runtime::LogLevel::kError);
+  assert(vertel::runtime::ParseLogLevel("loud") == vertel::runtime::LogLevel::kInfo);
+}
+
+void TestOffsetCheckpointSurvivesRestartAndTornWrites() {
+  // Unique per run, so concurrent test runs do not share the file.
+  const auto path =
+      std::filesystem::temp_directory_path() /
+      ("vertel_offset_checkpoint_" +
+       std::to_string(std::chrono::steady_clock::now().time_since_epoch().count()) + ".bin");
+  std::filesystem::remove(path);
+
+  // BotService commits one past the highest update of a handled batch.
+  vertel::core::PingCommandHandler ping;
+  FakeGateway gateway({{.update_id = 41, .chat_id = 1, .text = "/ping"},
+                       {.update_id = 43, .chat_id = 2, .text = "/ping"},
+                       {.update_id = 42, .chat_id = 1, .text = "hello"}});
+  vertel::core::BotService bot(gateway, ping);
+  bot.ProcessOnce();
+  assert(gateway.Committed() == 44);
+  bot.ProcessOnce(); // an empty poll commits nothing
+  assert(gateway.Committed() == 44);
+
+  {
+    vertel::runtime::OffsetCheckpoint checkpoint(
+        path.string(), {.sync = vertel::runtime::CheckpointSync::kEveryCommit});
+    assert(checkpoint.Load() == 0);
+    vertel::adapters::telegram::TelegramClient client(/*inject_sample_update=*/true);
+    client.UseCheckpoint(&checkpoint);
+    client.CommitUpdates(44);
+    client.CommitUpdates(10); // never moves backwards
+    checkpoint.Commit(50);
+    client.UseCheckpoint(nullptr);
+  }
+  {
+    vertel::runtime::OffsetCheckpoint reopened(path.string());
+    assert(reopened.Load() == 50);
+  }
+
+  // Tear the newest slot (the second one): the previous offset survives.
+  {
+    std::fstream file(path, std::ios::in | std::ios::out | std::ios::binary);
+    file.seekp(8 + 16 + 8);
+    const char garbage[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    file.write(garbage, sizeof(garbage));
+  }
+  {
+    vertel::runtime::OffsetCheckpoint reopened(path.string(),
+                                               {.sync = vertel::runtime::CheckpointSync::kNever});
+    assert(reopened.Load() == 44);
+    reopened.Commit(60);
+  }
+  assert(vertel::runtime::OffsetCheckpoint(path.string()).Load() == 60);
+  std::filesystem::remove(path);
+
+  assert(vertel::runtime::ParseCheckpointSync("commit") ==
+         vertel::runtime::CheckpointSync::kEveryCommit);
+}
+
+// Parks every update on an I/O completion the test fires by hand.
+class ParkedEchoHandler final : public vertel::core::AsyncCommandHandler {
+public:
+  explicit ParkedEchoHandler(vertel::runtime::Executor &executor) : executor_(executor) {}
+
+  vertel::runtime::Task<std::optional<vertel::core::OutgoingMessage>>
+  HandleAsync(vertel::core::Update update) override {
+    co_await executor_.Sleep(std::chrono::milliseconds(1));
+    const std::string reply = co_await executor_.Completion<std::string>([this](auto resume) {
+      std::lock_guard lock(mutex_);
+      parked_.emplace_back(std::move(resume));
+    });
+    co_return vertel::core::OutgoingMessage{.chat_id = update.chat_id, .text = reply + update.text};
+  }
+
+  std::size_t Parked() {
+    std::lock_guard lock(mutex_);
+    return parked_.size();
+  }
+
+  // Completes the parked operations from this (non-executor) thread.
+  void ReleaseAll() {
+    std::vector<std::function<void(std::string)>> parked;
+    {
+      std::lock_guard lock(mutex_);
+      parked.swap(parked_);
+    }
+    for (auto &resume : parked) {
+      resume("echo:");
+    }
+  }
+
+private:
+  vertel::runtime::Executor &executor_;
+  std::mutex mutex_;
+  std::vector<std::function<void(std::string)>> parked_;
+};
+
+void TestCoroutineHandlersStayInFlightOnOneExecutor() {
+  constexpr int kSlow = 300;
+  vertel::runtime::Executor executor;
+  ParkedEchoHandler slow(executor);
+  vertel::core::PingCommandHandler ping;
+  vertel::core::CommandRouter router;
+  router.Register("slow", slow);
+  router.Register("ping", ping);
+  vertel::core::AdminWhitelistCommandHandler admin(router, {});
+  vertel::core::TokenBucketRateLimiter limiter(1000, 1000, std::chrono::seconds(1));
+  vertel::core::RateLimitedCommandHandler guarded(admin, limiter);
+
+  std::vector<vertel::core::Update> updates{{.update_id = 1, .chat_id = 1, .text = "/ping"}};
+  for (int i = 0; i < kSlow; ++i) {
+    updates.push_back({.update_id = 2 + i, .chat_id = 100 + i, .text = "/slow"});
+  }
+  FakeGateway gateway(std::move(updates));
+  vertel::runtime::MetricsRegistry metrics;
+  vertel::core::BotService bot(gateway, guarded, &metrics, {.executor = &executor});
+
+  // ProcessOnce() hands every update to the executor and returns; the slow
+  // handlers all wait at once without holding a thread.
+  bot.ProcessOnce();
+  while (slow.Parked() != kSlow || executor.Pending() != kSlow) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  assert(gateway.Sent().size() == 1);
+  assert(gateway.Sent()[0].text == "pong");
+  // /ping may still have been running when the first poll committed; an empty
+  // poll commits again. Nothing at or above the oldest parked update is.
+  bot.ProcessOnce();
+  assert(gateway.Committed() == 2);
+
+  slow.ReleaseAll();
+  executor.WaitIdle();
+  assert(gateway.Sent().size() == kSlow + 1);
+  assert(gateway.Sent().back().text == "echo:/slow");
+  bot.ProcessOnce();
+  assert(gateway.Committed() == kSlow + 2);
+  assert(metrics.Snapshot().updates_processed == kSlow + 1);
+
+  // Without an executor an async-only handler fails like any throwing one.
+  FakeGateway sync_gateway({{.update_id = 1, .chat_id = 1, .text = "/slow"}});
+  vertel::core::BotService sync_bot(sync_gateway, router, &metrics);
+  sync_bot.ProcessOnce();
+  assert(sync_gateway.Sent().empty());
+  assert(metrics.Snapshot().handler_failures == 1);
+}
+
+// Answers each run in one call and records how the router split the poll.
+class RunRecordingHandler final : public vertel::core::CommandHandler {
+public:
+  std::optional<vertel::core::OutgoingMessage> Handle(const vertel::core::Update &) override {
+    return std::nullopt;
+  }
+
+  void HandleCommandBatch(std::span<const vertel::core::UpdateView> updates,
+                          std::span<const vertel::core::CommandView> commands,
+                          vertel::core::ReplySink &sink) override {
+    runs.push_back(updates.size());
+    for (std::size_t i = 0; i < updates.size(); ++i) {
+      // "skip" is left unanswered so the router offers it to its fallbacks.
+      if (commands[i].args != "skip") {
+        sink.Reply(updates[i], {.chat_id = updates[i].chat_id,
+                                .text = "batch:" + std::string(commands[i].args)});
+      }
+    }
+  }
+
+  std::vector<std::size_t> runs;
+};
+
+void TestBatchHandlersFilterAndRouteInOnePass() {
+  FakeGateway gateway({
+      {.update_id = 1, .chat_id = 1, .text = "/batch a"},
+      {.update_id = 2, .chat_id = 2, .text = "/batch b"},
+      {.update_id = 3, .chat_id = 3, .text = "/batch c"},
+      {.update_id = 4, .chat_id = 1, .text = "/batch d"},
+      {.update_id = 5, .chat_id = 1, .text = "/batch skip"},
+      {.update_id = 6, .chat_id = 2, .text = "/ping"},
+      {.update_id = 7, .chat_id = 2, .text = "/boom"},
+      {.update_id = 8, .chat_id = 9, .text = "/batch x"},
+      {.update_id = 9, .chat_id = 9, .text = "/batch@other_bot ignored"},
+      {.update_id = 10, .chat_id = 9, .text = "/batch y"},
+      {.update_id = 11, .chat_id = 9, .text = "/batch z"},
+  });
+
+  vertel::runtime::MetricsRegistry metrics;
+  RunRecordingHandler batch;
+  vertel::core::PingCommandHandler ping;
+  ThrowingHandler fallback;
+  vertel::core::CommandRouter router({fallback}, "vertel_bot", &metrics);
+  router.Register("batch", batch);
+  router.Register("ping", ping);
+  vertel::core::AdminWhitelistCommandHandler admin(router, {1, 2, 9});
+  vertel::core::TokenBucketRateLimiter limiter(3, 1, std::chrono::seconds(60));
+  vertel::core::RateLimitedCommandHandler guarded(admin, limiter, "Slow down.", &metrics);
+  vertel::core::BotService bot(gateway, guarded, &metrics);
+
+  bot.ProcessOnce();
+
+  // The rejections split the poll, and so do the foreign update, /ping and the
+  // fallback's update; each remaining run reached the handler in one call.
+  assert((batch.runs == std::vector<std::size_t>{2, 2, 1, 1}));
+  const std::vector<std::string> expected{"batch:a",    "batch:b", "Unauthorized.",
+                                          "batch:d",    "ok",      "pong",
+                                          "batch:x",    "batch:y", "Slow down."};
+  const auto &sent = gateway.Sent();
+  assert(sent.size() == expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    assert(sent[i].text == expected[i]);
+  }
+  assert(sent.back().chat_id == 9);
+
+  const auto snapshot = metrics.Snapshot();
+  assert(snapshot.updates_processed == 11);
+  assert(snapshot.handler_failures == 1);
+  assert(snapshot.rate_limit_rejections == 1);
+  assert(gateway.Committed() == 12);
+  std::string exposition;
+  metrics.WriteExposition(exposition);
+  assert(exposition.find("vertel_commands_total{command=\"batch\"} 6") != std::string::npos);
+}
+
+// Serves scripted polls, one list of updates each, and records the options
+// every poll ran with. Poll `failing_poll` throws instead.
+class ScriptedPollGateway final : public vertel::core::TelegramGateway {
+public:
+  ScriptedPollGateway(std::vector<std::vector<vertel::core::Update>> polls,
+                      std::size_t failing_poll)
+      : polls_(std::move(polls)), failing_poll_(failing_poll) {}
+
+  std::vector<vertel::core::Update> PollUpdates() override {
+    const std::size_t poll = polls_started_.fetch_add(1);
+    seen_.push_back(options_);
+    if (poll == failing_poll_) {
+      throw std::runtime_error("simulated getUpdates failure");
+    }
+    return poll < polls_.size() ? polls_[poll] : std::vector<vertel::core::Update>{};
+  }
+  void SetPollOptions(const vertel::core::PollOptions &options) override { options_ = options; }
+
+  void SendMessage(const vertel::core::OutgoingMessage &message) override {
+    sent_.push_back(message);
+    sent_count_.fetch_add(1);
+  }
+  void CommitUpdates(std::int64_t next_offset) override { committed_ = next_offset; }
+
+  std::size_t PollsStarted() const { return polls_started_.load(); }
+  std::size_t SentCount() const { return sent_count_.load(); }
+  // Read these once Run() has returned.
+  const std::vector<vertel::core::PollOptions> &Seen() const { return seen_; }
+  const std::vector<vertel::core::OutgoingMessage> &Sent() const { return sent_; }
+  std::int64_t Committed() const { return committed_; }
+
+private:
+  std::vector<std::vector<vertel::core::Update>> polls_;
+  std::size_t failing_poll_;
+  std::atomic<std::size_t> polls_started_{0};
+  vertel::core::PollOptions options_{};
+  std::vector<vertel::core::PollOptions> seen_;
+  std::vector<vertel::core::OutgoingMessage> sent_;
+  std::atomic<std::size_t> sent_count_{0};
+  std::int64_t committed_{0};
+};
+
+// Echoes updates; "/hold" waits until the gateway has started another poll.
+class HoldingHandler final : public vertel::core::CommandHandler {
+public:
+  explicit HoldingHandler(const ScriptedPollGateway &gateway) : gateway_(gateway) {}
+
+  std::optional<vertel::core::OutgoingMessage> Handle(const vertel::core::Update &update) override {
+    if (update.text == "/hold") {
+      const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+      while (gateway_.PollsStarted() < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      overlapped = gateway_.PollsStarted() >= 2;
+    }
+    return vertel::core::OutgoingMessage{.chat_id = update.chat_id, .text = update.text};
+  }
+
+  bool overlapped{false};
+
+private:
+  const ScriptedPollGateway &gateway_;
+};
+
+void TestRunOverlapsPollingWithHandling() {
+  using std::chrono::seconds;
+  ScriptedPollGateway gateway(
+      {
+          {{.update_id = 1, .chat_id = 1, .text = "/hold"},
+           {.update_id = 2, .chat_id = 2, .text = "/a"},
+           {.update_id = 3, .chat_id = 3, .text = "/b"}},
+          {{.update_id = 4, .chat_id = 1, .text = "/c"},
+           {.update_id = 5, .chat_id = 2, .text = "/d"}},
+      },
+      /*failing_poll=*/2);
+  HoldingHandler handler(gateway);
+  vertel::runtime::MetricsRegistry metrics;
+  vertel::core::BotService bot(gateway, handler, &metrics,
+                               {.poll_limit = 3,
+                                .poll_timeout = seconds(7),
+                                .idle_backoff = std::chrono::milliseconds(1)});
+
+  int poll_errors = 0;
+  // Stop once everything is answered and the failing poll has been retried.
+  bot.Run({.stop_requested =
+               [&] { return gateway.SentCount() == 5 && gateway.PollsStarted() >= 4; },
+           .after_poll = [&](const std::exception *error) -> std::chrono::steady_clock::duration {
+             poll_errors += error != nullptr ? 1 : 0;
+             return std::chrono::steady_clock::duration::zero();
+           }});
+
+  // The second getUpdates ran while the first batch was still being handled.
+  assert(handler.overlapped);
+  const auto &seen = gateway.Seen();
+  assert(seen.size() >= 4);
+  assert(seen[0].limit == 3 && seen[0].timeout == seconds(7));
+  // The first batch was full, so the next poll did not wait...
+  assert(seen[1].timeout == seconds(0));
+  // ...and after a partial batch polls went back to long-polling.
+  assert(seen[2].timeout == seconds(7) && seen[3].timeout == seconds(7));
+  assert(poll_errors == 1);
+
+  const std::vector<std::string> expected{"/hold", "/a", "/b", "/c", "/d"};
+  assert(gateway.Sent().size() == expected.size());
+  for (std::size_t i = 0; i < expected.size(); ++i) {
+    assert(gateway.Sent()[i].text == expected[i]);
+  }
+  assert(gateway.Committed() == 6);
+  assert(metrics.Snapshot().updates_processed == 5);
+
+  // Without an after_poll hook a failed poll ends Run() with its exception.
+  ScriptedPollGateway failing({}, /*failing_poll=*/0);
+  vertel::core::BotService failing_bot(failing, handler);
+  bool threw = false;
+  try {
+    failing_bot.Run({});
+  } catch (const std::runtime_error &) {
+    threw = true;
+  }
+  assert(threw);
+}
+
+void TestTelegramClientTalksToMockBotApi() {
+#if VERTEL_HAS_LIBCURL && defined(__linux__)
+  using vertel::testing::MockBotApi;
+  using vertel::adapters::telegram::TelegramClient;
+  vertel::core::PingCommandHandler ping_handler;
+
+  MockBotApi api(MockBotApi::Options{});
+  const bool api_started = api.Start();
+  assert(api_started);
+  (void)api_started;
+  vertel::runtime::MetricsRegistry metrics;
+  TelegramClient client("123:test", 0, 5, nullptr, 32, &metrics);
+  client.SetApiBase(api.base_url() + "/");
+  vertel::core::BotService bot(client, ping_handler, &metrics);
+
+  for (int i = 0; i < 5; ++i) {
+    api.Enqueue(100 + i % 2, "/ping");
+  }
+  bot.ProcessOnce();
+  auto stats = api.Snapshot();
+  assert(stats.updates_delivered == 5);
+  assert(stats.replies == 5);
+  assert(stats.unmatched_replies == 0);
+  assert(stats.reply_latency.count == 5);
+  assert(stats.backlog == 5); // not confirmed until the next poll
+  assert(metrics.Snapshot().messages_sent == 5);
+
+  bot.ProcessOnce();
+  stats = api.Snapshot();
+  assert(stats.get_updates_calls == 2);
+  assert(stats.updates_delivered == 5);
+  assert(stats.backlog == 0);
+
+  // Every reply refused with 429: counted on both sides, nothing matched.
+  MockBotApi throttling(MockBotApi::Options{.throttle_ratio = 1.0});
+  const bool throttling_started = throttling.Start();
+  assert(throttling_started);
+  (void)throttling_started;
+  vertel::runtime::MetricsRegistry throttled_metrics;
+  TelegramClient throttled_client("123:test", 0, 5, nullptr, 32, &throttled_metrics);
+  throttled_client.SetApiBase(throttling.base_url());
+  vertel::core::BotService throttled_bot(throttled_client, ping_handler, &throttled_metrics);
+  for (int i = 0; i < 3; ++i) {
+    throttling.Enqueue(7, "/ping");
+  }
+  throttled_bot.ProcessOnce();
+  stats = throttling.Snapshot();
+  assert(stats.throttled == 3);
+  assert(stats.replies == 0);
+  assert(throttled_metrics.Snapshot().send_failures == 3);
+  assert(throttled_metrics.Snapshot().messages_sent == 0);
+#endif
+}
+
+void TestMultiBotHostServesSeveralBots() {
+  // A scoped registry writes labelled series into its parent.
+  vertel::runtime::MetricsRegistry root;
+  vertel::runtime::MetricsRegistry scoped(root, {{"bot", "x"}});
+  scoped.IncrementMessagesSent();
+  assert(scoped.Snapshot().messages_sent == 1);
+  assert(root.Snapshot().messages_sent == 0);
+  std::string exposition;
+  scoped.WriteExposition(exposition);
+  assert(exposition.find("vertel_messages_sent_total{bot=\"x\"} 1") != std::string::npos);
+
+#if VERTEL_HAS_LIBCURL && defined(__linux__)
+  using vertel::testing::MockBotApi;
+  using vertel::adapters::telegram::MultiBotHost;
+  vertel::core::PingCommandHandler ping_handler;
+  vertel::core::StartCommandHandler start_handler;
+
+  MockBotApi api(MockBotApi::Options{});
+  const bool api_started = api.Start();
+  assert(api_started);
+  (void)api_started;
+  vertel::runtime::MetricsRegistry metrics;
+  MultiBotHost host(MultiBotHost::Options{.workers = 2,
+                                          .long_poll_timeout_seconds = 1,
+                                          .request_timeout_seconds = 5,
+                                          .api_base = api.base_url()},
+                    &metrics);
+  host.AddBot("ping", "1:ping", ping_handler);
+  host.AddBot("start", "2:start", start_handler);
+  bool duplicate_rejected = false;
+  try {
+    host.AddBot("ping", "3:other", ping_handler);
+  } catch (const std::invalid_argument &) {
+    duplicate_rejected = true;
+  }
+  assert(duplicate_rejected);
+  assert(host.size() == 2);
+
+  // The same chat talks to both bots; each sees only its own updates.
+  for (int i = 0; i < 4; ++i) {
+    api.Enqueue(100 + i % 2, "/ping", "1:ping");
+    api.Enqueue(100, "/start", "2:start");
+  }
+  host.Start();
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  // Done once every update is answered and confirmed by the next poll.
+  for (auto stats = api.Snapshot();
+       (stats.replies < 8 || stats.backlog > 0) && std::chrono::steady_clock::now() < deadline;
+       stats = api.Snapshot()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  host.Stop();
+
+  const auto stats = api.Snapshot();
+  assert(stats.replies == 8);
+  assert(stats.unmatched_replies == 0);
+  assert(stats.backlog == 0);
+  assert(host.MetricsFor("ping")->Snapshot().messages_sent == 4);
+  assert(host.MetricsFor("start")->Snapshot().updates_processed == 4);
+  exposition.clear();
+  metrics.WriteExposition(exposition);
+  assert(exposition.find("vertel_messages_sent_total{bot=\"ping\"} 4") != std::string::npos);
+  assert(exposition.find("vertel_messages_sent_total{bot=\"start\"} 4") != std::string::npos);
+#endif
+}
+
+void TestMultiBotHostBacksOffRevokedToken() {
+#if VERTEL_HAS_LIBCURL && defined(__linux__)
+  using vertel::testing::MockBotApi;
+  using vertel::adapters::telegram::MultiBotHost;
+  vertel::core::PingCommandHandler ping_handler;
+
+  // 401 is not retryable, so every poll fails at once; the host must still pause.
+  MockBotApi api(MockBotApi::Options{.revoked_token = "1:revoked"});
+  const bool api_started = api.Start();
+  assert(api_started);
+  (void)api_started;
+  MultiBotHost host(MultiBotHost::Options{.long_poll_timeout_seconds = 1,
+                                          .request_timeout_seconds = 5,
+                                          .api_base = api.base_url(),
+                                          .idle_backoff = std::chrono::milliseconds(50)});
+  host.AddBot("revoked", "1:revoked", ping_handler);
+  host.Start();
+  std::this_thread::sleep_for(std::chrono::milliseconds(500));
+  host.Stop();
+
+  // At most one poll per 50 ms pause, plus the first.
+  const auto polls = api.Snapshot().get_updates_calls;
+  assert(polls >= 1 && polls <= 11);
+  (void)polls;
+#endif
+}
+
+void TestShardFrontRoutesAndRedeliversUpdates() {
+  namespace shard = vertel::adapters::shard;
+
+  // Frames survive being cut at every byte.
+  std::string wire;
+  shard::AppendHelloFrame(wire, shard::Hello{.shard = 1, .shards = 3});
+  shard::AppendUpdateFrame(wire, vertel::core::UpdateView{.update_id = 42,
+                                                          .chat_id = -1001234,
+                                                          .text = "/ping",
+                                                          .date = 7});
+  shard::AppendReplyFrame(wire, vertel::core::OutgoingMessage{
+                                    .chat_id = -5,
+                                    .text = "pong",
+                                    .priority = vertel::core::MessagePriority::kBulk});
+  shard::AppendAckFrame(wire, 43);
+  shard::FrameReader reader;
+  // Payloads are copied: they only live until the next Append().
+  std::vector<std::pair<shard::FrameType, std::string>> frames;
+  for (const char byte : wire) {
+    reader.Append(std::string_view(&byte, 1));
+    while (const auto frame = reader.Next()) {
+      frames.emplace_back(frame->type, frame->payload);
+    }
+  }
+  assert(frames.size() == 4 && reader.buffered() == 0);
+  shard::Hello hello;
+  assert(frames[0].first == shard::FrameType::kHello);
+  assert(shard::DecodeHello(frames[0].second, hello));
+  assert(hello.shard == 1 && hello.shards == 3);
+  vertel::core::UpdateView update;
+  assert(shard::DecodeUpdate(frames[1].second, update));
+  assert(update.update_id == 42 && update.chat_id == -1001234 && update.date == 7);
+  vertel::core::OutgoingMessage reply;
+  assert(shard::DecodeReply(frames[2].second, reply));
+  assert(reply.chat_id == -5 && reply.text == "pong");
+  assert(reply.priority == vertel::core::MessagePriority::kBulk);
+  std::int64_t next_offset = 0;
+  assert(shard::DecodeAck(frames[3].second, next_offset) && next_offset == 43);
+  assert(!shard::DecodeUpdate(std::string_view(frames[1].second).substr(0, 3), update));
+
+  // A fifth shard only takes chats over from the other four.
+  std::size_t moved = 0;
+  for (std::int64_t chat = 1; chat <= 4000; ++chat) {
+    const auto before = shard::ShardForChat(chat, 4);
+    const auto after = shard::ShardForChat(chat, 5);
+    assert(before < 4 && after < 5);
+    assert(after == before || after == 4);
+    moved += after == 4 ? 1 : 0;
+  }
+  assert(moved > 600 && moved < 1000);
+
+#ifdef __linux__
+  class Ingest final : public vertel::core::TelegramGateway {
+  public:
+    void Push(std::int64_t update_id, std::int64_t chat_id) {
+      std::scoped_lock lock(mutex_);
+      updates_.push_back(
+          {.update_id = update_id, .chat_id = chat_id, .text = "u" + std::to_string(update_id)});
+    }
+    std::vector<vertel::core::Update> PollUpdates() override {
+      std::scoped_lock lock(mutex_);
+      return std::exchange(updates_, {});
+    }
+    void SendMessage(const vertel::core::OutgoingMessage &message) override {
+      std::scoped_lock lock(mutex_);
+      sent_.push_back(message);
+    }
+    void CommitUpdates(std::int64_t next_offset) override { committed_ = next_offset; }
+    std::vector<vertel::core::OutgoingMessage> Sent() {
+      std::scoped_lock lock(mutex_);
+      return sent_;
+    }
+    std::int64_t Committed() const { return committed_; }
+
+  private:
+    std::mutex mutex_;
+    std::vector<vertel::core::Update> updates_;
+    std::vector<vertel::core::OutgoingMessage> sent_;
+    std::atomic<std::int64_t> committed_{0};
+  };
+  class EchoHandler final : public vertel::core::CommandHandler {
+  public:
+    std::optional<vertel::core::OutgoingMessage>
+    Handle(const vertel::core::Update &update) override {
+      return vertel::core::OutgoingMessage{.chat_id = update.chat_id, .text = update.text};
+    }
+  };
+  const auto wait_for = [](const std::function<bool()> &done) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!done() && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return done();
+  };
+
+  const std::string socket_path = (std::filesystem::temp_directory_path() /
+                                   ("vertel_shard_test_" + std::to_string(getpid()) + ".sock"))
+                                      .string();
+  Ingest ingest;
+  vertel::runtime::MetricsRegistry metrics;
+  shard::ShardFront front(shard::ShardFront::Options{.socket_path = socket_path,
+                                                     .shards = 2,
+                                                     .poll_timeout = std::chrono::seconds(0),
+                                                     .idle_backoff = std::chrono::milliseconds(5)},
+                          ingest, ingest, &metrics);
+  const bool front_started = front.Start();
+  assert(front_started);
+  (void)front_started;
+  std::atomic<bool> stop{false};
+  std::thread front_thread([&] {
+    front.Run({.stop_requested = [&] { return stop.load(); }, .after_poll = {}});
+  });
+
+  EchoHandler echo;
+  const auto worker_options = [&](std::uint32_t index) {
+    return shard::ShardWorkerGateway::Options{.socket_path = socket_path,
+                                              .shard = index,
+                                              .shards = 2,
+                                              .reconnect_interval = std::chrono::milliseconds(5),
+                                              .poll_wait = std::chrono::milliseconds(20)};
+  };
+  std::vector<std::int64_t> routed(2, 0);
+  for (std::int64_t id = 1; id <= 30; ++id) {
+    const std::int64_t chat = 100 + id % 7;
+    ingest.Push(id, chat);
+    ++routed[shard::ShardForChat(chat, 2)];
+  }
+  assert(routed[0] > 0 && routed[1] > 0);
+  const bool all_polled = wait_for([&] { return front.Unacked(0) + front.Unacked(1) == 30; });
+  assert(all_polled);
+  (void)all_polled;
+
+  // Shard 1's first worker takes a batch and dies before handling it.
+  {
+    shard::ShardWorkerGateway doomed(worker_options(1));
+    vertel::core::UpdateBatch batch;
+    const bool taken = wait_for([&] {
+      doomed.PollBatch(batch);
+      return !batch.empty();
+    });
+    assert(taken);
+    (void)taken;
+  }
+  assert(front.Unacked(1) == static_cast<std::size_t>(routed[1]));
+
+  std::vector<vertel::runtime::MetricsRegistry> worker_metrics(2);
+  shard::ShardWorkerGateway worker0(worker_options(0));
+  shard::ShardWorkerGateway worker1(worker_options(1));
+  vertel::core::BotService bot0(worker0, echo, &worker_metrics[0]);
+  vertel::core::BotService bot1(worker1, echo, &worker_metrics[1]);
+  const bool all_answered = wait_for([&] {
+    bot0.ProcessOnce();
+    bot1.ProcessOnce();
+    return ingest.Sent().size() >= 30 && front.Unacked(0) == 0 && front.Unacked(1) == 0;
+  });
+  const bool all_committed = wait_for([&] { return ingest.Committed() == 31; });
+  assert(all_answered && all_committed);
+  (void)all_answered;
+  (void)all_committed;
+  stop = true;
+  front_thread.join();
+  front.Stop();
+  assert(!std::filesystem::exists(socket_path));
+
+  // Every update answered once, each chat by the worker of its shard.
+  const auto sent = ingest.Sent();
+  assert(sent.size() == 30);
+  std::unordered_set<std::string> texts;
+  for (const auto &message : sent) {
+    const bool first_answer = texts.insert(message.text).second;
+    assert(first_answer);
+    (void)first_answer;
+  }
+  for (std::size_t i = 0; i < 2; ++i) {
+    assert(worker_metrics[i].Snapshot().updates_processed == static_cast<std::uint64_t>(routed[i]));
+  }
+  std::string exposition;
+  metrics.WriteExposition(exposition);
+  assert(exposition.find("vertel_shard_redelivered_total{shard=\"1\"} " +
+                         std::to_string(routed[1])) != std::string::npos);
+  assert(exposition.find("vertel_shard_unacked_updates{shard=\"1\"} 0") != std::string::npos);
+  assert(exposition.find("vertel_shard_relayed_replies_total 30") != std::string::npos);
+#endif
+}
+
 } // namespace
 
 int main() {
@@ -159,5 +1869,31 @@ int main() {
   TestRateLimiterBlocksBurstPerChatAndIncrementsMetric();
   TestAdminWhitelistBlocksNonAdmin();
   TestHandlerFailuresAreCountedAndProcessingContinues();
+  TestConnectionPoolReusesIdleHandles();
+  TestAsyncSenderReportsEveryCompletion();
+  TestSendFailuresAreCounted();
+  TestParallelDispatchKeepsPerChatOrder();
+  TestWebhookGatewayQueuesPostedUpdates();
+  TestHealthServerServesSplitRequestsWithKeepAlive();
+  TestStreamDecoderHandlesArbitraryChunks();
+  TestUpdateBatchViewsSurviveArenaGrowth();
+  TestRouterIndexesCommandsAndParsesArguments();
+  TestStaticCommandRouterDispatchesThroughPerfectHash();
+  TestRateLimiterIsExactUnderContention();
+  TestRateLimiterEvictsIdleChatsWithinCap();
+  TestOutboundSchedulerPacesChatsAndPrioritisesInteractive();
+  TestRetryEngineHonoursRetryAfterBudgetAndCircuit();
+  TestLatencyHistogramsRecordAndExport();
+  TestLabeledMetricsRenderPrometheusAndOpenMetrics();
+  TestAsyncLoggerBatchesDropsAndFlushes();
+  TestTypedLogFieldsAndLevelFiltering();
+  TestOffsetCheckpointSurvivesRestartAndTornWrites();
+  TestCoroutineHandlersStayInFlightOnOneExecutor();
+  TestBatchHandlersFilterAndRouteInOnePass();
+  TestRunOverlapsPollingWithHandling();
+  TestTelegramClientTalksToMockBotApi();
+  TestMultiBotHostServesSeveralBots();
+  TestMultiBotHostBacksOffRevokedToken();
+  TestShardFrontRoutesAndRedeliversUpdates();
   return 0;
 }